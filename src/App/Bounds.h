@@ -0,0 +1,64 @@
+#pragma once
+
+#include <glm/glm.hpp>
+
+#include <array>
+#include <limits>
+
+// Axis-aligned bounding box.
+struct Aabb
+{
+	glm::vec3 min{std::numeric_limits<float>::max()};
+	glm::vec3 max{std::numeric_limits<float>::lowest()};
+
+	[[nodiscard]] bool valid() const noexcept { return min.x <= max.x && min.y <= max.y && min.z <= max.z; }
+	[[nodiscard]] glm::vec3 center() const noexcept { return (min + max) * 0.5f; }
+	[[nodiscard]] glm::vec3 extent() const noexcept { return (max - min) * 0.5f; }
+
+	void expand(const glm::vec3 & point) noexcept
+	{
+		min = glm::min(min, point);
+		max = glm::max(max, point);
+	}
+
+	void expand(const Aabb & other) noexcept
+	{
+		min = glm::min(min, other.min);
+		max = glm::max(max, other.max);
+	}
+};
+
+// Bounds of a box after an affine transform (Arvo's method on center/extent).
+inline Aabb transformAabb(const Aabb & box, const glm::mat4 & transform)
+{
+	const auto center = glm::vec3(transform * glm::vec4(box.center(), 1.0f));
+	const auto absolute = glm::mat3(glm::abs(glm::vec3(transform[0])),
+									glm::abs(glm::vec3(transform[1])),
+									glm::abs(glm::vec3(transform[2])));
+	const auto extent = absolute * box.extent();
+	return Aabb{center - extent, center + extent};
+}
+
+// Six inward-facing planes (xyz normal, w distance), normalized.
+struct Frustum
+{
+	std::array<glm::vec4, 6> planes;
+
+	// Gribb-Hartmann extraction from a projection * view matrix.
+	static Frustum fromMatrix(const glm::mat4 & viewProjection)
+	{
+		const auto row = [&](const int index) {
+			return glm::vec4(viewProjection[0][index], viewProjection[1][index], viewProjection[2][index], viewProjection[3][index]);
+		};
+
+		Frustum frustum;
+		frustum.planes = {row(3) + row(0), row(3) - row(0),
+						  row(3) + row(1), row(3) - row(1),
+						  row(3) + row(2), row(3) - row(2)};
+		for (auto & plane : frustum.planes)
+		{
+			plane /= glm::length(glm::vec3(plane));
+		}
+		return frustum;
+	}
+};
@@ -0,0 +1,526 @@
+#include "Bvh.h"
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <utility>
+
+namespace
+{
+constexpr std::uint32_t g_leaf_size = 2;
+constexpr std::uint32_t g_max_leaf_size = 16;
+constexpr std::uint32_t g_parallel_threshold = 4096;
+constexpr int g_bin_count = 16;
+
+// Root lives at 0, node 1 is padding so that sibling pairs start on even indices.
+constexpr std::uint32_t g_root = 0;
+constexpr std::uint32_t g_first_pair = 2;
+
+constexpr std::uint32_t g_all_planes = (1u << 6) - 1;
+
+// Subtrees handed out per thread by the parallel cull, extra ones even out the load.
+constexpr size_t g_cull_tasks_per_thread = 4;
+
+float surfaceArea(const Aabb & box)
+{
+	const auto size = box.max - box.min;
+	return 2.0f * (size.x * size.y + size.y * size.z + size.z * size.x);
+}
+
+// Entry distance of the ray into the box, infinity on a miss.
+float intersect(const glm::vec3 & min, const glm::vec3 & max, const glm::vec3 & origin, const glm::vec3 & inverseDirection, const float limit)
+{
+	const auto t0 = (min - origin) * inverseDirection;
+	const auto t1 = (max - origin) * inverseDirection;
+	const auto entries = glm::min(t0, t1);
+	const auto exits = glm::max(t0, t1);
+	const auto enter = std::max({entries.x, entries.y, entries.z, 0.0f});
+	const auto exit = std::min({exits.x, exits.y, exits.z, limit});
+	return enter <= exit ? enter : std::numeric_limits<float>::infinity();
+}
+
+float distance(const glm::vec3 & min, const glm::vec3 & max, const glm::vec3 & point)
+{
+	return glm::length(glm::max(glm::max(min - point, point - max), glm::vec3(0.0f)));
+}
+
+enum class PlaneTest
+{
+	Outside,
+	Intersecting,
+	Inside,
+};
+
+PlaneTest testPlane(const glm::vec4 & plane, const glm::vec3 & min, const glm::vec3 & max)
+{
+	const auto center = (min + max) * 0.5f;
+	const auto extent = (max - min) * 0.5f;
+	const auto normal = glm::vec3(plane);
+	const auto distance = glm::dot(normal, center) + plane.w;
+	const auto radius = glm::dot(glm::abs(normal), extent);
+	if (distance + radius < 0.0f)
+	{
+		return PlaneTest::Outside;
+	}
+	return distance - radius >= 0.0f ? PlaneTest::Inside : PlaneTest::Intersecting;
+}
+}// namespace
+
+void Bvh::build(const std::vector<Aabb> & boxes)
+{
+	build(boxes, nullptr);
+}
+
+void Bvh::build(const std::vector<Aabb> & boxes, JobSystem & jobs)
+{
+	build(boxes, &jobs);
+}
+
+void Bvh::build(const std::vector<Aabb> & boxes, JobSystem * jobs)
+{
+	boxes_ = boxes;
+	nodes_.clear();
+	primitives_.clear();
+	centroids_.clear();
+
+	const auto count = static_cast<std::uint32_t>(boxes_.size());
+	if (count == 0)
+	{
+		return;
+	}
+
+	primitives_.resize(count);
+	centroids_.resize(count);
+	for (std::uint32_t i = 0; i < count; ++i)
+	{
+		primitives_[i] = i;
+		centroids_[i] = boxes_[i].center();
+	}
+
+	// A binary tree over n leaves has at most 2n - 1 nodes, plus the padding slot.
+	nodes_.resize(2 * static_cast<size_t>(count));
+	nodeCursor_ = g_first_pair;
+
+	buildNode(g_root, 0, count, jobs);
+	nodes_.resize(std::max<std::uint32_t>(nodeCursor_, g_first_pair));
+
+	// Centroids are only needed while splitting.
+	centroids_ = {};
+}
+
+void Bvh::buildNode(const std::uint32_t nodeIndex, const std::uint32_t first, const std::uint32_t count, JobSystem * const jobs)
+{
+	auto & node = nodes_[nodeIndex];
+
+	Aabb bounds;
+	Aabb centroidBounds;
+	for (auto i = first; i < first + count; ++i)
+	{
+		bounds.expand(boxes_[primitives_[i]]);
+		centroidBounds.expand(centroids_[primitives_[i]]);
+	}
+	node.min = bounds.min;
+	node.max = bounds.max;
+	node.leftOrFirst = first;
+	node.count = count;
+
+	if (count <= g_leaf_size)
+	{
+		return;
+	}
+
+	// Binned SAH: evaluate g_bin_count - 1 candidate planes on every axis.
+	struct Bin
+	{
+		Aabb bounds;
+		std::uint32_t count = 0;
+	};
+
+	glm::vec3 binScale(0.0f);
+	for (int axis = 0; axis < 3; ++axis)
+	{
+		const auto extent = centroidBounds.max[axis] - centroidBounds.min[axis];
+		binScale[axis] = extent > 0.0f ? static_cast<float>(g_bin_count) / extent : 0.0f;
+	}
+
+	const auto binOf = [&](const std::uint32_t primitive, const int axis) {
+		const auto bin = static_cast<int>((centroids_[primitive][axis] - centroidBounds.min[axis]) * binScale[axis]);
+		return std::min(bin, g_bin_count - 1);
+	};
+
+	// One sweep over the primitives fills the bins of all three axes.
+	std::array<std::array<Bin, g_bin_count>, 3> bins{};
+	for (auto i = first; i < first + count; ++i)
+	{
+		const auto primitive = primitives_[i];
+		for (int axis = 0; axis < 3; ++axis)
+		{
+			auto & bin = bins[axis][binOf(primitive, axis)];
+			bin.bounds.expand(boxes_[primitive]);
+			++bin.count;
+		}
+	}
+
+	auto bestCost = std::numeric_limits<float>::infinity();
+	auto bestAxis = -1;
+	auto bestSplit = 0;
+
+	for (int axis = 0; axis < 3; ++axis)
+	{
+		if (binScale[axis] <= 0.0f)
+		{
+			continue;
+		}
+
+		std::array<float, g_bin_count> leftCost{};
+		Aabb leftBounds;
+		std::uint32_t leftCount = 0;
+		for (int split = 1; split < g_bin_count; ++split)
+		{
+			leftBounds.expand(bins[axis][split - 1].bounds);
+			leftCount += bins[axis][split - 1].count;
+			leftCost[split] = leftCount == 0 ? 0.0f : surfaceArea(leftBounds) * static_cast<float>(leftCount);
+		}
+
+		Aabb rightBounds;
+		std::uint32_t rightCount = 0;
+		for (int split = g_bin_count - 1; split > 0; --split)
+		{
+			rightBounds.expand(bins[axis][split].bounds);
+			rightCount += bins[axis][split].count;
+			const auto rightCost = rightCount == 0 ? 0.0f : surfaceArea(rightBounds) * static_cast<float>(rightCount);
+			const auto cost = leftCost[split] + rightCost;
+			if (cost < bestCost)
+			{
+				bestCost = cost;
+				bestAxis = axis;
+				bestSplit = split;
+			}
+		}
+	}
+
+	// Splitting pays off when traversal plus both children is cheaper than testing every primitive.
+	const auto area = surfaceArea(bounds);
+	const auto splitCost = 1.0f + (area > 0.0f ? bestCost / area : 0.0f);
+	if (bestAxis < 0 || (splitCost >= static_cast<float>(count) && count <= g_max_leaf_size))
+	{
+		return;
+	}
+
+	const auto begin = primitives_.begin() + first;
+	const auto end = begin + count;
+	auto middle = std::partition(begin, end, [&](const std::uint32_t primitive) {
+		return binOf(primitive, bestAxis) < bestSplit;
+	});
+
+	if (middle == begin || middle == end)
+	{
+		// Degenerate split, fall back to halving along the chosen axis.
+		middle = begin + count / 2;
+		std::nth_element(begin, middle, end, [&](const std::uint32_t lhs, const std::uint32_t rhs) {
+			return centroids_[lhs][bestAxis] < centroids_[rhs][bestAxis];
+		});
+	}
+
+	const auto leftCount = static_cast<std::uint32_t>(middle - begin);
+	const auto children = nodeCursor_.fetch_add(2);
+	node.leftOrFirst = children;
+	node.count = 0;
+
+	// idle workers steal the other half, so the split can go as deep as the threshold allows
+	if (jobs != nullptr && count > g_parallel_threshold)
+	{
+		jobs->invoke([this, children, first, leftCount, jobs] { buildNode(children, first, leftCount, jobs); },
+					 [this, children, first, leftCount, count, jobs] {
+						 buildNode(children + 1, first + leftCount, count - leftCount, jobs);
+					 });
+	}
+	else
+	{
+		buildNode(children, first, leftCount, jobs);
+		buildNode(children + 1, first + leftCount, count - leftCount, jobs);
+	}
+}
+
+void Bvh::refit(const std::vector<Aabb> & boxes)
+{
+	boxes_ = boxes;
+
+	// Children are always allocated after their parent, so a reverse sweep visits them first.
+	for (auto index = nodes_.size(); index-- > 0;)
+	{
+		if (index > g_root && index < g_first_pair)
+		{
+			continue;
+		}
+
+		auto & node = nodes_[index];
+		Aabb bounds;
+		if (node.isLeaf())
+		{
+			for (auto i = node.leftOrFirst; i < node.leftOrFirst + node.count; ++i)
+			{
+				bounds.expand(boxes_[primitives_[i]]);
+			}
+		}
+		else
+		{
+			for (const auto child : {node.leftOrFirst, node.leftOrFirst + 1})
+			{
+				bounds.expand(Aabb{nodes_[child].min, nodes_[child].max});
+			}
+		}
+		node.min = bounds.min;
+		node.max = bounds.max;
+	}
+}
+
+void Bvh::markSubtree(const std::uint32_t nodeIndex, std::vector<std::uint8_t> & visible, size_t & visibleCount) const
+{
+	std::vector<std::uint32_t> stack{nodeIndex};
+	while (!stack.empty())
+	{
+		const auto & node = nodes_[stack.back()];
+		stack.pop_back();
+
+		if (node.isLeaf())
+		{
+			for (auto i = node.leftOrFirst; i < node.leftOrFirst + node.count; ++i)
+			{
+				visible[primitives_[i]] = 1;
+			}
+			visibleCount += node.count;
+		}
+		else
+		{
+			stack.push_back(node.leftOrFirst);
+			stack.push_back(node.leftOrFirst + 1);
+		}
+	}
+}
+
+size_t Bvh::cull(const Frustum & frustum, std::vector<std::uint8_t> & visible) const
+{
+	visible.assign(boxes_.size(), 0);
+	if (empty())
+	{
+		return 0;
+	}
+
+	CullStack stack{{g_root, g_all_planes}};
+	return cullNodes(frustum, stack, visible, 0);
+}
+
+size_t Bvh::cull(const Frustum & frustum, std::vector<std::uint8_t> & visible, JobSystem & jobs) const
+{
+	visible.assign(boxes_.size(), 0);
+	if (empty())
+	{
+		return 0;
+	}
+
+	// Expand the top of the tree level by level until there are a few subtrees per thread,
+	// then cull those in parallel. Every primitive lives in exactly one leaf, so the subtrees
+	// write disjoint entries of visible.
+	const auto taskCount = g_cull_tasks_per_thread * jobs.threadCount();
+	CullStack frontier{{g_root, g_all_planes}};
+	size_t topCount = 0;
+	while (!frontier.empty() && frontier.size() < taskCount)
+	{
+		CullStack next;
+		for (const auto & entry : frontier)
+		{
+			// Stops right after the node pushed its two children.
+			CullStack expanded{entry};
+			topCount += cullNodes(frustum, expanded, visible, 2);
+			next.insert(next.end(), expanded.begin(), expanded.end());
+		}
+		frontier = std::move(next);
+	}
+
+	std::atomic<size_t> visibleCount{topCount};
+	jobs.parallelFor(0, frontier.size(), 1, [&](const size_t first, const size_t last) {
+		size_t count = 0;
+		for (auto task = first; task < last; ++task)
+		{
+			CullStack stack{frontier[task]};
+			count += cullNodes(frustum, stack, visible, 0);
+		}
+		visibleCount.fetch_add(count, std::memory_order_relaxed);
+	});
+
+	return visibleCount.load();
+}
+
+size_t Bvh::cullNodes(const Frustum & frustum, CullStack & stack, std::vector<std::uint8_t> & visible, const size_t splitAt) const
+{
+	size_t visibleCount = 0;
+
+	// Every entry carries the planes its parent was not yet fully inside of.
+	while (!stack.empty() && (splitAt == 0 || stack.size() < splitAt))
+	{
+		const auto [nodeIndex, parentPlanes] = stack.back();
+		stack.pop_back();
+
+		const auto & node = nodes_[nodeIndex];
+		auto planes = parentPlanes;
+		bool outside = false;
+
+		for (size_t p = 0; p < frustum.planes.size() && !outside; ++p)
+		{
+			if ((planes & (1u << p)) == 0)
+			{
+				continue;
+			}
+			const auto test = testPlane(frustum.planes[p], node.min, node.max);
+			outside = test == PlaneTest::Outside;
+			if (test == PlaneTest::Inside)
+			{
+				planes &= ~(1u << p);
+			}
+		}
+
+		if (outside)
+		{
+			continue;
+		}
+
+		if (planes == 0)
+		{
+			markSubtree(nodeIndex, visible, visibleCount);
+		}
+		else if (node.isLeaf())
+		{
+			for (auto i = node.leftOrFirst; i < node.leftOrFirst + node.count; ++i)
+			{
+				const auto & box = boxes_[primitives_[i]];
+				const auto primitiveVisible = std::none_of(frustum.planes.begin(), frustum.planes.end(), [&](const auto & plane) {
+					return testPlane(plane, box.min, box.max) == PlaneTest::Outside;
+				});
+				if (primitiveVisible)
+				{
+					visible[primitives_[i]] = 1;
+					++visibleCount;
+				}
+			}
+		}
+		else
+		{
+			stack.emplace_back(node.leftOrFirst, planes);
+			stack.emplace_back(node.leftOrFirst + 1, planes);
+		}
+	}
+
+	return visibleCount;
+}
+
+auto Bvh::raycast(const glm::vec3 & origin, const glm::vec3 & direction) const -> Hit
+{
+	return raycast(origin, direction, Refine{});
+}
+
+auto Bvh::raycast(const glm::vec3 & origin, const glm::vec3 & direction, const Refine & refine) const -> Hit
+{
+	Hit hit;
+	if (empty())
+	{
+		return hit;
+	}
+
+	const auto inverseDirection = 1.0f / direction;
+	std::vector<std::pair<std::uint32_t, float>> stack{{g_root, intersect(nodes_[g_root].min, nodes_[g_root].max, origin, inverseDirection, hit.distance)}};
+
+	while (!stack.empty())
+	{
+		const auto [nodeIndex, entry] = stack.back();
+		stack.pop_back();
+		if (entry >= hit.distance)
+		{
+			continue;
+		}
+
+		const auto & node = nodes_[nodeIndex];
+		if (node.isLeaf())
+		{
+			for (auto i = node.leftOrFirst; i < node.leftOrFirst + node.count; ++i)
+			{
+				const auto & box = boxes_[primitives_[i]];
+				auto distance = intersect(box.min, box.max, origin, inverseDirection, hit.distance);
+				if (refine && distance < hit.distance)
+				{
+					distance = refine(primitives_[i], distance);
+				}
+				if (distance < hit.distance)
+				{
+					hit = Hit{static_cast<int>(primitives_[i]), distance};
+				}
+			}
+			continue;
+		}
+
+		// Push the farther child first so the nearer one is visited next.
+		auto nearChild = std::make_pair(node.leftOrFirst, intersect(nodes_[node.leftOrFirst].min, nodes_[node.leftOrFirst].max, origin, inverseDirection, hit.distance));
+		auto farChild = std::make_pair(node.leftOrFirst + 1, intersect(nodes_[node.leftOrFirst + 1].min, nodes_[node.leftOrFirst + 1].max, origin, inverseDirection, hit.distance));
+		if (farChild.second < nearChild.second)
+		{
+			std::swap(nearChild, farChild);
+		}
+		if (farChild.second < hit.distance)
+		{
+			stack.push_back(farChild);
+		}
+		if (nearChild.second < hit.distance)
+		{
+			stack.push_back(nearChild);
+		}
+	}
+
+	return hit;
+}
+
+auto Bvh::nearest(const glm::vec3 & point) const -> Hit
+{
+	Hit hit;
+	if (empty())
+	{
+		return hit;
+	}
+
+	std::vector<std::pair<std::uint32_t, float>> stack{{g_root, distance(nodes_[g_root].min, nodes_[g_root].max, point)}};
+
+	while (!stack.empty())
+	{
+		const auto [nodeIndex, bound] = stack.back();
+		stack.pop_back();
+		if (bound >= hit.distance)
+		{
+			continue;
+		}
+
+		const auto & node = nodes_[nodeIndex];
+		if (node.isLeaf())
+		{
+			for (auto i = node.leftOrFirst; i < node.leftOrFirst + node.count; ++i)
+			{
+				const auto & box = boxes_[primitives_[i]];
+				const auto boxDistance = distance(box.min, box.max, point);
+				if (boxDistance < hit.distance)
+				{
+					hit = Hit{static_cast<int>(primitives_[i]), boxDistance};
+				}
+			}
+			continue;
+		}
+
+		auto nearChild = std::make_pair(node.leftOrFirst, distance(nodes_[node.leftOrFirst].min, nodes_[node.leftOrFirst].max, point));
+		auto farChild = std::make_pair(node.leftOrFirst + 1, distance(nodes_[node.leftOrFirst + 1].min, nodes_[node.leftOrFirst + 1].max, point));
+		if (farChild.second < nearChild.second)
+		{
+			std::swap(nearChild, farChild);
+		}
+		stack.push_back(farChild);
+		stack.push_back(nearChild);
+	}
+
+	return hit;
+}
@@ -0,0 +1,115 @@
+#pragma once
+
+#include "Bounds.h"
+#include "JobSystem.h"
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <limits>
+#include <new>
+#include <utility>
+#include <vector>
+
+// std::allocator replacement handing out over-aligned storage.
+template<typename T, std::size_t Alignment>
+struct AlignedAllocator
+{
+	using value_type = T;
+
+	template<typename U>
+	struct rebind
+	{
+		using other = AlignedAllocator<U, Alignment>;
+	};
+
+	AlignedAllocator() noexcept = default;
+	template<typename U>
+	AlignedAllocator(const AlignedAllocator<U, Alignment> &) noexcept {}
+
+	T * allocate(const std::size_t count)
+	{
+		return static_cast<T *>(::operator new(count * sizeof(T), std::align_val_t{Alignment}));
+	}
+
+	void deallocate(T * pointer, std::size_t) noexcept
+	{
+		::operator delete(pointer, std::align_val_t{Alignment});
+	}
+
+	template<typename U>
+	bool operator==(const AlignedAllocator<U, Alignment> &) const noexcept { return true; }
+	template<typename U>
+	bool operator!=(const AlignedAllocator<U, Alignment> &) const noexcept { return false; }
+};
+
+// Bounding volume hierarchy over primitive boxes, built with a binned surface area heuristic.
+// Nodes are 32 bytes and siblings are allocated as aligned pairs, so both children of a node
+// share one cache line. Subtrees are built on the job system at load time; moving primitives
+// are handled by refit(), which keeps the topology.
+class Bvh final
+{
+public:
+	static constexpr size_t CacheLine = 64;
+
+	struct alignas(32) Node
+	{
+		glm::vec3 min;
+		std::uint32_t leftOrFirst;// first child of an interior node, first primitive of a leaf
+		glm::vec3 max;
+		std::uint32_t count;      // primitives in a leaf, 0 for interior nodes
+
+		[[nodiscard]] bool isLeaf() const noexcept { return count != 0; }
+	};
+	static_assert(sizeof(Node) == 32, "two nodes must fit into a cache line");
+
+	struct Hit
+	{
+		int primitive = -1;
+		float distance = std::numeric_limits<float>::infinity();
+	};
+
+public:
+	void build(const std::vector<Aabb> & boxes);
+	void build(const std::vector<Aabb> & boxes, JobSystem & jobs);
+	void refit(const std::vector<Aabb> & boxes);
+
+	// Writes 1 into visible[i] for every primitive whose box intersects the frustum.
+	size_t cull(const Frustum & frustum, std::vector<std::uint8_t> & visible) const;
+	size_t cull(const Frustum & frustum, std::vector<std::uint8_t> & visible, JobSystem & jobs) const;
+
+	// Closest primitive box hit by the ray, distances in units of direction.
+	[[nodiscard]] Hit raycast(const glm::vec3 & origin, const glm::vec3 & direction) const;
+	// Closest primitive hit when refine(primitive, entry) replaces the box entry distance of every
+	// box the ray enters, infinity for a miss. Primitives must lie inside their boxes, so refine
+	// never returns less than entry and farther boxes are still skipped.
+	using Refine = std::function<float(std::uint32_t primitive, float entry)>;
+	[[nodiscard]] Hit raycast(const glm::vec3 & origin, const glm::vec3 & direction, const Refine & refine) const;
+
+	// Primitive box closest to the point, distance 0 when the point is inside one.
+	[[nodiscard]] Hit nearest(const glm::vec3 & point) const;
+
+	[[nodiscard]] bool empty() const noexcept { return nodes_.empty(); }
+	[[nodiscard]] size_t nodeCount() const noexcept { return nodes_.size(); }
+	[[nodiscard]] size_t primitiveCount() const noexcept { return boxes_.size(); }
+
+private:
+	void build(const std::vector<Aabb> & boxes, JobSystem * jobs);
+	// Large subtrees split into two jobs when a job system is given.
+	void buildNode(std::uint32_t nodeIndex, std::uint32_t first, std::uint32_t count, JobSystem * jobs);
+	// Pairs of node index and the frustum planes still to test against it.
+	using CullStack = std::vector<std::pair<std::uint32_t, std::uint32_t>>;
+
+	// Culls until the stack is empty, or stops early once it holds splitAt entries.
+	size_t cullNodes(const Frustum & frustum, CullStack & stack, std::vector<std::uint8_t> & visible, size_t splitAt) const;
+	void markSubtree(std::uint32_t nodeIndex, std::vector<std::uint8_t> & visible, size_t & visibleCount) const;
+
+private:
+	std::vector<Node, AlignedAllocator<Node, CacheLine>> nodes_;
+	std::vector<std::uint32_t> primitives_;
+	std::vector<Aabb> boxes_;
+	std::vector<glm::vec3> centroids_;
+
+	std::atomic<std::uint32_t> nodeCursor_{0};
+};
@@ -0,0 +1,71 @@
+#include "CullBenchmark.h"
+
+#include <QElapsedTimer>
+
+#include <glm/gtc/matrix_transform.hpp>
+
+#include <algorithm>
+#include <random>
+#include <vector>
+
+namespace
+{
+// Boxes fill [-g_scene_extent, g_scene_extent] on every axis.
+constexpr float g_scene_extent = 100.0f;
+constexpr float g_min_box_size = 0.1f;
+constexpr float g_max_box_size = 2.0f;
+
+template<class Function>
+double bestMs(Function && function)
+{
+	QElapsedTimer clock;
+	qint64 best = 0;
+	for (size_t round = 0; round < CullBenchmark::Rounds; ++round)
+	{
+		clock.start();
+		function();
+		const auto elapsed = clock.nsecsElapsed();
+		best = round == 0 ? elapsed : std::min(best, elapsed);
+	}
+	return static_cast<double>(best) / 1e6;
+}
+}// namespace
+
+auto CullBenchmark::run(JobSystem & jobs, const size_t boxes) -> Result
+{
+	std::mt19937 random(42);
+	std::uniform_real_distribution<float> coordinate(-g_scene_extent, g_scene_extent);
+	std::uniform_real_distribution<float> size(g_min_box_size, g_max_box_size);
+
+	std::vector<Aabb> bounds(boxes);
+	FrustumCuller culler;
+	culler.resize(boxes);
+	for (size_t i = 0; i < boxes; ++i)
+	{
+		const glm::vec3 center(coordinate(random), coordinate(random), coordinate(random));
+		const auto half = 0.5f * glm::vec3(size(random), size(random), size(random));
+		bounds[i] = Aabb{center - half, center + half};
+		culler.setBox(i, bounds[i]);
+	}
+
+	// from the middle of the cube towards one face, as from inside a scene, a few percent of the boxes are in view
+	const auto view = glm::lookAt(glm::vec3(0.0f), glm::vec3(0.0f, 0.0f, -1.0f), glm::vec3(0.0f, 1.0f, 0.0f));
+	const auto projection = glm::perspective(glm::radians(45.0f), 16.0f / 9.0f, 0.1f, g_scene_extent);
+	const auto frustum = Frustum::fromMatrix(projection * view);
+
+	Result result;
+	result.boxes = boxes;
+
+	Bvh bvh;
+	QElapsedTimer clock;
+	clock.start();
+	bvh.build(bounds, jobs);
+	result.buildMs = static_cast<double>(clock.nsecsElapsed()) / 1e6;
+
+	std::vector<std::uint8_t> linearVisible;
+	std::vector<std::uint8_t> bvhVisible;
+	result.linearMs = bestMs([&] { result.visible = culler.cull(frustum, linearVisible); });
+	result.bvhMs = bestMs([&] { static_cast<void>(bvh.cull(frustum, bvhVisible)); });
+	result.identical = linearVisible == bvhVisible;
+	return result;
+}
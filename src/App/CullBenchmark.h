@@ -0,0 +1,30 @@
+#pragma once
+
+#include "Bvh.h"
+#include "FrustumCuller.h"
+
+#include <cstddef>
+
+// Times the linear SIMD frustum sweep of FrustumCuller against the hierarchical cull of Bvh
+// on random boxes scattered through a cube in front of a perspective camera, both on the
+// calling thread, and checks that they mark the same boxes visible. The boxes and the camera
+// come from a fixed seed, so runs on the same machine are comparable.
+class CullBenchmark final
+{
+public:
+	// Time is the best of this many runs.
+	static constexpr size_t Rounds = 10;
+
+	struct Result
+	{
+		size_t boxes = 0;
+		size_t visible = 0;
+		double linearMs = 0.0;
+		double bvhMs = 0.0;
+		double buildMs = 0.0;// BVH build on the job system
+		bool identical = false;
+	};
+
+public:
+	[[nodiscard]] static Result run(JobSystem & jobs, size_t boxes);
+};
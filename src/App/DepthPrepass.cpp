@@ -0,0 +1,133 @@
+#include "DepthPrepass.h"
+
+#ifndef GL_SAMPLES_PASSED
+#define GL_SAMPLES_PASSED 0x8914
+#endif
+
+DepthPrepass::~DepthPrepass()
+{
+	// GL objects are expected to be released with destroy() while the context is current.
+	Q_ASSERT(queries_.front().front() == 0);
+}
+
+void DepthPrepass::create(fgl::FramePipeline & pipeline)
+{
+	initializeOpenGLFunctions();
+	pipeline_ = &pipeline;
+	for (auto & queries : queries_)
+	{
+		glGenQueries(static_cast<GLsizei>(queries.size()), queries.data());
+	}
+	issued_.fill(false);
+}
+
+void DepthPrepass::destroy()
+{
+	for (auto & queries : queries_)
+	{
+		if (queries.front() != 0)
+		{
+			glDeleteQueries(static_cast<GLsizei>(queries.size()), queries.data());
+			queries.fill(0);
+		}
+	}
+}
+
+bool DepthPrepass::beginFrame()
+{
+	const auto slot = pipeline_->slot();
+	if (issued_[slot])
+	{
+		collect(slot);
+	}
+
+	switch (mode_)
+	{
+		case Mode::Off:
+			enabled_ = false;
+			break;
+		case Mode::On:
+			enabled_ = true;
+			break;
+		case Mode::Auto:
+			// while off, a probe frame now and then tells whether overdraw has grown
+			enabled_ = wanted_ || ++framesSinceProbe_ >= ProbeInterval;
+			if (enabled_)
+			{
+				framesSinceProbe_ = 0;
+			}
+			break;
+	}
+
+	measuring_ = enabled_;
+	issued_[slot] = measuring_;
+	return enabled_;
+}
+
+void DepthPrepass::beginQuery(const Query query)
+{
+	if (measuring_)
+	{
+		glBeginQuery(GL_SAMPLES_PASSED, queries_[pipeline_->slot()][query]);
+	}
+}
+
+void DepthPrepass::endQuery([[maybe_unused]] const Query query)
+{
+	if (measuring_)
+	{
+		glEndQuery(GL_SAMPLES_PASSED);
+	}
+}
+
+void DepthPrepass::collect(const size_t slot)
+{
+	issued_[slot] = false;
+
+	// The slot's fence has signaled, results should be there; never wait for them.
+	GLuint available = 0;
+	glGetQueryObjectuiv(queries_[slot][ShadingQuery], GL_QUERY_RESULT_AVAILABLE, &available);
+	if (available == 0)
+	{
+		return;
+	}
+
+	GLuint depthSamples = 0;
+	GLuint shadedSamples = 0;
+	glGetQueryObjectuiv(queries_[slot][DepthQuery], GL_QUERY_RESULT, &depthSamples);
+	glGetQueryObjectuiv(queries_[slot][ShadingQuery], GL_QUERY_RESULT, &shadedSamples);
+	if (shadedSamples == 0)
+	{
+		return;
+	}
+
+	// Depth samples passing GL_LESS are what shading would cost without the pre-pass.
+	overdraw_ = static_cast<double>(depthSamples) / static_cast<double>(shadedSamples);
+	wanted_ = overdraw_ >= (wanted_ ? DisableOverdraw : EnableOverdraw);
+}
+
+const char * DepthPrepass::modeName(const Mode mode) noexcept
+{
+	switch (mode)
+	{
+		case Mode::Off:
+			return "off";
+		case Mode::On:
+			return "on";
+		case Mode::Auto:
+			return "auto";
+	}
+	return "";
+}
+
+std::optional<DepthPrepass::Mode> DepthPrepass::parseMode(const QString & name)
+{
+	for (const auto mode : {Mode::Off, Mode::On, Mode::Auto})
+	{
+		if (name == QLatin1String(modeName(mode)))
+		{
+			return mode;
+		}
+	}
+	return std::nullopt;
+}
@@ -0,0 +1,87 @@
+#pragma once
+
+#include <Base/FramePipeline.hpp>
+
+#include <QOpenGLExtraFunctions>
+#include <QString>
+
+#include <array>
+#include <cstddef>
+#include <optional>
+
+// Decides whether a frame lays down depth in a separate pass before shading.
+// With the pre-pass the shading pass tests GL_EQUAL, so every covered sample is shaded
+// once; without it, overdrawn fragments pay for texture fetches and lighting too.
+// In Auto mode the decision follows the measured overdraw: sample counts of both passes
+// are queried in frames that run the pre-pass, and while it is off a probe frame runs
+// it every ProbeInterval frames. Query results are read once their slot's fence has
+// signaled, so measuring never stalls.
+class DepthPrepass final : protected QOpenGLExtraFunctions
+{
+public:
+	enum class Mode
+	{
+		Off,
+		On,
+		Auto,
+	};
+
+	enum Query : size_t
+	{
+		DepthQuery,
+		ShadingQuery,
+		QueryCount,
+	};
+
+	static constexpr size_t ProbeInterval = 120;
+	// Hysteresis around the overdraw where the extra geometry pass starts to pay off.
+	static constexpr double EnableOverdraw = 1.5;
+	static constexpr double DisableOverdraw = 1.25;
+
+public:
+	DepthPrepass() = default;
+	~DepthPrepass();
+
+	DepthPrepass(const DepthPrepass &) = delete;
+	DepthPrepass(DepthPrepass &&) = delete;
+	DepthPrepass & operator=(const DepthPrepass &) = delete;
+	DepthPrepass & operator=(DepthPrepass &&) = delete;
+
+public:
+	void setMode(Mode mode) noexcept { mode_ = mode; }
+	[[nodiscard]] Mode mode() const noexcept { return mode_; }
+
+	// Both require a current context.
+	void create(fgl::FramePipeline & pipeline);
+	void destroy();
+
+	// Collects the results of the slot's previous frame and decides for this one.
+	[[nodiscard]] bool beginFrame();
+
+	// Sample counting around the draws of a pass, only in frames that run the pre-pass.
+	void beginQuery(Query query);
+	void endQuery(Query query);
+
+	[[nodiscard]] bool enabled() const noexcept { return enabled_; }
+	// Rasterized depth samples per shaded sample, 0 until measured.
+	[[nodiscard]] double overdraw() const noexcept { return overdraw_; }
+
+	[[nodiscard]] static const char * modeName(Mode mode) noexcept;
+	[[nodiscard]] static std::optional<Mode> parseMode(const QString & name);
+
+private:
+	void collect(size_t slot);
+
+private:
+	fgl::FramePipeline * pipeline_ = nullptr;
+	Mode mode_ = Mode::Auto;
+
+	std::array<std::array<GLuint, QueryCount>, fgl::FramePipeline::MaxFramesInFlight> queries_{};
+	std::array<bool, fgl::FramePipeline::MaxFramesInFlight> issued_{};
+	bool measuring_ = false;
+
+	bool enabled_ = false;
+	bool wanted_ = false;// Auto decision, probe frames run the pre-pass regardless
+	double overdraw_ = 0.0;
+	size_t framesSinceProbe_ = 0;
+};
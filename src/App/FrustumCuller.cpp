@@ -0,0 +1,148 @@
+#include "FrustumCuller.h"
+
+#include <cmath>
+
+#if defined(__AVX__)
+#define FGL_CULL_AVX 1
+#include <immintrin.h>
+#elif defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define FGL_CULL_SSE 1
+#include <emmintrin.h>
+#endif
+
+namespace
+{
+// A box is outside if it lies entirely behind any plane: dot(n, c) + d + dot(|n|, e) < 0.
+bool isVisible(const Frustum & frustum, const float cx, const float cy, const float cz,
+			   const float ex, const float ey, const float ez)
+{
+	for (const auto & plane : frustum.planes)
+	{
+		const auto distance = plane.x * cx + plane.y * cy + plane.z * cz + plane.w;
+		const auto radius = std::abs(plane.x) * ex + std::abs(plane.y) * ey + std::abs(plane.z) * ez;
+		if (distance + radius < 0.0f)
+		{
+			return false;
+		}
+	}
+	return true;
+}
+}// namespace
+
+void FrustumCuller::resize(const size_t count)
+{
+	centerX_.resize(count);
+	centerY_.resize(count);
+	centerZ_.resize(count);
+	extentX_.resize(count);
+	extentY_.resize(count);
+	extentZ_.resize(count);
+}
+
+void FrustumCuller::setBox(const size_t index, const Aabb & box)
+{
+	const auto center = box.center();
+	const auto extent = box.extent();
+	centerX_[index] = center.x;
+	centerY_[index] = center.y;
+	centerZ_[index] = center.z;
+	extentX_[index] = extent.x;
+	extentY_[index] = extent.y;
+	extentZ_[index] = extent.z;
+}
+
+size_t FrustumCuller::cull(const Frustum & frustum, std::vector<std::uint8_t> & visible) const
+{
+	const auto count = size();
+	visible.resize(count);
+
+	size_t index = 0;
+	size_t visibleCount = 0;
+
+#if defined(FGL_CULL_AVX)
+	for (; index + 8 <= count; index += 8)
+	{
+		const auto cx = _mm256_loadu_ps(&centerX_[index]);
+		const auto cy = _mm256_loadu_ps(&centerY_[index]);
+		const auto cz = _mm256_loadu_ps(&centerZ_[index]);
+		const auto ex = _mm256_loadu_ps(&extentX_[index]);
+		const auto ey = _mm256_loadu_ps(&extentY_[index]);
+		const auto ez = _mm256_loadu_ps(&extentZ_[index]);
+
+		auto inside = _mm256_castsi256_ps(_mm256_set1_epi32(-1));
+		for (const auto & plane : frustum.planes)
+		{
+			auto distance = _mm256_add_ps(_mm256_mul_ps(_mm256_set1_ps(plane.x), cx), _mm256_set1_ps(plane.w));
+			distance = _mm256_add_ps(distance, _mm256_mul_ps(_mm256_set1_ps(plane.y), cy));
+			distance = _mm256_add_ps(distance, _mm256_mul_ps(_mm256_set1_ps(plane.z), cz));
+
+			auto radius = _mm256_mul_ps(_mm256_set1_ps(std::abs(plane.x)), ex);
+			radius = _mm256_add_ps(radius, _mm256_mul_ps(_mm256_set1_ps(std::abs(plane.y)), ey));
+			radius = _mm256_add_ps(radius, _mm256_mul_ps(_mm256_set1_ps(std::abs(plane.z)), ez));
+
+			inside = _mm256_and_ps(inside, _mm256_cmp_ps(_mm256_add_ps(distance, radius), _mm256_setzero_ps(), _CMP_GE_OQ));
+		}
+
+		const auto mask = _mm256_movemask_ps(inside);
+		for (int lane = 0; lane < 8; ++lane)
+		{
+			const auto laneVisible = (mask >> lane) & 1;
+			visible[index + lane] = static_cast<std::uint8_t>(laneVisible);
+			visibleCount += static_cast<size_t>(laneVisible);
+		}
+	}
+#elif defined(FGL_CULL_SSE)
+	for (; index + 4 <= count; index += 4)
+	{
+		const auto cx = _mm_loadu_ps(&centerX_[index]);
+		const auto cy = _mm_loadu_ps(&centerY_[index]);
+		const auto cz = _mm_loadu_ps(&centerZ_[index]);
+		const auto ex = _mm_loadu_ps(&extentX_[index]);
+		const auto ey = _mm_loadu_ps(&extentY_[index]);
+		const auto ez = _mm_loadu_ps(&extentZ_[index]);
+
+		auto inside = _mm_castsi128_ps(_mm_set1_epi32(-1));
+		for (const auto & plane : frustum.planes)
+		{
+			auto distance = _mm_add_ps(_mm_mul_ps(_mm_set1_ps(plane.x), cx), _mm_set1_ps(plane.w));
+			distance = _mm_add_ps(distance, _mm_mul_ps(_mm_set1_ps(plane.y), cy));
+			distance = _mm_add_ps(distance, _mm_mul_ps(_mm_set1_ps(plane.z), cz));
+
+			auto radius = _mm_mul_ps(_mm_set1_ps(std::abs(plane.x)), ex);
+			radius = _mm_add_ps(radius, _mm_mul_ps(_mm_set1_ps(std::abs(plane.y)), ey));
+			radius = _mm_add_ps(radius, _mm_mul_ps(_mm_set1_ps(std::abs(plane.z)), ez));
+
+			inside = _mm_and_ps(inside, _mm_cmpge_ps(_mm_add_ps(distance, radius), _mm_setzero_ps()));
+		}
+
+		const auto mask = _mm_movemask_ps(inside);
+		for (int lane = 0; lane < 4; ++lane)
+		{
+			const auto laneVisible = (mask >> lane) & 1;
+			visible[index + lane] = static_cast<std::uint8_t>(laneVisible);
+			visibleCount += static_cast<size_t>(laneVisible);
+		}
+	}
+#endif
+
+	for (; index < count; ++index)
+	{
+		const bool boxVisible = isVisible(frustum, centerX_[index], centerY_[index], centerZ_[index],
+										  extentX_[index], extentY_[index], extentZ_[index]);
+		visible[index] = boxVisible ? 1 : 0;
+		visibleCount += boxVisible ? 1 : 0;
+	}
+
+	return visibleCount;
+}
+
+const char * FrustumCuller::kernelName() noexcept
+{
+#if defined(FGL_CULL_AVX)
+	return "avx";
+#elif defined(FGL_CULL_SSE)
+	return "sse2";
+#else
+	return "scalar";
+#endif
+}
@@ -0,0 +1,32 @@
+#pragma once
+
+#include "Bounds.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// World-space boxes kept as center/extent arrays so the frustum test runs
+// 8 (AVX) or 4 (SSE) boxes per iteration, with a scalar fallback elsewhere.
+class FrustumCuller final
+{
+public:
+	void resize(size_t count);
+	void setBox(size_t index, const Aabb & box);
+
+	// Writes 1 into visible[i] for every box intersecting the frustum and returns the visible count.
+	size_t cull(const Frustum & frustum, std::vector<std::uint8_t> & visible) const;
+
+	[[nodiscard]] size_t size() const noexcept { return centerX_.size(); }
+
+	// Name of the kernel compiled into this build.
+	[[nodiscard]] static const char * kernelName() noexcept;
+
+private:
+	std::vector<float> centerX_;
+	std::vector<float> centerY_;
+	std::vector<float> centerZ_;
+	std::vector<float> extentX_;
+	std::vector<float> extentY_;
+	std::vector<float> extentZ_;
+};
@@ -0,0 +1,97 @@
+#include "GltfAccessors.h"
+
+#include <cstdint>
+#include <cstring>
+#include <iostream>
+
+namespace
+{
+size_t readIndex(const unsigned char * data, const int componentType, const size_t i)
+{
+	switch (componentType)
+	{
+		case TINYGLTF_COMPONENT_TYPE_UNSIGNED_BYTE:
+			return data[i];
+		case TINYGLTF_COMPONENT_TYPE_UNSIGNED_SHORT: {
+			std::uint16_t index = 0;
+			std::memcpy(&index, data + i * sizeof(index), sizeof(index));
+			return index;
+		}
+		default: {
+			std::uint32_t index = 0;
+			std::memcpy(&index, data + i * sizeof(index), sizeof(index));
+			return index;
+		}
+	}
+}
+
+template<class T>
+std::vector<T> readFloats(const tinygltf::Model & model, const tinygltf::Accessor & accessor, const int type, const char * typeName)
+{
+	std::vector<T> values(accessor.count, T(0.0f));
+	if (accessor.type != type || accessor.componentType != TINYGLTF_COMPONENT_TYPE_FLOAT)
+	{
+		std::cout << "glTF: only float " << typeName << " accessors are read" << std::endl;
+		return values;
+	}
+
+	if (accessor.bufferView >= 0)
+	{
+		const auto & view = model.bufferViews[accessor.bufferView];
+		const auto * data = model.buffers[view.buffer].data.data() + view.byteOffset + accessor.byteOffset;
+		const auto stride = static_cast<size_t>(accessor.ByteStride(view));
+		for (size_t i = 0; i < values.size(); ++i)
+		{
+			std::memcpy(&values[i], data + i * stride, sizeof(T));
+		}
+	}
+
+	if (accessor.sparse.isSparse)
+	{
+		const auto & indices = accessor.sparse.indices;
+		const auto & indexView = model.bufferViews[indices.bufferView];
+		const auto * indexData = model.buffers[indexView.buffer].data.data() + indexView.byteOffset + indices.byteOffset;
+
+		const auto & valueView = model.bufferViews[accessor.sparse.values.bufferView];
+		const auto * valueData = model.buffers[valueView.buffer].data.data() + valueView.byteOffset + accessor.sparse.values.byteOffset;
+
+		for (size_t i = 0; i < static_cast<size_t>(accessor.sparse.count); ++i)
+		{
+			const auto index = readIndex(indexData, indices.componentType, i);
+			if (index < values.size())
+			{
+				std::memcpy(&values[index], valueData + i * sizeof(T), sizeof(T));
+			}
+		}
+	}
+
+	return values;
+}
+}// namespace
+
+std::vector<glm::vec2> readVec2(const tinygltf::Model & model, const tinygltf::Accessor & accessor)
+{
+	return readFloats<glm::vec2>(model, accessor, TINYGLTF_TYPE_VEC2, "VEC2");
+}
+
+std::vector<glm::vec3> readVec3(const tinygltf::Model & model, const tinygltf::Accessor & accessor)
+{
+	return readFloats<glm::vec3>(model, accessor, TINYGLTF_TYPE_VEC3, "VEC3");
+}
+
+std::vector<std::uint32_t> readIndices(const tinygltf::Model & model, const tinygltf::Accessor & accessor)
+{
+	std::vector<std::uint32_t> indices(accessor.count, 0);
+	if (accessor.bufferView < 0)
+	{
+		return indices;
+	}
+
+	const auto & view = model.bufferViews[accessor.bufferView];
+	const auto * data = model.buffers[view.buffer].data.data() + view.byteOffset + accessor.byteOffset;
+	for (size_t i = 0; i < indices.size(); ++i)
+	{
+		indices[i] = static_cast<std::uint32_t>(readIndex(data, accessor.componentType, i));
+	}
+	return indices;
+}
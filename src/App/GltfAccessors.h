@@ -0,0 +1,17 @@
+#pragma once
+
+#include <glm/glm.hpp>
+
+#include <cstdint>
+#include <vector>
+
+#include <tinygltf/tiny_gltf.h>
+
+// Float VEC2 or VEC3 elements of an accessor with its sparse substitutions applied; an accessor
+// without a buffer view starts from zeros, as glTF specifies for sparse-only data.
+// Other component types are not read and give zeros.
+[[nodiscard]] std::vector<glm::vec2> readVec2(const tinygltf::Model & model, const tinygltf::Accessor & accessor);
+[[nodiscard]] std::vector<glm::vec3> readVec3(const tinygltf::Model & model, const tinygltf::Accessor & accessor);
+
+// Indices of an unsigned byte, short or int SCALAR accessor.
+[[nodiscard]] std::vector<std::uint32_t> readIndices(const tinygltf::Model & model, const tinygltf::Accessor & accessor);
@@ -0,0 +1,205 @@
+#include "JobSystem.h"
+
+#include <algorithm>
+
+namespace
+{
+// Idle rounds a worker spins through before it goes to sleep.
+constexpr int g_spin_rounds = 64;
+
+// Queue of the current thread, valid only for the system that owns the thread.
+thread_local const JobSystem * t_owner = nullptr;
+thread_local size_t t_queue = 0;
+}// namespace
+
+JobSystem::JobSystem(const size_t workerCount)
+{
+	// Queue 0 belongs to whichever outside thread submits work.
+	for (size_t queue = 0; queue <= workerCount; ++queue)
+	{
+		queues_.push_back(std::make_unique<Queue>());
+	}
+
+	workers_.reserve(workerCount);
+	for (size_t worker = 0; worker < workerCount; ++worker)
+	{
+		workers_.emplace_back([this, worker] { workerLoop(worker + 1); });
+	}
+}
+
+JobSystem::~JobSystem()
+{
+	{
+		const std::lock_guard lock{sleepMutex_};
+		stop_ = true;
+	}
+	wakeup_.notify_all();
+
+	for (auto & worker : workers_)
+	{
+		worker.join();
+	}
+}
+
+size_t JobSystem::defaultWorkerCount()
+{
+	const auto hardwareThreads = static_cast<size_t>(std::thread::hardware_concurrency());
+	return hardwareThreads > 1 ? hardwareThreads - 1 : 0;
+}
+
+void JobSystem::run(Counter & counter, std::function<void()> job)
+{
+	counter.pending_.fetch_add(1, std::memory_order_relaxed);
+
+	if (workers_.empty())
+	{
+		Job immediate{std::move(job), &counter};
+		execute(immediate);
+		return;
+	}
+
+	auto & queue = *queues_[currentQueue()];
+	{
+		const std::lock_guard lock{queue.mutex};
+		queue.jobs.push_back(Job{std::move(job), &counter});
+	}
+
+	// Taking the sleep mutex orders the push before any worker re-checks the predicate.
+	queued_.fetch_add(1, std::memory_order_release);
+	{
+		const std::lock_guard lock{sleepMutex_};
+	}
+	wakeup_.notify_one();
+}
+
+void JobSystem::wait(Counter & counter)
+{
+	const auto queueIndex = currentQueue();
+	while (!counter.done())
+	{
+		if (auto job = findJob(queueIndex))
+		{
+			execute(*job);
+		}
+		else
+		{
+			std::this_thread::yield();
+		}
+	}
+}
+
+void JobSystem::parallelFor(const size_t first, const size_t last, const size_t grain, const RangeFunction & body)
+{
+	if (first >= last)
+	{
+		return;
+	}
+
+	const auto chunk = std::max<size_t>(grain, 1);
+	if (last - first <= chunk || workers_.empty())
+	{
+		body(first, last);
+		return;
+	}
+
+	Counter counter;
+	split(counter, first, last, chunk, body);
+	wait(counter);
+}
+
+void JobSystem::invoke(const std::function<void()> & first, const std::function<void()> & second)
+{
+	Counter counter;
+	run(counter, second);
+	first();
+	wait(counter);
+}
+
+void JobSystem::workerLoop(const size_t queueIndex)
+{
+	t_owner = this;
+	t_queue = queueIndex;
+
+	auto idleRounds = 0;
+	while (true)
+	{
+		if (auto job = findJob(queueIndex))
+		{
+			execute(*job);
+			idleRounds = 0;
+			continue;
+		}
+
+		if (++idleRounds < g_spin_rounds)
+		{
+			std::this_thread::yield();
+			continue;
+		}
+
+		std::unique_lock lock{sleepMutex_};
+		wakeup_.wait(lock, [this] { return stop_ || queued_.load(std::memory_order_acquire) != 0; });
+		if (stop_)
+		{
+			return;
+		}
+		idleRounds = 0;
+	}
+}
+
+void JobSystem::split(Counter & counter, const size_t first, size_t last, const size_t grain, const RangeFunction & body)
+{
+	// Halves go to the deque as they are split off, so thieves take the largest pieces first.
+	while (last - first > grain)
+	{
+		const auto middle = first + (last - first) / 2;
+		run(counter, [this, &counter, middle, last, grain, &body] { split(counter, middle, last, grain, body); });
+		last = middle;
+	}
+	body(first, last);
+}
+
+size_t JobSystem::currentQueue() const noexcept
+{
+	return t_owner == this ? t_queue : 0;
+}
+
+auto JobSystem::findJob(const size_t queueIndex) -> std::optional<Job>
+{
+	if (queued_.load(std::memory_order_acquire) == 0)
+	{
+		return std::nullopt;
+	}
+
+	{
+		auto & own = *queues_[queueIndex];
+		const std::lock_guard lock{own.mutex};
+		if (!own.jobs.empty())
+		{
+			auto job = std::move(own.jobs.back());
+			own.jobs.pop_back();
+			queued_.fetch_sub(1, std::memory_order_relaxed);
+			return job;
+		}
+	}
+
+	for (size_t offset = 1; offset < queues_.size(); ++offset)
+	{
+		auto & victim = *queues_[(queueIndex + offset) % queues_.size()];
+		const std::lock_guard lock{victim.mutex};
+		if (!victim.jobs.empty())
+		{
+			auto job = std::move(victim.jobs.front());
+			victim.jobs.pop_front();
+			queued_.fetch_sub(1, std::memory_order_relaxed);
+			return job;
+		}
+	}
+
+	return std::nullopt;
+}
+
+void JobSystem::execute(Job & job)
+{
+	job.function();
+	job.counter->pending_.fetch_sub(1, std::memory_order_acq_rel);
+}
@@ -0,0 +1,93 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <thread>
+#include <vector>
+
+// Fork/join job system with one deque per thread. The owner pushes and pops at the back,
+// idle threads steal from the front of other deques, and a thread waiting for a join runs
+// pending jobs instead of blocking. The thread that created the system takes part through
+// wait() and owns the first deque; workers sleep while there is nothing to do.
+class JobSystem final
+{
+public:
+	// Join handle, counts jobs that have been forked and not finished yet.
+	class Counter final
+	{
+	public:
+		Counter() = default;
+		Counter(const Counter &) = delete;
+		Counter & operator=(const Counter &) = delete;
+
+		[[nodiscard]] bool done() const noexcept { return pending_.load(std::memory_order_acquire) == 0; }
+
+	private:
+		friend class JobSystem;
+		std::atomic<size_t> pending_{0};
+	};
+
+	using RangeFunction = std::function<void(size_t first, size_t last)>;
+
+public:
+	explicit JobSystem(size_t workerCount = defaultWorkerCount());
+	~JobSystem();
+
+	JobSystem(const JobSystem &) = delete;
+	JobSystem(JobSystem &&) = delete;
+	JobSystem & operator=(const JobSystem &) = delete;
+	JobSystem & operator=(JobSystem &&) = delete;
+
+public:
+	// Forks a job; it must stay valid until wait() on the same counter returns.
+	void run(Counter & counter, std::function<void()> job);
+
+	// Joins: runs pending jobs until everything forked on the counter is finished.
+	void wait(Counter & counter);
+
+	// Calls body on disjoint subranges of [first, last) no larger than grain, in parallel.
+	void parallelFor(size_t first, size_t last, size_t grain, const RangeFunction & body);
+
+	// Runs both functions, possibly in parallel, and returns when both are done.
+	void invoke(const std::function<void()> & first, const std::function<void()> & second);
+
+	// Workers plus the calling thread.
+	[[nodiscard]] size_t threadCount() const noexcept { return workers_.size() + 1; }
+
+	[[nodiscard]] static size_t defaultWorkerCount();
+
+private:
+	struct Job
+	{
+		std::function<void()> function;
+		Counter * counter = nullptr;
+	};
+
+	struct alignas(64) Queue
+	{
+		std::mutex mutex;
+		std::deque<Job> jobs;
+	};
+
+	void workerLoop(size_t queueIndex);
+	void split(Counter & counter, size_t first, size_t last, size_t grain, const RangeFunction & body);
+
+	[[nodiscard]] size_t currentQueue() const noexcept;
+	[[nodiscard]] std::optional<Job> findJob(size_t queueIndex);
+	static void execute(Job & job);
+
+private:
+	std::vector<std::unique_ptr<Queue>> queues_;
+	std::vector<std::thread> workers_;
+
+	std::atomic<size_t> queued_{0};
+	std::mutex sleepMutex_;
+	std::condition_variable wakeup_;
+	bool stop_ = false;
+};
@@ -0,0 +1,181 @@
+#include "Materials.h"
+
+#include <algorithm>
+#include <iostream>
+#include <map>
+#include <optional>
+#include <tuple>
+#include <utility>
+
+namespace
+{
+// Decoded glTF image as tightly packed RGBA8, missing channels filled like GL does.
+std::vector<std::uint8_t> toRgba8(const tinygltf::Image & image)
+{
+	const auto pixelCount = static_cast<size_t>(image.width) * static_cast<size_t>(image.height);
+	const auto components = static_cast<size_t>(image.component);
+	const auto bytesPerChannel = image.bits == 16 ? size_t{2} : size_t{1};
+
+	std::vector<std::uint8_t> rgba(pixelCount * 4);
+	for (size_t pixel = 0; pixel < pixelCount; ++pixel)
+	{
+		std::array<std::uint8_t, 4> value = {0, 0, 0, 255};
+		for (size_t channel = 0; channel < components && channel < 4; ++channel)
+		{
+			// 16-bit channels are little endian, keep the high byte
+			const auto byte = (pixel * components + channel) * bytesPerChannel + bytesPerChannel - 1;
+			value[channel] = image.image[byte];
+		}
+		if (components == 1 || components == 2)
+		{
+			// luminance(-alpha)
+			value[3] = components == 2 ? value[1] : value[3];
+			value[1] = value[0];
+			value[2] = value[0];
+		}
+		std::copy(value.begin(), value.end(), rgba.begin() + static_cast<std::ptrdiff_t>(pixel * 4));
+	}
+	return rgba;
+}
+
+glm::vec4 toVec4(const std::vector<double> & values, const glm::vec4 & fallback)
+{
+	auto result = fallback;
+	for (size_t i = 0; i < values.size() && i < 4; ++i)
+	{
+		result[static_cast<glm::length_t>(i)] = static_cast<float>(values[i]);
+	}
+	return result;
+}
+
+constexpr GLint g_no_layer = -1;
+
+// glTF filters and wraps are GL enums, filters are optional and fall back to trilinear.
+fgl::TextureSampler toSampler(const tinygltf::Model & model, const int sampler)
+{
+	fgl::TextureSampler result;
+	if (sampler < 0 || static_cast<size_t>(sampler) >= model.samplers.size())
+	{
+		return result;
+	}
+	const auto & gltf = model.samplers[sampler];
+	result.minFilter = gltf.minFilter >= 0 ? static_cast<GLenum>(gltf.minFilter) : result.minFilter;
+	result.magFilter = gltf.magFilter >= 0 ? static_cast<GLenum>(gltf.magFilter) : result.magFilter;
+	result.wrapS = static_cast<GLenum>(gltf.wrapS);
+	result.wrapT = static_cast<GLenum>(gltf.wrapT);
+	return result;
+}
+
+constexpr std::array<ShaderFeature, MaterialTextureCount> g_texture_features = {
+	BaseColorMapFeature, NormalMapFeature, MetallicRoughnessMapFeature, OcclusionMapFeature, EmissiveMapFeature};
+}// namespace
+
+void MaterialLibrary::load(const tinygltf::Model & model, fgl::TextureArrayAtlas & atlas, const QImage & fallback)
+{
+	using Entry = fgl::TextureArrayAtlas::Entry;
+	using Slots = std::array<std::optional<Entry>, MaterialTextureCount>;
+
+	// images used by several materials or textures share a layer, per storage format and sampler
+	std::map<std::tuple<int, GLenum, fgl::TextureSampler>, std::optional<Entry>> images;
+	const auto addTexture = [&](const int texture, const GLenum internalFormat) -> std::optional<Entry> {
+		if (texture < 0 || static_cast<size_t>(texture) >= model.textures.size())
+		{
+			return std::nullopt;
+		}
+		const auto source = model.textures[texture].source;
+		if (source < 0 || static_cast<size_t>(source) >= model.images.size())
+		{
+			return std::nullopt;
+		}
+
+		const auto sampler = toSampler(model, model.textures[texture].sampler);
+		const auto [it, inserted] = images.try_emplace({source, internalFormat, sampler});
+		const tinygltf::Image & image = model.images[source];
+		if (inserted && !image.image.empty())
+		{
+			const auto rgba = toRgba8(image);
+			it->second = atlas.add(image.width, image.height, rgba.data(), internalFormat, sampler);
+		}
+		return it->second;
+	};
+
+	blocks_.clear();
+	materials_.clear();
+	std::vector<Slots> slotEntries;
+
+	for (const auto & material : model.materials)
+	{
+		const auto & pbr = material.pbrMetallicRoughness;
+
+		MaterialBlock block{};
+		block.baseColorFactor = toVec4(pbr.baseColorFactor, glm::vec4(1.0f));
+		block.emissiveFactor = toVec4(material.emissiveFactor, glm::vec4(0.0f));
+		block.metallicFactor = static_cast<GLfloat>(pbr.metallicFactor);
+		block.roughnessFactor = static_cast<GLfloat>(pbr.roughnessFactor);
+		block.normalScale = static_cast<GLfloat>(material.normalTexture.scale);
+		block.occlusionStrength = static_cast<GLfloat>(material.occlusionTexture.strength);
+		block.alphaCutoff = material.alphaMode == "MASK" ? static_cast<GLfloat>(material.alphaCutoff) : -1.0f;
+		blocks_.push_back(block);
+
+		Slots textures;
+		textures[BaseColorTexture] = addTexture(pbr.baseColorTexture.index, GL_SRGB8_ALPHA8);
+		textures[NormalTexture] = addTexture(material.normalTexture.index, GL_RGBA8);
+		textures[MetallicRoughnessTexture] = addTexture(pbr.metallicRoughnessTexture.index, GL_RGBA8);
+		textures[OcclusionTexture] = addTexture(material.occlusionTexture.index, GL_RGBA8);
+		textures[EmissiveTexture] = addTexture(material.emissiveTexture.index, GL_SRGB8_ALPHA8);
+		slotEntries.push_back(textures);
+
+		materials_.push_back(Material{{}, material.doubleSided, material.alphaMode == "BLEND"});
+	}
+
+	// default material: white dielectric with the fallback image, as the model had before materials
+	{
+		MaterialBlock block{};
+		block.baseColorFactor = glm::vec4(1.0f);
+		block.emissiveFactor = glm::vec4(0.0f);
+		block.metallicFactor = 0.0f;
+		block.roughnessFactor = 1.0f;
+		block.normalScale = 1.0f;
+		block.occlusionStrength = 1.0f;
+		block.alphaCutoff = -1.0f;
+		blocks_.push_back(block);
+
+		const auto image = fallback.convertToFormat(QImage::Format_RGBA8888);
+		Slots textures;
+		textures[BaseColorTexture] = atlas.add(image.width(), image.height(), image.constBits(), GL_SRGB8_ALPHA8);
+		slotEntries.push_back(textures);
+
+		materials_.push_back(Material{});
+	}
+
+	atlas.upload();
+
+	// layers go to the blocks, pages are resolved to the texture arrays bound per slot
+	for (size_t i = 0; i < materials_.size(); ++i)
+	{
+		std::array<GLint, MaterialTextureCount> layers{};
+		for (size_t slot = 0; slot < MaterialTextureCount; ++slot)
+		{
+			const auto & entry = slotEntries[i][slot];
+			layers[slot] = entry ? entry->layer : g_no_layer;
+			materials_[i].textures[slot] = entry ? atlas.texture(entry->page) : 0;
+			materials_[i].features |= entry ? g_texture_features[slot] : 0u;
+		}
+		materials_[i].features |= blocks_[i].alphaCutoff >= 0.0f ? AlphaMaskFeature : 0u;
+		blocks_[i].layers = glm::ivec4(layers[BaseColorTexture], layers[NormalTexture],
+									   layers[MetallicRoughnessTexture], layers[OcclusionTexture]);
+		blocks_[i].emissiveLayer = glm::ivec4(layers[EmissiveTexture], 0, 0, 0);
+	}
+
+	std::cout << "Materials: " << model.materials.size() << ", " << images.size() << " images in "
+			  << atlas.pageCount() << " pages" << std::endl;
+}
+
+size_t MaterialLibrary::index(const int gltfMaterial) const noexcept
+{
+	if (gltfMaterial < 0 || static_cast<size_t>(gltfMaterial) + 1 >= materials_.size())
+	{
+		return materials_.size() - 1;
+	}
+	return static_cast<size_t>(gltfMaterial);
+}
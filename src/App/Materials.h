@@ -0,0 +1,65 @@
+#pragma once
+
+#include <Base/TextureArrayAtlas.hpp>
+
+#include <QImage>
+
+#include "ShaderFeatures.h"
+#include "UniformBlocks.h"
+
+#include <array>
+#include <cstddef>
+#include <vector>
+
+#include <tinygltf/tiny_gltf.h>
+
+// Texture slots of a glTF metallic-roughness material, each is sampled from its own unit.
+enum MaterialTexture : size_t
+{
+	BaseColorTexture,
+	NormalTexture,
+	MetallicRoughnessTexture,
+	OcclusionTexture,
+	EmissiveTexture,
+	MaterialTextureCount,
+};
+
+// Materials of a glTF model as std140 blocks for one uniform buffer. Draws select their
+// material by index, so material parameters never change between draws; only the texture
+// pages of a slot do, and those binds are shared by every material on the same page.
+// Blocks are grouped into windows of MaterialWindowSize, one window is bound at a time.
+class MaterialLibrary final
+{
+public:
+	// Must match MAX_MATERIALS in Shaders/cube.fs.
+	static constexpr size_t MaterialWindowSize = 128;
+
+	struct Material
+	{
+		// Texture array per slot, 0 when the material does not sample it.
+		std::array<GLuint, MaterialTextureCount> textures{};
+		bool doubleSided = false;
+		// alphaMode BLEND, drawn after the opaque draws, see Transparency.h.
+		bool blend = false;
+		// Texture presence and alpha mode as shader variant bits.
+		fgl::ShaderCache::Key features = 0;
+	};
+
+public:
+	// Adds the model images to the atlas and uploads it. Color images are stored as sRGB,
+	// data images (normal, metallic-roughness, occlusion) as linear RGBA8. The fallback
+	// image becomes the base color of the default material used by primitives without one.
+	// Each texture keeps the filters and wraps of its glTF sampler, trilinear and repeat if it has none.
+	void load(const tinygltf::Model & model, fgl::TextureArrayAtlas & atlas, const QImage & fallback);
+
+	[[nodiscard]] size_t size() const noexcept { return blocks_.size(); }
+	[[nodiscard]] const std::vector<MaterialBlock> & blocks() const noexcept { return blocks_; }
+	[[nodiscard]] const Material & material(size_t index) const { return materials_[index]; }
+
+	// Index of a glTF material, the default material for -1 or out of range indices.
+	[[nodiscard]] size_t index(int gltfMaterial) const noexcept;
+
+private:
+	std::vector<MaterialBlock> blocks_;
+	std::vector<Material> materials_;
+};
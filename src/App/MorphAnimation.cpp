@@ -0,0 +1,152 @@
+#include "MorphAnimation.h"
+
+#include <QStringList>
+
+#include <algorithm>
+#include <cmath>
+
+namespace
+{
+// Cube, eased into the sphere over two seconds and back.
+const std::vector<MorphAnimation::Keyframe> g_default_curve = {
+	{0.0, 100.0f, MorphAnimation::Easing::Linear},
+	{2.0, 0.0f, MorphAnimation::Easing::Smooth},
+	{4.0, 100.0f, MorphAnimation::Easing::Smooth},
+};
+
+float ease(const MorphAnimation::Easing easing, const float t)
+{
+	switch (easing)
+	{
+		case MorphAnimation::Easing::Linear:
+			return t;
+		case MorphAnimation::Easing::Smooth:
+			return t * t * (3.0f - 2.0f * t);
+		case MorphAnimation::Easing::Cubic:
+			return t * t * t * (t * (t * 6.0f - 15.0f) + 10.0f);
+		case MorphAnimation::Easing::Step:
+			return 0.0f;
+	}
+	return t;
+}
+}// namespace
+
+MorphAnimation::MorphAnimation()
+{
+	setCurve(g_default_curve);
+}
+
+bool MorphAnimation::setCurve(std::vector<Keyframe> keyframes)
+{
+	const auto sorted = std::is_sorted(keyframes.begin(), keyframes.end(),
+									   [](const Keyframe & a, const Keyframe & b) { return a.time < b.time; });
+	if (keyframes.empty() || keyframes.front().time != 0.0 || !sorted)
+	{
+		return false;
+	}
+
+	keyframes_ = std::move(keyframes);
+	previous_ = current_ = sample(playhead_);
+	return true;
+}
+
+void MorphAnimation::setPlaying(const bool playing)
+{
+	if (playing && !playing_)
+	{
+		// the paused time is not simulated, play resumes where it stopped
+		clock_.reset();
+		previous_ = current_ = sample(playhead_);
+	}
+	playing_ = playing;
+}
+
+float MorphAnimation::advance()
+{
+	if (!playing_)
+	{
+		return current_;
+	}
+
+	for (auto steps = clock_.advance(); steps != 0; --steps)
+	{
+		playhead_ += clock_.step();
+		previous_ = current_;
+		current_ = sample(playhead_);
+	}
+	return previous_ + (current_ - previous_) * static_cast<float>(clock_.alpha());
+}
+
+float MorphAnimation::sample(const double time) const
+{
+	const auto duration = keyframes_.back().time;
+	if (duration <= 0.0)
+	{
+		return keyframes_.front().value;
+	}
+
+	const auto local = std::fmod(time, duration);
+	const auto next = std::upper_bound(keyframes_.begin(), keyframes_.end(), local,
+									   [](const double t, const Keyframe & keyframe) { return t < keyframe.time; });
+	if (next == keyframes_.end())
+	{
+		return keyframes_.back().value;
+	}
+
+	const auto & from = *(next - 1);
+	const auto t = static_cast<float>((local - from.time) / (next->time - from.time));
+	return from.value + (next->value - from.value) * ease(next->easing, t);
+}
+
+const char * MorphAnimation::easingName(const Easing easing) noexcept
+{
+	switch (easing)
+	{
+		case Easing::Linear:
+			return "linear";
+		case Easing::Smooth:
+			return "smooth";
+		case Easing::Cubic:
+			return "cubic";
+		case Easing::Step:
+			return "step";
+	}
+	return "";
+}
+
+std::optional<MorphAnimation::Easing> MorphAnimation::parseEasing(const QString & name)
+{
+	for (const auto easing : {Easing::Linear, Easing::Smooth, Easing::Cubic, Easing::Step})
+	{
+		if (name == QLatin1String(easingName(easing)))
+		{
+			return easing;
+		}
+	}
+	return std::nullopt;
+}
+
+std::optional<std::vector<MorphAnimation::Keyframe>> MorphAnimation::parseCurve(const QString & text)
+{
+	std::vector<Keyframe> keyframes;
+	for (const auto & item : text.split(','))
+	{
+		const auto fields = item.split(':');
+		if (fields.size() < 2 || fields.size() > 3)
+		{
+			return std::nullopt;
+		}
+
+		auto timeValid = false;
+		auto valueValid = false;
+		const auto time = fields[0].toDouble(&timeValid);
+		const auto value = fields[1].toFloat(&valueValid);
+		const auto easing = fields.size() == 3 ? parseEasing(fields[2]) : Easing::Linear;
+		if (!timeValid || !valueValid || !easing)
+		{
+			return std::nullopt;
+		}
+		keyframes.push_back({time, value, *easing});
+	}
+	return keyframes;
+}
@@ -0,0 +1,64 @@
+#pragma once
+
+#include <Base/FixedStepClock.hpp>
+
+#include <QString>
+
+#include <optional>
+#include <vector>
+
+// Drives the spherify coefficient along a looping keyframe curve. The curve is sampled on
+// the fixed steps of an fgl::FixedStepClock, and every frame blends the last two samples
+// by the clock's alpha, so the motion is the same at 30 Hz, 144 Hz or uncapped. Values are
+// floats with the meaning of morphingCoef: 100 is the cube, 0 the sphere.
+class MorphAnimation final
+{
+public:
+	// Shape of the segment arriving at a keyframe.
+	enum class Easing
+	{
+		Linear,
+		Smooth,// smoothstep, eases in and out
+		Cubic, // smootherstep, flatter at both ends
+		Step,  // holds the previous value until the keyframe
+	};
+
+	struct Keyframe
+	{
+		double time;// seconds from the start of the loop
+		float value;
+		Easing easing;
+	};
+
+public:
+	// Starts paused on the default cube - sphere - cube curve.
+	MorphAnimation();
+
+	// Keyframes must be sorted by time with the first at 0; the loop lasts until the last one.
+	// Returns false and keeps the current curve otherwise.
+	bool setCurve(std::vector<Keyframe> keyframes);
+	[[nodiscard]] const std::vector<Keyframe> & curve() const noexcept { return keyframes_; }
+
+	void setPlaying(bool playing);
+	[[nodiscard]] bool playing() const noexcept { return playing_; }
+
+	// Runs the steps due since the previous frame and returns the value to render.
+	[[nodiscard]] float advance();
+
+	// Value of the curve at a time in seconds, wrapped into the loop.
+	[[nodiscard]] float sample(double time) const;
+
+	[[nodiscard]] static const char * easingName(Easing easing) noexcept;
+	[[nodiscard]] static std::optional<Easing> parseEasing(const QString & name);
+
+	// "time:value[:easing],..." as given on the command line, easing defaults to linear.
+	[[nodiscard]] static std::optional<std::vector<Keyframe>> parseCurve(const QString & text);
+
+private:
+	std::vector<Keyframe> keyframes_;
+	fgl::FixedStepClock clock_;
+	bool playing_ = false;
+	double playhead_ = 0.0;
+	float previous_ = 0.0f;
+	float current_ = 0.0f;
+};
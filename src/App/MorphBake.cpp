@@ -0,0 +1,201 @@
+#include "MorphBake.h"
+
+#include "GltfAccessors.h"
+
+#include <glm/gtc/packing.hpp>
+
+#include <algorithm>
+#include <iostream>
+#include <limits>
+
+#ifndef GL_MAX_TEXTURE_BUFFER_SIZE
+#define GL_MAX_TEXTURE_BUFFER_SIZE 0x8C2B
+#endif
+#ifndef GL_RGBA16
+#define GL_RGBA16 0x805B
+#endif
+
+namespace
+{
+// Texels per vertex and frame: position, normal.
+constexpr size_t g_texels_per_frame = 2;
+// Vertices per job when frames are packed.
+constexpr size_t g_pack_grain = 4096;
+}// namespace
+
+MorphBake::~MorphBake()
+{
+	// GL objects are expected to be released with destroy() while the context is current.
+	Q_ASSERT(buffer_ == 0);
+}
+
+void MorphBake::setFrames(const size_t frames) noexcept
+{
+	frames_ = std::clamp<size_t>(frames, 2, MaxFrames);
+}
+
+void MorphBake::create(fgl::GLResources & resources)
+{
+	initializeOpenGLFunctions();
+	resources_ = &resources;
+
+	GLint maxTexels = 0;
+	glGetIntegerv(GL_MAX_TEXTURE_BUFFER_SIZE, &maxTexels);
+	maxTexels_ = static_cast<size_t>(std::max(maxTexels, 0));
+}
+
+void MorphBake::destroy()
+{
+	glDeleteTextures(1, &texture_);
+	glDeleteBuffers(1, &buffer_);
+	texture_ = 0;
+	buffer_ = 0;
+	states_.clear();
+	texels_.clear();
+	bytes_ = 0;
+}
+
+auto MorphBake::add(const tinygltf::Model & model, const tinygltf::Primitive & primitive, const GLuint vertexArray,
+					const MorphShapes::Shape shape, const float exponent, JobSystem & jobs) -> std::optional<Bake>
+{
+	const auto position = primitive.attributes.find("POSITION");
+	if (mode_ == Mode::Off || !primitive.targets.empty() || position == primitive.attributes.end())
+	{
+		return std::nullopt;
+	}
+	for (const auto & state : states_)
+	{
+		if (state.vertexArray == vertexArray && state.shape == shape && state.exponent == exponent)
+		{
+			return state.bake;
+		}
+	}
+	const auto & positionAccessor = model.accessors[position->second];
+	if (positionAccessor.type != TINYGLTF_TYPE_VEC3 || positionAccessor.componentType != TINYGLTF_COMPONENT_TYPE_FLOAT)
+	{
+		return std::nullopt;
+	}
+
+	const auto base = texels_.size() / 4;
+	const auto texelCount = positionAccessor.count * frames_ * g_texels_per_frame;
+	if (base + texelCount > maxTexels_)
+	{
+		std::cout << "MorphBake: " << positionAccessor.count << " vertices at " << frames_
+				  << " frames exceed the texture buffer size, the primitive is not baked" << std::endl;
+		return std::nullopt;
+	}
+
+	const auto positions = readVec3(model, positionAccessor);
+	const auto normal = primitive.attributes.find("NORMAL");
+	const auto normals = normal != primitive.attributes.end() ? readVec3(model, model.accessors[normal->second]) : std::vector<glm::vec3>{};
+
+	VertexStreams in;
+	in.resize(positions.size());
+	for (size_t i = 0; i < positions.size(); ++i)
+	{
+		in.positionX[i] = positions[i].x;
+		in.positionY[i] = positions[i].y;
+		in.positionZ[i] = positions[i].z;
+		in.normalX[i] = i < normals.size() ? normals[i].x : 0.0f;
+		in.normalY[i] = i < normals.size() ? normals[i].y : 0.0f;
+		in.normalZ[i] = i < normals.size() ? normals[i].z : 0.0f;
+	}
+	VertexStreams out;
+	out.resize(in.size());
+
+	// every position moves on a line from the morphed vertex to the cube one, so the ends bound all frames
+	glm::vec3 low(0.0f);
+	glm::vec3 high(0.0f);
+	const auto integer = mode_ == Mode::Unorm16;
+	if (integer)
+	{
+		MorphShapes::morph(jobs, shape, exponent, in, out, 0.0f);
+		low = glm::vec3(std::numeric_limits<float>::max());
+		high = glm::vec3(std::numeric_limits<float>::lowest());
+		for (size_t i = 0; i < in.size(); ++i)
+		{
+			const glm::vec3 cube(in.positionX[i], in.positionY[i], in.positionZ[i]);
+			const glm::vec3 morphed(out.positionX[i], out.positionY[i], out.positionZ[i]);
+			low = glm::min(low, glm::min(cube, morphed));
+			high = glm::max(high, glm::max(cube, morphed));
+		}
+	}
+	const auto extent = integer ? glm::max(high - low, glm::vec3(1e-6f)) : glm::vec3(1.0f);
+	const auto normalLow = integer ? -1.0f : 0.0f;
+	const auto normalExtent = integer ? 2.0f : 1.0f;
+
+	const auto encode = [&](const float value, const float offset, const float scale) {
+		return integer ? glm::packUnorm1x16((value - offset) / scale) : glm::packHalf1x16(value);
+	};
+
+	texels_.resize((base + texelCount) * 4);
+	auto * const texels = texels_.data() + base * 4;
+	const auto frames = frames_;
+	for (size_t frame = 0; frame < frames; ++frame)
+	{
+		const auto coefficient = 100.0f * static_cast<float>(frame) / static_cast<float>(frames - 1);
+		MorphShapes::morph(jobs, shape, exponent, in, out, coefficient);
+		jobs.parallelFor(0, out.size(), g_pack_grain, [&](const size_t first, const size_t last) {
+			for (auto i = first; i < last; ++i)
+			{
+				auto * const texel = texels + (i * frames + frame) * g_texels_per_frame * 4;
+				texel[0] = encode(out.positionX[i], low.x, extent.x);
+				texel[1] = encode(out.positionY[i], low.y, extent.y);
+				texel[2] = encode(out.positionZ[i], low.z, extent.z);
+				texel[3] = 0;
+				texel[4] = encode(out.normalX[i], normalLow, normalExtent);
+				texel[5] = encode(out.normalY[i], normalLow, normalExtent);
+				texel[6] = encode(out.normalZ[i], normalLow, normalExtent);
+				texel[7] = 0;
+			}
+		});
+	}
+
+	const Bake bake{static_cast<GLint>(base), {low.x, low.y, low.z, normalLow}, {extent.x, extent.y, extent.z, normalExtent}};
+	states_.push_back({vertexArray, shape, exponent, bake});
+	return bake;
+}
+
+void MorphBake::upload()
+{
+	if (texels_.empty() || buffer_ != 0)
+	{
+		return;
+	}
+
+	buffer_ = resources_->createBuffer(GL_TEXTURE_BUFFER, static_cast<GLsizeiptr>(texels_.size() * sizeof(std::uint16_t)),
+									   texels_.data(), false);
+	texture_ = resources_->createBufferTexture(mode_ == Mode::Unorm16 ? GL_RGBA16 : GL_RGBA16F, buffer_);
+	bytes_ = texels_.size() * sizeof(std::uint16_t);
+	std::cout << "MorphBake: " << states_.size() << " morph states, " << frames_ << " frames, "
+			  << static_cast<double>(bytes()) / (1024.0 * 1024.0) << " MB as " << modeName(mode_) << std::endl;
+
+	// the GPU copy is all that is read from now on
+	texels_ = {};
+}
+
+const char * MorphBake::modeName(const Mode mode) noexcept
+{
+	switch (mode)
+	{
+		case Mode::Off:
+			return "off";
+		case Mode::Float16:
+			return "float16";
+		case Mode::Unorm16:
+			return "unorm16";
+	}
+	return "";
+}
+
+std::optional<MorphBake::Mode> MorphBake::parseMode(const QString & name)
+{
+	for (const auto mode : {Mode::Off, Mode::Float16, Mode::Unorm16})
+	{
+		if (name == QLatin1String(modeName(mode)))
+		{
+			return mode;
+		}
+	}
+	return std::nullopt;
+}
@@ -0,0 +1,108 @@
+#pragma once
+
+#include <Base/GLResources.hpp>
+
+#include <QOpenGLExtraFunctions>
+#include <QString>
+
+#include "JobSystem.h"
+#include "MorphShapes.h"
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <optional>
+#include <vector>
+
+#include <tinygltf/tiny_gltf.h>
+
+// Vertex animation of the morph baked at load time: each primitive, morphed into the shape of
+// the nodes drawing it, is sampled at Frames coefficients evenly spread from 0 (morphed) to 100
+// (cube) and stored as half floats or 16-bit normalized integers in a buffer texture. MORPH_BAKED
+// variants of cube.vs fetch a vertex's position and normal at the two frames around the
+// coefficient and blend them, so playback costs the same whatever the mapping. Texels are
+// vertex-major, the frames of a vertex adjacent: base + (vertex * frames + frame) * 2, normal in
+// the second texel. Positions are linear in the coefficient for every mapping, so two frames
+// would already reproduce them exactly; only spherify normals are not, and the extra frames
+// follow their curve in Frames - 1 segments.
+// Integer texels are decoded with a per-bake range that draws pass as constant attributes
+// along with the base texel, so a vertex fetches nothing but its four frame texels.
+// Primitives with morph targets are not baked, and neither is a bake that would not fit in
+// GL_MAX_TEXTURE_BUFFER_SIZE; their draws keep the other morph paths.
+class MorphBake final : protected QOpenGLExtraFunctions
+{
+public:
+	enum class Mode
+	{
+		Off,
+		Float16,
+		Unorm16,
+	};
+
+	static constexpr size_t DefaultFrames = 16;
+	static constexpr size_t MaxFrames = 256;
+
+	// Where a draw finds its bake in texture(), and how to decode it: texel values map to
+	// low + value * extent, positions with xyz and normals with w.
+	struct Bake
+	{
+		GLint base = 0;
+		std::array<GLfloat, 4> low{};
+		std::array<GLfloat, 4> extent{};
+	};
+
+public:
+	MorphBake() = default;
+	~MorphBake();
+
+	MorphBake(const MorphBake &) = delete;
+	MorphBake(MorphBake &&) = delete;
+	MorphBake & operator=(const MorphBake &) = delete;
+	MorphBake & operator=(MorphBake &&) = delete;
+
+public:
+	void setMode(Mode mode) noexcept { mode_ = mode; }
+	[[nodiscard]] Mode mode() const noexcept { return mode_; }
+	// Clamped to [2, MaxFrames].
+	void setFrames(size_t frames) noexcept;
+	[[nodiscard]] size_t frames() const noexcept { return frames_; }
+
+	// All require a current context.
+	void create(fgl::GLResources & resources);
+	void destroy();
+
+	// Bakes the primitive drawn with the vertex array morphed into the shape, once per state.
+	// Null when baking is off or the primitive cannot be baked.
+	[[nodiscard]] std::optional<Bake> add(const tinygltf::Model & model, const tinygltf::Primitive & primitive, GLuint vertexArray,
+										  MorphShapes::Shape shape, float exponent, JobSystem & jobs);
+	// Uploads all bakes into the textures, once after the last add().
+	void upload();
+
+	// Buffer texture, 0 when nothing is baked.
+	[[nodiscard]] GLuint texture() const noexcept { return texture_; }
+	[[nodiscard]] size_t bytes() const noexcept { return bytes_; }
+
+	[[nodiscard]] static const char * modeName(Mode mode) noexcept;
+	[[nodiscard]] static std::optional<Mode> parseMode(const QString & name);
+
+private:
+	struct State
+	{
+		GLuint vertexArray = 0;
+		MorphShapes::Shape shape = MorphShapes::Shape::Sphere;
+		float exponent = 0.0f;
+		Bake bake;
+	};
+
+	fgl::GLResources * resources_ = nullptr;
+	Mode mode_ = Mode::Off;
+	size_t frames_ = DefaultFrames;
+	size_t maxTexels_ = 0;
+
+	std::vector<State> states_;
+	std::vector<std::uint16_t> texels_;// 4 components per texel
+	size_t bytes_ = 0;
+
+	GLuint buffer_ = 0;
+	GLuint texture_ = 0;
+};
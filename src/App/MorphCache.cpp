@@ -0,0 +1,201 @@
+#include "MorphCache.h"
+
+#include <QFile>
+
+#include "UniformBlocks.h"
+
+#include <array>
+#include <iostream>
+
+namespace
+{
+// Holds the Object block, rounded up to the usual uniform buffer alignment.
+constexpr GLsizeiptr g_block_buffer_size = 256;
+}// namespace
+
+MorphCache::~MorphCache()
+{
+	// GL objects are expected to be released with destroy() while the context is current.
+	Q_ASSERT(objectBuffer_ == 0);
+}
+
+void MorphCache::create(fgl::GLState & state, fgl::GLResources & resources)
+{
+	initializeOpenGLFunctions();
+	state_ = &state;
+	resources_ = &resources;
+
+	program_ = captureProgram(*this, {"captured_position", "captured_normal", "captured_texcoord"});
+	if (!program_)
+	{
+		std::cout << "MorphCache: capture program does not build, morphing stays in cube.vs" << std::endl;
+	}
+
+	const std::vector<std::byte> zeros(g_block_buffer_size);
+	objectBuffer_ = resources.createBuffer(GL_UNIFORM_BUFFER, g_block_buffer_size, zeros.data(), true);
+}
+
+void MorphCache::destroy()
+{
+	for (auto & primitive : primitives_)
+	{
+		if (primitive.cached != 0)
+		{
+			state_->forgetVertexArray(primitive.cached);
+			glDeleteVertexArrays(1, &primitive.cached);
+		}
+	}
+	primitives_.clear();
+	bySource_.clear();
+
+	const std::array<GLuint, 2> buffers = {objectBuffer_, vertexBuffer_};
+	glDeleteBuffers(static_cast<GLsizei>(buffers.size()), buffers.data());
+	objectBuffer_ = 0;
+	vertexBuffer_ = 0;
+	program_.reset();
+	coefficient_.reset();
+}
+
+void MorphCache::addPrimitive(const GLuint vertexArray, const GLsizei vertexCount)
+{
+	bySource_.emplace(vertexArray, primitives_.size());
+	primitives_.push_back({vertexArray, 0, vertexCount, 0});
+}
+
+void MorphCache::build()
+{
+	constexpr auto stride = static_cast<GLsizei>(VertexFloats * sizeof(GLfloat));
+
+	GLintptr size = 0;
+	for (auto & primitive : primitives_)
+	{
+		primitive.offset = size;
+		size += static_cast<GLintptr>(primitive.vertexCount) * stride;
+	}
+	if (size == 0)
+	{
+		return;
+	}
+
+	// only written by transform feedback, never by the CPU
+	vertexBuffer_ = resources_->createBuffer(GL_ARRAY_BUFFER, size, nullptr, false);
+	for (auto & primitive : primitives_)
+	{
+		primitive.cached = resources_->createVertexArray();
+		resources_->vertexAttribute(primitive.cached, 0, vertexBuffer_, 3, GL_FLOAT, false, stride, primitive.offset);
+		resources_->vertexAttribute(primitive.cached, 1, vertexBuffer_, 3, GL_FLOAT, false, stride,
+									primitive.offset + static_cast<GLintptr>(3 * sizeof(GLfloat)));
+		resources_->vertexAttribute(primitive.cached, 2, vertexBuffer_, 2, GL_FLOAT, false, stride,
+									primitive.offset + static_cast<GLintptr>(6 * sizeof(GLfloat)));
+	}
+}
+
+bool MorphCache::update(const float coefficient)
+{
+	if (mode_ == Mode::Off || !program_ || vertexBuffer_ == 0)
+	{
+		return false;
+	}
+	if (coefficient_ == coefficient)
+	{
+		return true;
+	}
+
+	ObjectBlock block{};
+	block.morphingCoef = coefficient;
+	resources_->updateBuffer(GL_UNIFORM_BUFFER, objectBuffer_, 0, sizeof(block), &block);
+
+	// frames still in flight draw from the old vertices; GL orders these writes after their reads
+	state_->useProgram(program_->programId());
+	state_->bindBufferBase(GL_UNIFORM_BUFFER, ObjectBinding, objectBuffer_);
+	state_->enable(GL_RASTERIZER_DISCARD);
+	for (const auto & primitive : primitives_)
+	{
+		state_->bindVertexArray(primitive.source);
+		state_->bindBufferRange(GL_TRANSFORM_FEEDBACK_BUFFER, 0, vertexBuffer_, primitive.offset,
+								static_cast<GLsizeiptr>(primitive.vertexCount) * static_cast<GLsizeiptr>(VertexFloats * sizeof(GLfloat)));
+		glBeginTransformFeedback(GL_POINTS);
+		glDrawArrays(GL_POINTS, 0, primitive.vertexCount);
+		glEndTransformFeedback();
+	}
+	state_->disable(GL_RASTERIZER_DISCARD);
+
+	coefficient_ = coefficient;
+	++captures_;
+	return true;
+}
+
+GLuint MorphCache::cachedVertexArray(const GLuint vertexArray) const
+{
+	const auto primitive = bySource_.find(vertexArray);
+	return primitive != bySource_.end() ? primitives_[primitive->second].cached : 0;
+}
+
+std::unique_ptr<QOpenGLShaderProgram> MorphCache::captureProgram(QOpenGLExtraFunctions & gl,
+																 const std::vector<const char *> & varyings,
+																 const std::vector<const char *> & defines)
+{
+	QFile file(":/Shaders/cube.vs");
+	QFile library(":/Shaders/morph.glsl");
+	if (!file.open(QIODevice::ReadOnly) || !library.open(QIODevice::ReadOnly))
+	{
+		return nullptr;
+	}
+	auto source = file.readAll();
+	const auto versionEnd = source.indexOf('\n') + 1;
+	QByteArray defineLines = "#define MORPH\n#define MORPH_CAPTURE\n";
+	for (const auto * define : defines)
+	{
+		defineLines.append("#define ").append(define).append("\n");
+	}
+	source.insert(versionEnd, defineLines);
+
+	// morph.glsl has no version line, it shares the one of cube.vs
+	auto morph = source.left(versionEnd);
+	morph.append(defineLines).append(library.readAll());
+
+	auto program = std::make_unique<QOpenGLShaderProgram>();
+	if (!program->addShaderFromSourceCode(QOpenGLShader::Vertex, source)
+		|| !program->addShaderFromSourceCode(QOpenGLShader::Vertex, morph))
+	{
+		return nullptr;
+	}
+	// varyings are part of the link
+	gl.glTransformFeedbackVaryings(program->programId(), static_cast<GLsizei>(varyings.size()), varyings.data(), GL_INTERLEAVED_ATTRIBS);
+	if (!program->link())
+	{
+		return nullptr;
+	}
+
+	// the capture variant reads nothing but the morph parameters of the Object block
+	const auto index = gl.glGetUniformBlockIndex(program->programId(), "Object");
+	if (index != GL_INVALID_INDEX)
+	{
+		gl.glUniformBlockBinding(program->programId(), index, ObjectBinding);
+	}
+	return program;
+}
+
+const char * MorphCache::modeName(const Mode mode) noexcept
+{
+	switch (mode)
+	{
+		case Mode::Off:
+			return "off";
+		case Mode::On:
+			return "on";
+	}
+	return "";
+}
+
+std::optional<MorphCache::Mode> MorphCache::parseMode(const QString & name)
+{
+	for (const auto mode : {Mode::Off, Mode::On})
+	{
+		if (name == QLatin1String(modeName(mode)))
+		{
+			return mode;
+		}
+	}
+	return std::nullopt;
+}
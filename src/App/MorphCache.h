@@ -0,0 +1,96 @@
+#pragma once
+
+#include <Base/GLResources.hpp>
+#include <Base/GLState.hpp>
+
+#include <QOpenGLExtraFunctions>
+#include <QOpenGLShaderProgram>
+#include <QString>
+
+#include <cstddef>
+#include <memory>
+#include <optional>
+#include <unordered_map>
+#include <vector>
+
+// Spherified vertices of every primitive, captured by transform feedback when the morph
+// coefficient changes. cube.vs runs once per vertex with MORPH and MORPH_CAPTURE, which
+// skips the transforms and lighting, and rasterization discarded; until the coefficient
+// changes again draws use the cached vertex arrays with the variant without MORPH, whose
+// vertex stage only transforms. Primitives are captured once per mesh, every node drawing
+// the mesh reads the same vertices. Off by default like the other morph backends.
+class MorphCache final : protected QOpenGLExtraFunctions
+{
+public:
+	enum class Mode
+	{
+		Off,
+		On,
+	};
+
+	// Floats per cached vertex: position, normal, texture coordinate.
+	static constexpr size_t VertexFloats = 8;
+
+public:
+	MorphCache() = default;
+	~MorphCache();
+
+	MorphCache(const MorphCache &) = delete;
+	MorphCache(MorphCache &&) = delete;
+	MorphCache & operator=(const MorphCache &) = delete;
+	MorphCache & operator=(MorphCache &&) = delete;
+
+public:
+	void setMode(Mode mode) noexcept { mode_ = mode; }
+	[[nodiscard]] Mode mode() const noexcept { return mode_; }
+
+	// All require a current context. Bindings go through state.
+	void create(fgl::GLState & state, fgl::GLResources & resources);
+	void destroy();
+
+	// Registers a primitive by its vertex array, which has positions on attribute 0, normals on 1
+	// and texture coordinates on 2; build() then allocates the cache for all of them.
+	void addPrimitive(GLuint vertexArray, GLsizei vertexCount);
+	void build();
+
+	// Captures the morph at the coefficient unless it is cached already. False when the cache
+	// is off or cannot be used, draws then morph in cube.vs.
+	[[nodiscard]] bool update(float coefficient);
+
+	// Vertex array reading the cached vertices of a registered primitive.
+	[[nodiscard]] GLuint cachedVertexArray(GLuint vertexArray) const;
+
+	[[nodiscard]] size_t captures() const noexcept { return captures_; }
+
+	// cube.vs and morph.glsl with MORPH, MORPH_CAPTURE and the given defines, such as the one of a morph shape,
+	// recording the given outputs interleaved; every uniform block of it reads the buffer bound at ObjectBinding.
+	// Null when it does not build.
+	[[nodiscard]] static std::unique_ptr<QOpenGLShaderProgram> captureProgram(QOpenGLExtraFunctions & gl,
+																			  const std::vector<const char *> & varyings,
+																			  const std::vector<const char *> & defines = {});
+
+	[[nodiscard]] static const char * modeName(Mode mode) noexcept;
+	[[nodiscard]] static std::optional<Mode> parseMode(const QString & name);
+
+private:
+	struct Primitive
+	{
+		GLuint source = 0;
+		GLuint cached = 0;
+		GLsizei vertexCount = 0;
+		GLintptr offset = 0;
+	};
+
+	fgl::GLState * state_ = nullptr;
+	fgl::GLResources * resources_ = nullptr;
+	Mode mode_ = Mode::Off;
+
+	std::unique_ptr<QOpenGLShaderProgram> program_;
+	GLuint objectBuffer_ = 0;// Object block with the coefficient being captured
+	GLuint vertexBuffer_ = 0;
+
+	std::vector<Primitive> primitives_;
+	std::unordered_map<GLuint, size_t> bySource_;
+	std::optional<float> coefficient_;// of the cached vertices
+	size_t captures_ = 0;
+};
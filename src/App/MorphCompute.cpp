@@ -0,0 +1,284 @@
+#include "MorphCompute.h"
+
+#include <QFile>
+#include <QOpenGLContext>
+
+#include "GltfAccessors.h"
+
+#include <algorithm>
+#include <iostream>
+
+#ifndef GL_SHADER_STORAGE_BUFFER
+#define GL_SHADER_STORAGE_BUFFER 0x90D2
+#endif
+#ifndef GL_VERTEX_ATTRIB_ARRAY_BARRIER_BIT
+#define GL_VERTEX_ATTRIB_ARRAY_BARRIER_BIT 0x00000001
+#endif
+
+namespace
+{
+// Must match the bindings of the Source and Morphed blocks in Shaders/morph.comp.
+constexpr GLuint g_source_binding = 0;
+constexpr GLuint g_morphed_binding = 1;
+
+constexpr std::array<MorphShapes::Shape, 5> g_shapes = {MorphShapes::Shape::Sphere, MorphShapes::Shape::Superellipsoid,
+														 MorphShapes::Shape::Cylinder, MorphShapes::Shape::Octahedron,
+														 MorphShapes::Shape::Torus};
+}// namespace
+
+MorphCompute::~MorphCompute()
+{
+	// GL objects are expected to be released with destroy() while the context is current.
+	Q_ASSERT(sources_.empty() && states_.empty());
+}
+
+void MorphCompute::create(fgl::GLState & state, fgl::GLResources & resources)
+{
+	initializeOpenGLFunctions();
+	state_ = &state;
+	resources_ = &resources;
+
+	supported_ = false;
+	const auto context = QOpenGLContext::currentContext();
+	if (mode_ == Mode::Off || context == nullptr || context->isOpenGLES())
+	{
+		return;
+	}
+	if (context->format().version() < qMakePair(4, 3) && !context->hasExtension("GL_ARB_compute_shader"))
+	{
+		std::cout << "MorphCompute: needs GL 4.3 or ARB_compute_shader, morphing stays in cube.vs" << std::endl;
+		return;
+	}
+	// every variant update() may pick is built here, so a frame never finds one missing halfway
+	supported_ = true;
+	for (const auto shape : g_shapes)
+	{
+		for (const auto size : WorkgroupSizes)
+		{
+			supported_ = supported_ && program(shape, size) != nullptr;
+		}
+	}
+	if (!supported_)
+	{
+		programs_.clear();
+		std::cout << "MorphCompute: morph.comp does not build, morphing stays in cube.vs" << std::endl;
+	}
+}
+
+void MorphCompute::destroy()
+{
+	for (auto & state : states_)
+	{
+		state_->forgetVertexArray(state.vertexArray);
+		glDeleteVertexArrays(1, &state.vertexArray);
+		glDeleteBuffers(1, &state.buffer);
+	}
+	states_.clear();
+	for (auto & source : sources_)
+	{
+		glDeleteBuffers(1, &source.second.buffer);
+	}
+	sources_.clear();
+	programs_.clear();
+}
+
+bool MorphCompute::addPrimitive(const tinygltf::Model & model, const tinygltf::Primitive & primitive, const GLuint vertexArray)
+{
+	const auto position = primitive.attributes.find("POSITION");
+	if (!active() || position == primitive.attributes.end())
+	{
+		return false;
+	}
+	const auto & positionAccessor = model.accessors[position->second];
+	if (positionAccessor.type != TINYGLTF_TYPE_VEC3 || positionAccessor.componentType != TINYGLTF_COMPONENT_TYPE_FLOAT)
+	{
+		return false;
+	}
+
+	const auto positions = readVec3(model, positionAccessor);
+	const auto normal = primitive.attributes.find("NORMAL");
+	const auto normals = normal != primitive.attributes.end() ? readVec3(model, model.accessors[normal->second]) : std::vector<glm::vec3>{};
+	const auto texcoord = primitive.attributes.find("TEXCOORD_0");
+	const auto texcoords = texcoord != primitive.attributes.end() ? readVec2(model, model.accessors[texcoord->second]) : std::vector<glm::vec2>{};
+
+	std::vector<GLfloat> vertices(positions.size() * SourceFloats, 0.0f);
+	for (size_t i = 0; i < positions.size(); ++i)
+	{
+		auto * vertex = &vertices[i * SourceFloats];
+		vertex[0] = positions[i].x;
+		vertex[1] = positions[i].y;
+		vertex[2] = positions[i].z;
+		if (i < normals.size())
+		{
+			vertex[3] = normals[i].x;
+			vertex[4] = normals[i].y;
+			vertex[5] = normals[i].z;
+		}
+		if (i < texcoords.size())
+		{
+			vertex[6] = texcoords[i].x;
+			vertex[7] = texcoords[i].y;
+		}
+	}
+
+	// read by morph.comp and, for texture coordinates, by the vertex arrays of the states
+	const auto buffer = resources_->createBuffer(GL_SHADER_STORAGE_BUFFER, static_cast<GLsizeiptr>(vertices.size() * sizeof(GLfloat)),
+												 vertices.data(), false);
+	sources_[vertexArray] = {buffer, static_cast<GLsizei>(positions.size())};
+	return true;
+}
+
+GLuint MorphCompute::vertexArray(const GLuint source, const MorphShapes::Shape shape, const float exponent)
+{
+	const auto found = sources_.find(source);
+	if (found == sources_.end())
+	{
+		return 0;
+	}
+	for (const auto & state : states_)
+	{
+		if (state.source == source && state.shape == shape && state.exponent == exponent)
+		{
+			return state.vertexArray;
+		}
+	}
+
+	constexpr auto sourceStride = static_cast<GLsizei>(SourceFloats * sizeof(GLfloat));
+	constexpr auto morphedStride = static_cast<GLsizei>(MorphedFloats * sizeof(GLfloat));
+
+	State state;
+	state.source = source;
+	state.shape = shape;
+	state.exponent = exponent;
+	// only written by morph.comp, never by the CPU
+	state.buffer = resources_->createBuffer(GL_SHADER_STORAGE_BUFFER,
+											static_cast<GLsizeiptr>(found->second.vertexCount) * morphedStride, nullptr, false);
+	state.vertexArray = resources_->createVertexArray();
+	resources_->vertexAttribute(state.vertexArray, 0, state.buffer, 3, GL_FLOAT, false, morphedStride, 0);
+	resources_->vertexAttribute(state.vertexArray, 1, state.buffer, 3, GL_FLOAT, false, morphedStride,
+								static_cast<GLintptr>(3 * sizeof(GLfloat)));
+	resources_->vertexAttribute(state.vertexArray, 2, found->second.buffer, 2, GL_FLOAT, false, sourceStride,
+								static_cast<GLintptr>(6 * sizeof(GLfloat)));
+	states_.push_back(std::move(state));
+	return states_.back().vertexArray;
+}
+
+bool MorphCompute::update(const float coefficient)
+{
+	if (!active() || states_.empty())
+	{
+		return false;
+	}
+
+	// frames still in flight draw from the old vertices; GL orders these writes after their reads
+	auto dispatched = false;
+	for (auto & state : states_)
+	{
+		if (state.coefficient == coefficient)
+		{
+			continue;
+		}
+		const auto & source = sources_.at(state.source);
+		const auto size = workgroupSize(source.vertexCount);
+		// built by create(), supported_ is false otherwise
+		auto * const variant = program(state.shape, size);
+		Q_ASSERT(variant != nullptr);
+
+		state_->useProgram(variant->program->programId());
+		glUniform1f(variant->coefficient, coefficient);
+		glUniform1f(variant->exponent, state.exponent);
+		glUniform1ui(variant->vertexCount, static_cast<GLuint>(source.vertexCount));
+		state_->bindBufferBase(GL_SHADER_STORAGE_BUFFER, g_source_binding, source.buffer);
+		state_->bindBufferBase(GL_SHADER_STORAGE_BUFFER, g_morphed_binding, state.buffer);
+		glDispatchCompute((static_cast<GLuint>(source.vertexCount) + size - 1) / size, 1, 1);
+
+		state.coefficient = coefficient;
+		++dispatches_;
+		dispatched = true;
+	}
+	if (dispatched)
+	{
+		glMemoryBarrier(GL_VERTEX_ATTRIB_ARRAY_BARRIER_BIT);
+	}
+	return true;
+}
+
+GLuint MorphCompute::workgroupSize(const GLsizei vertexCount) noexcept
+{
+	const auto count = static_cast<GLuint>(std::max(vertexCount, 0));
+	for (auto size = WorkgroupSizes.rbegin(); size != WorkgroupSizes.rend(); ++size)
+	{
+		if (count / *size >= MinWorkgroups)
+		{
+			return *size;
+		}
+	}
+	return WorkgroupSizes.front();
+}
+
+auto MorphCompute::program(const MorphShapes::Shape shape, const GLuint size) -> Program *
+{
+	const auto key = std::make_tuple(shape, size);
+	const auto found = programs_.find(key);
+	if (found != programs_.end())
+	{
+		return found->second.program ? &found->second : nullptr;
+	}
+
+	auto & entry = programs_[key];
+	QFile file(":/Shaders/morph.comp");
+	QFile library(":/Shaders/morph.glsl");
+	if (!file.open(QIODevice::ReadOnly) || !library.open(QIODevice::ReadOnly))
+	{
+		return nullptr;
+	}
+	auto source = file.readAll();
+	const auto versionEnd = source.indexOf('\n') + 1;
+	QByteArray defines = "#define MORPH\n#define LOCAL_SIZE " + QByteArray::number(size) + "\n";
+	if (const auto * define = MorphShapes::define(shape))
+	{
+		defines.append("#define ").append(define).append("\n");
+	}
+	source.insert(versionEnd, defines);
+
+	// morph.glsl has no version line, it shares the one of morph.comp
+	auto morph = source.left(versionEnd);
+	morph.append(defines).append(library.readAll());
+
+	auto program = std::make_unique<QOpenGLShaderProgram>();
+	if (!program->addShaderFromSourceCode(QOpenGLShader::Compute, source)
+		|| !program->addShaderFromSourceCode(QOpenGLShader::Compute, morph) || !program->link())
+	{
+		return nullptr;
+	}
+	const auto programId = program->programId();
+	entry.coefficient = glGetUniformLocation(programId, "morphing_coef");
+	entry.exponent = glGetUniformLocation(programId, "morph_exponent");
+	entry.vertexCount = glGetUniformLocation(programId, "vertex_count");
+	entry.program = std::move(program);
+	return &entry;
+}
+
+const char * MorphCompute::modeName(const Mode mode) noexcept
+{
+	switch (mode)
+	{
+		case Mode::Off:
+			return "off";
+		case Mode::On:
+			return "on";
+	}
+	return "";
+}
+
+std::optional<MorphCompute::Mode> MorphCompute::parseMode(const QString & name)
+{
+	for (const auto mode : {Mode::Off, Mode::On})
+	{
+		if (name == QLatin1String(modeName(mode)))
+		{
+			return mode;
+		}
+	}
+	return std::nullopt;
+}
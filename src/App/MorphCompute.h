@@ -0,0 +1,129 @@
+#pragma once
+
+#include <Base/GLResources.hpp>
+#include <Base/GLState.hpp>
+
+#include <QOpenGLExtraFunctions>
+#include <QOpenGLShaderProgram>
+#include <QString>
+
+#include "MorphShapes.h"
+
+#include <array>
+#include <cstddef>
+#include <map>
+#include <memory>
+#include <optional>
+#include <tuple>
+#include <unordered_map>
+#include <vector>
+
+#include <tinygltf/tiny_gltf.h>
+
+// Optional GL 4.3 compute morph. Every primitive's cube vertices are uploaded once into a
+// shader storage buffer; each unique morph state, a primitive with the shape and exponent of
+// the nodes drawing it, owns an output buffer that Shaders/morph.comp fills whenever the
+// coefficient changes and that its vertex array reads as positions and normals, with texture
+// coordinates read straight from the source buffer. However many nodes share a state, it is
+// morphed once per change, and draws use the variant without MORPH, like the morph cache.
+// Unlike the cache it covers every shape and keeps working while the coefficient is animated.
+// The workgroup size of a dispatch follows the vertex count: the widest of WorkgroupSizes
+// that still gives MinWorkgroups groups, so small meshes spread over the compute units and
+// large ones need fewer groups. Primitives with morph targets, whose blend depends on node
+// weights, keep morphing in cube.vs; without GL 4.3, or when any shape and size variant of
+// morph.comp does not build, the mode falls back to off.
+class MorphCompute final : protected QOpenGLExtraFunctions
+{
+public:
+	enum class Mode
+	{
+		Off,
+		On,
+	};
+
+	// Candidate local sizes, each compiled into its own program per shape by create().
+	static constexpr std::array<GLuint, 3> WorkgroupSizes = {64, 128, 256};
+	static constexpr GLuint MinWorkgroups = 64;
+
+	// Floats per vertex: position, normal and texture coordinate in, position and normal out.
+	static constexpr size_t SourceFloats = 8;
+	static constexpr size_t MorphedFloats = 6;
+
+public:
+	MorphCompute() = default;
+	~MorphCompute();
+
+	MorphCompute(const MorphCompute &) = delete;
+	MorphCompute(MorphCompute &&) = delete;
+	MorphCompute & operator=(const MorphCompute &) = delete;
+	MorphCompute & operator=(MorphCompute &&) = delete;
+
+public:
+	void setMode(Mode mode) noexcept { mode_ = mode; }
+	[[nodiscard]] Mode mode() const noexcept { return mode_; }
+
+	// All require a current context. Bindings go through state.
+	void create(fgl::GLState & state, fgl::GLResources & resources);
+	void destroy();
+
+	[[nodiscard]] bool supported() const noexcept { return supported_; }
+	[[nodiscard]] bool active() const noexcept { return mode_ == Mode::On && supported_; }
+
+	// Uploads the cube vertices of a primitive drawn with the vertex array. False when the
+	// compute morph is not active or the primitive has no float positions.
+	bool addPrimitive(const tinygltf::Model & model, const tinygltf::Primitive & primitive, GLuint vertexArray);
+
+	// Vertex array of the primitive morphed into the shape, shared by all nodes asking for the
+	// same state; 0 when the primitive was not added.
+	[[nodiscard]] GLuint vertexArray(GLuint source, MorphShapes::Shape shape, float exponent);
+
+	// Morphs every state whose vertices are not at the coefficient yet. False when the compute
+	// morph is not active, draws then morph in cube.vs.
+	[[nodiscard]] bool update(float coefficient);
+
+	[[nodiscard]] size_t states() const noexcept { return states_.size(); }
+	[[nodiscard]] size_t dispatches() const noexcept { return dispatches_; }
+
+	[[nodiscard]] static GLuint workgroupSize(GLsizei vertexCount) noexcept;
+
+	[[nodiscard]] static const char * modeName(Mode mode) noexcept;
+	[[nodiscard]] static std::optional<Mode> parseMode(const QString & name);
+
+private:
+	struct Source
+	{
+		GLuint buffer = 0;
+		GLsizei vertexCount = 0;
+	};
+
+	struct State
+	{
+		GLuint source = 0;// vertex array of the primitive
+		MorphShapes::Shape shape = MorphShapes::Shape::Sphere;
+		float exponent = 0.0f;
+		GLuint buffer = 0;
+		GLuint vertexArray = 0;
+		std::optional<float> coefficient;// of the morphed vertices
+	};
+
+	struct Program
+	{
+		std::unique_ptr<QOpenGLShaderProgram> program;
+		GLint coefficient = -1;
+		GLint exponent = -1;
+		GLint vertexCount = -1;
+	};
+
+	[[nodiscard]] Program * program(MorphShapes::Shape shape, GLuint size);
+
+	fgl::GLState * state_ = nullptr;
+	fgl::GLResources * resources_ = nullptr;
+	Mode mode_ = Mode::Off;
+	bool supported_ = false;
+
+	std::unordered_map<GLuint, Source> sources_;
+	std::vector<State> states_;
+	// null entries remember programs that do not build
+	std::map<std::tuple<MorphShapes::Shape, GLuint>, Program> programs_;
+	size_t dispatches_ = 0;
+};
@@ -0,0 +1,175 @@
+#include "MorphShapes.h"
+
+#include "ShaderFeatures.h"
+
+#include <glm/glm.hpp>
+
+#include <algorithm>
+#include <cmath>
+
+namespace
+{
+// Vertices per job, as for the sphere kernel.
+constexpr size_t g_morph_grain = 16 * 1024;
+
+// Keeps pow() away from zero, as the shader does.
+constexpr float g_min_magnitude = 1e-6f;
+
+struct Target
+{
+	glm::vec3 position;
+	glm::vec3 normal;
+};
+
+// Each follows its SHAPE_* branch of shape_target() in Shaders/morph.glsl.
+Target superellipsoid(const glm::vec3 & p, const float exponent)
+{
+	const auto powered = glm::pow(glm::max(glm::abs(p), glm::vec3(g_min_magnitude)), glm::vec3(exponent));
+	const auto position = p * std::pow(powered.x + powered.y + powered.z, -1.0f / exponent);
+	const auto gradient = glm::sign(p) * glm::pow(glm::max(glm::abs(position), glm::vec3(g_min_magnitude)), glm::vec3(exponent - 1.0f));
+	return {position, glm::normalize(gradient)};
+}
+
+Target cylinder(const glm::vec3 & p)
+{
+	const auto squared = p * p;
+	const glm::vec3 position(p.x * std::sqrt(1.0f - squared.z * 0.5f), p.y, p.z * std::sqrt(1.0f - squared.x * 0.5f));
+	const auto cap = std::abs(p.y) >= std::max(std::abs(p.x), std::abs(p.z));
+	const auto normal = cap ? glm::vec3(0.0f, glm::sign(p.y), 0.0f) : glm::normalize(glm::vec3(position.x, 0.0f, position.z));
+	return {position, normal};
+}
+
+Target octahedron(const glm::vec3 & p)
+{
+	return {p / (std::abs(p.x) + std::abs(p.y) + std::abs(p.z)), glm::normalize(glm::sign(p))};
+}
+
+Target torus(const glm::vec3 & p)
+{
+	// latitude of the spherified point around the tube, longitude around the ring
+	const auto squared = p * p;
+	const auto sphere = p * glm::sqrt(glm::vec3(1.0f) - glm::vec3(squared.y, squared.z, squared.x) * 0.5f
+									  - glm::vec3(squared.z, squared.x, squared.y) * 0.5f
+									  + glm::vec3(squared.y, squared.z, squared.x) * glm::vec3(squared.z, squared.x, squared.y) / 3.0f);
+	const auto u = std::atan2(sphere.z, sphere.x);
+	const auto v = 2.0f * std::asin(std::clamp(sphere.y, -1.0f, 1.0f));
+	const auto ring = MorphShapes::TorusRingRadius + MorphShapes::TorusTubeRadius * std::cos(v);
+	return {glm::vec3(ring * std::cos(u), MorphShapes::TorusTubeRadius * std::sin(v), ring * std::sin(u)),
+			glm::vec3(std::cos(v) * std::cos(u), std::sin(v), std::cos(v) * std::sin(u))};
+}
+
+// Blends every vertex of the range with its image on the shape.
+template <typename Map>
+void morphRange(const VertexStreams & in, VertexStreams & out, const float t, const size_t first, const size_t last, Map map)
+{
+	for (auto i = first; i < last; ++i)
+	{
+		const glm::vec3 position(in.positionX[i], in.positionY[i], in.positionZ[i]);
+		const glm::vec3 normal(in.normalX[i], in.normalY[i], in.normalZ[i]);
+		const Target shaped = map(position);
+		const auto morphed = glm::mix(shaped.position, position, t);
+		const auto morphedNormal = glm::normalize(glm::mix(shaped.normal, normal, t));
+
+		out.positionX[i] = morphed.x;
+		out.positionY[i] = morphed.y;
+		out.positionZ[i] = morphed.z;
+		out.normalX[i] = morphedNormal.x;
+		out.normalY[i] = morphedNormal.y;
+		out.normalZ[i] = morphedNormal.z;
+	}
+}
+}// namespace
+
+void MorphShapes::morph(const Shape shape, const float exponent, const VertexStreams & in, VertexStreams & out,
+						const float coefficient, const size_t first, const size_t last)
+{
+	// one loop per shape, the mapping is not selected per vertex
+	const auto t = coefficient / 100.0f;
+	switch (shape)
+	{
+		case Shape::Sphere:
+			SpherifyKernel::morph(in, out, coefficient, first, last);
+			break;
+		case Shape::Superellipsoid:
+			morphRange(in, out, t, first, last, [exponent](const glm::vec3 & p) { return superellipsoid(p, exponent); });
+			break;
+		case Shape::Cylinder:
+			morphRange(in, out, t, first, last, cylinder);
+			break;
+		case Shape::Octahedron:
+			morphRange(in, out, t, first, last, octahedron);
+			break;
+		case Shape::Torus:
+			morphRange(in, out, t, first, last, torus);
+			break;
+	}
+}
+
+void MorphShapes::morph(JobSystem & jobs, const Shape shape, const float exponent, const VertexStreams & in,
+						VertexStreams & out, const float coefficient)
+{
+	jobs.parallelFor(0, in.size(), g_morph_grain, [&](const size_t first, const size_t last) {
+		morph(shape, exponent, in, out, coefficient, first, last);
+	});
+}
+
+fgl::ShaderCache::Key MorphShapes::feature(const Shape shape) noexcept
+{
+	switch (shape)
+	{
+		case Shape::Sphere:
+			return 0u;
+		case Shape::Superellipsoid:
+			return SuperellipsoidShapeFeature;
+		case Shape::Cylinder:
+			return CylinderShapeFeature;
+		case Shape::Octahedron:
+			return OctahedronShapeFeature;
+		case Shape::Torus:
+			return TorusShapeFeature;
+	}
+	return 0u;
+}
+
+const char * MorphShapes::define(const Shape shape) noexcept
+{
+	const auto bit = feature(shape);
+	for (size_t i = 0; i < ShaderFeatureDefines.size(); ++i)
+	{
+		if (bit == (fgl::ShaderCache::Key{1} << i))
+		{
+			return ShaderFeatureDefines[i];
+		}
+	}
+	return nullptr;
+}
+
+const char * MorphShapes::shapeName(const Shape shape) noexcept
+{
+	switch (shape)
+	{
+		case Shape::Sphere:
+			return "sphere";
+		case Shape::Superellipsoid:
+			return "superellipsoid";
+		case Shape::Cylinder:
+			return "cylinder";
+		case Shape::Octahedron:
+			return "octahedron";
+		case Shape::Torus:
+			return "torus";
+	}
+	return "";
+}
+
+std::optional<MorphShapes::Shape> MorphShapes::parseShape(const QString & name)
+{
+	for (const auto shape : {Shape::Sphere, Shape::Superellipsoid, Shape::Cylinder, Shape::Octahedron, Shape::Torus})
+	{
+		if (name == QLatin1String(shapeName(shape)))
+		{
+			return shape;
+		}
+	}
+	return std::nullopt;
+}
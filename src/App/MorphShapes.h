@@ -0,0 +1,52 @@
+#pragma once
+
+#include <Base/ShaderCache.hpp>
+
+#include <QString>
+
+#include "JobSystem.h"
+#include "SpherifyKernel.h"
+
+#include <cstddef>
+#include <optional>
+
+// Analytic shapes the unit cube morphs into, besides the sphere of spherify(). Each one is
+// a shader specialization of the MORPH variant of Shaders/morph.glsl, selected by one of the
+// MorphShapeFeatures bits, so a draw only pays for the mapping of its own object; morph()
+// is the matching CPU version. The morph blends the cube point with its image on the shape,
+// positions and normals alike, with the coefficient of the Object block: 100 keeps the cube.
+// The sphere keeps the original spherify() blend and runs SpherifyKernel on the CPU.
+// All shapes stay inside the [-1, 1] cube, so the cube bounds remain conservative.
+class MorphShapes final
+{
+public:
+	enum class Shape
+	{
+		Sphere,
+		Superellipsoid,// |x|^e + |y|^e + |z|^e = 1, e from the Object block
+		Cylinder,      // around y, the top and bottom faces become the caps
+		Octahedron,    // |x| + |y| + |z| = 1
+		Torus,         // the sphere wrapped onto a ring around y
+	};
+
+	static constexpr float DefaultExponent = 4.0f;
+	// Ring and tube radius of the torus, their sum keeps it inside the cube.
+	static constexpr float TorusRingRadius = 0.75f;
+	static constexpr float TorusTubeRadius = 0.25f;
+
+public:
+	// Morphs vertices [first, last) of in into the same range of out, out must be as large as in.
+	static void morph(Shape shape, float exponent, const VertexStreams & in, VertexStreams & out, float coefficient,
+					  size_t first, size_t last);
+
+	// Morphs all vertices, split across the job system.
+	static void morph(JobSystem & jobs, Shape shape, float exponent, const VertexStreams & in, VertexStreams & out,
+					  float coefficient);
+
+	// Shader feature bit selecting the shape and its define, 0 and nullptr for the sphere.
+	[[nodiscard]] static fgl::ShaderCache::Key feature(Shape shape) noexcept;
+	[[nodiscard]] static const char * define(Shape shape) noexcept;
+
+	[[nodiscard]] static const char * shapeName(Shape shape) noexcept;
+	[[nodiscard]] static std::optional<Shape> parseShape(const QString & name);
+};
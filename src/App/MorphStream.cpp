@@ -0,0 +1,116 @@
+#include "MorphStream.h"
+
+#include "GltfAccessors.h"
+
+namespace
+{
+// Per vertex: morphed position, then morphed normal.
+constexpr size_t g_stream_floats = 6;
+}// namespace
+
+MorphStream::~MorphStream()
+{
+	// GL objects are expected to be released with destroy() while the context is current.
+	Q_ASSERT(buffers_.empty());
+}
+
+void MorphStream::create(fgl::GLResources & resources)
+{
+	initializeOpenGLFunctions();
+	resources_ = &resources;
+}
+
+void MorphStream::destroy()
+{
+	glDeleteBuffers(static_cast<GLsizei>(buffers_.size()), buffers_.data());
+	buffers_.clear();
+	vertices_ = 0;
+}
+
+bool MorphStream::add(const tinygltf::Model & model, const tinygltf::Primitive & primitive, const GLuint vertexArray,
+					  const MorphShapes::Shape shape, const float exponent, JobSystem & jobs)
+{
+	const auto position = primitive.attributes.find("POSITION");
+	if (mode_ == Mode::Off || position == primitive.attributes.end())
+	{
+		return false;
+	}
+	const auto & positionAccessor = model.accessors[position->second];
+	if (positionAccessor.type != TINYGLTF_TYPE_VEC3 || positionAccessor.componentType != TINYGLTF_COMPONENT_TYPE_FLOAT)
+	{
+		return false;
+	}
+
+	const auto positions = readVec3(model, positionAccessor);
+	const auto normal = primitive.attributes.find("NORMAL");
+	const auto normals = normal != primitive.attributes.end()
+		? readVec3(model, model.accessors[normal->second])
+		: std::vector<glm::vec3>(positions.size(), glm::vec3(0.0f));
+
+	VertexStreams in;
+	in.resize(positions.size());
+	for (size_t i = 0; i < positions.size(); ++i)
+	{
+		in.positionX[i] = positions[i].x;
+		in.positionY[i] = positions[i].y;
+		in.positionZ[i] = positions[i].z;
+		in.normalX[i] = i < normals.size() ? normals[i].x : 0.0f;
+		in.normalY[i] = i < normals.size() ? normals[i].y : 0.0f;
+		in.normalZ[i] = i < normals.size() ? normals[i].z : 0.0f;
+	}
+	VertexStreams out;
+	out.resize(in.size());
+	compute(jobs, shape, exponent, in, out);
+
+	std::vector<GLfloat> interleaved(out.size() * g_stream_floats);
+	for (size_t i = 0; i < out.size(); ++i)
+	{
+		auto * vertex = &interleaved[i * g_stream_floats];
+		vertex[0] = out.positionX[i];
+		vertex[1] = out.positionY[i];
+		vertex[2] = out.positionZ[i];
+		vertex[3] = out.normalX[i];
+		vertex[4] = out.normalY[i];
+		vertex[5] = out.normalZ[i];
+	}
+
+	constexpr auto stride = static_cast<GLsizei>(g_stream_floats * sizeof(GLfloat));
+	const auto buffer = resources_->createBuffer(GL_ARRAY_BUFFER, static_cast<GLsizeiptr>(interleaved.size() * sizeof(GLfloat)),
+												 interleaved.data(), false);
+	resources_->vertexAttribute(vertexArray, PositionAttribute, buffer, 3, GL_FLOAT, false, stride, 0);
+	resources_->vertexAttribute(vertexArray, NormalAttribute, buffer, 3, GL_FLOAT, false, stride,
+								static_cast<GLintptr>(3 * sizeof(GLfloat)));
+	buffers_.push_back(buffer);
+	vertices_ += out.size();
+	return true;
+}
+
+void MorphStream::compute(JobSystem & jobs, const MorphShapes::Shape shape, const float exponent, const VertexStreams & in,
+						  VertexStreams & out)
+{
+	MorphShapes::morph(jobs, shape, exponent, in, out, 0.0f);
+}
+
+const char * MorphStream::modeName(const Mode mode) noexcept
+{
+	switch (mode)
+	{
+		case Mode::Off:
+			return "off";
+		case Mode::On:
+			return "on";
+	}
+	return "";
+}
+
+std::optional<MorphStream::Mode> MorphStream::parseMode(const QString & name)
+{
+	for (const auto mode : {Mode::Off, Mode::On})
+	{
+		if (name == QLatin1String(modeName(mode)))
+		{
+			return mode;
+		}
+	}
+	return std::nullopt;
+}
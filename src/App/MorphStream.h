@@ -0,0 +1,76 @@
+#pragma once
+
+#include <Base/GLResources.hpp>
+
+#include <QOpenGLExtraFunctions>
+#include <QString>
+
+#include "JobSystem.h"
+#include "MorphShapes.h"
+
+#include <cstddef>
+#include <optional>
+#include <vector>
+
+#include <tinygltf/tiny_gltf.h>
+
+// Fully morphed positions and normals of the primitives as a second vertex stream, computed
+// once at load time on the job system with the CPU kernels of MorphShapes. A MORPH_STREAM draw
+// then morphs with one mix() per attribute instead of evaluating the mapping per vertex and
+// frame. Positions match the shader morph exactly, every mapping being a linear blend of the
+// cube and its image; spherify() blends the normal towards the partly morphed vertex instead,
+// so the streamed sphere normals differ from it by a few degrees halfway through.
+// A primitive gets the stream of the shape of the first node drawing it; nodes with another
+// shape, primitives with morph targets and tessellated draws keep the shader morph.
+// Streamed draws keep reading the stream while the coefficient stays, instead of the captures
+// of MorphCache, so still and animated frames are lit with the same normals.
+class MorphStream final : protected QOpenGLExtraFunctions
+{
+public:
+	enum class Mode
+	{
+		Off,
+		On,
+	};
+
+	// Must match the locations of in_morphed_position and in_morphed_normal in Shaders/cube.vs.
+	static constexpr GLuint PositionAttribute = 5;
+	static constexpr GLuint NormalAttribute = 6;
+
+public:
+	MorphStream() = default;
+	~MorphStream();
+
+	MorphStream(const MorphStream &) = delete;
+	MorphStream(MorphStream &&) = delete;
+	MorphStream & operator=(const MorphStream &) = delete;
+	MorphStream & operator=(MorphStream &&) = delete;
+
+public:
+	void setMode(Mode mode) noexcept { mode_ = mode; }
+	[[nodiscard]] Mode mode() const noexcept { return mode_; }
+
+	// Require a current context.
+	void create(fgl::GLResources & resources);
+	void destroy();
+
+	// Attaches the stream of the primitive morphed into the shape to its vertex array. False
+	// when streams are off or the primitive has no float positions.
+	bool add(const tinygltf::Model & model, const tinygltf::Primitive & primitive, GLuint vertexArray,
+			 MorphShapes::Shape shape, float exponent, JobSystem & jobs);
+
+	[[nodiscard]] size_t vertices() const noexcept { return vertices_; }
+
+	// Cube surface in streams, morphed at coefficient 0 into out.
+	static void compute(JobSystem & jobs, MorphShapes::Shape shape, float exponent, const VertexStreams & in,
+						VertexStreams & out);
+
+	[[nodiscard]] static const char * modeName(Mode mode) noexcept;
+	[[nodiscard]] static std::optional<Mode> parseMode(const QString & name);
+
+private:
+	fgl::GLResources * resources_ = nullptr;
+	Mode mode_ = Mode::Off;
+	std::vector<GLuint> buffers_;
+	size_t vertices_ = 0;
+};
@@ -0,0 +1,146 @@
+#include "MorphTargets.h"
+
+#include "GltfAccessors.h"
+
+#include <glm/gtc/type_ptr.hpp>
+
+#include <algorithm>
+#include <cmath>
+#include <numeric>
+
+namespace
+{
+// Texels per vertex and target: position delta, normal delta.
+constexpr size_t g_texels_per_target = 2;
+}// namespace
+
+MorphTargets::~MorphTargets()
+{
+	// GL objects are expected to be released with destroy() while the context is current.
+	Q_ASSERT(buffer_ == 0);
+}
+
+void MorphTargets::load(const tinygltf::Model & model, fgl::GLResources & resources)
+{
+	initializeOpenGLFunctions();
+
+	std::vector<glm::vec4> texels;
+	baseTexels_.clear();
+	for (const auto & mesh : model.meshes)
+	{
+		std::vector<GLint> bases(mesh.primitives.size(), -1);
+		for (size_t p = 0; p < mesh.primitives.size(); ++p)
+		{
+			const auto & primitive = mesh.primitives[p];
+			const auto position = primitive.attributes.find("POSITION");
+			if (primitive.targets.empty() || position == primitive.attributes.end())
+			{
+				continue;
+			}
+
+			const auto vertexCount = model.accessors[position->second].count;
+			const auto targetCount = primitive.targets.size();
+			const auto base = texels.size();
+			bases[p] = static_cast<GLint>(base);
+			texels.resize(base + vertexCount * targetCount * g_texels_per_target, glm::vec4(0.0f));
+
+			for (size_t t = 0; t < targetCount; ++t)
+			{
+				for (const auto & [attribute, slot] : {std::pair<const char *, size_t>{"POSITION", 0}, {"NORMAL", 1}})
+				{
+					const auto accessor = primitive.targets[t].find(attribute);
+					if (accessor == primitive.targets[t].end())
+					{
+						continue;
+					}
+					const auto deltas = readVec3(model, model.accessors[accessor->second]);
+					for (size_t v = 0; v < std::min(vertexCount, deltas.size()); ++v)
+					{
+						texels[base + (v * targetCount + t) * g_texels_per_target + slot] = glm::vec4(deltas[v], 0.0f);
+					}
+				}
+			}
+		}
+		baseTexels_.push_back(std::move(bases));
+	}
+
+	if (texels.empty())
+	{
+		return;
+	}
+
+	buffer_ = resources.createBuffer(GL_TEXTURE_BUFFER, static_cast<GLsizeiptr>(texels.size() * sizeof(glm::vec4)), texels.data(), false);
+	texture_ = resources.createBufferTexture(GL_RGBA32F, buffer_);
+}
+
+void MorphTargets::destroy()
+{
+	if (buffer_ == 0)
+	{
+		return;
+	}
+
+	glDeleteTextures(1, &texture_);
+	glDeleteBuffers(1, &buffer_);
+	texture_ = 0;
+	buffer_ = 0;
+}
+
+GLint MorphTargets::baseTexel(const size_t mesh, const size_t primitive) const
+{
+	return mesh < baseTexels_.size() && primitive < baseTexels_[mesh].size() ? baseTexels_[mesh][primitive] : -1;
+}
+
+auto MorphTargets::select(const std::vector<double> & weights) -> Active
+{
+	std::vector<size_t> order(weights.size());
+	std::iota(order.begin(), order.end(), size_t{0});
+	order.erase(std::remove_if(order.begin(), order.end(), [&](const size_t i) { return weights[i] == 0.0; }), order.end());
+
+	const auto count = std::min(order.size(), MaxActiveTargets);
+	std::partial_sort(order.begin(), order.begin() + static_cast<std::ptrdiff_t>(count), order.end(),
+					  [&](const size_t a, const size_t b) { return std::abs(weights[a]) > std::abs(weights[b]); });
+
+	Active active;
+	active.count = static_cast<GLint>(count);
+	for (size_t i = 0; i < count; ++i)
+	{
+		active.indices[i] = static_cast<GLint>(order[i]);
+		active.weights[i] = static_cast<GLfloat>(weights[order[i]]);
+	}
+	return active;
+}
+
+Aabb MorphTargets::morphedBounds(const tinygltf::Model & model, const tinygltf::Primitive & primitive,
+								 const Active & active, const Aabb & bounds)
+{
+	auto morphed = bounds;
+	for (GLint i = 0; i < active.count; ++i)
+	{
+		const auto target = static_cast<size_t>(active.indices[i]);
+		if (target >= primitive.targets.size())
+		{
+			continue;
+		}
+		const auto position = primitive.targets[target].find("POSITION");
+		if (position == primitive.targets[target].end())
+		{
+			continue;
+		}
+
+		const auto & accessor = model.accessors[position->second];
+		if (accessor.minValues.size() != 3 || accessor.maxValues.size() != 3)
+		{
+			// no extent in the file, never cull
+			constexpr auto unbounded = 1e30f;
+			return Aabb{glm::vec3(-unbounded), glm::vec3(unbounded)};
+		}
+
+		const auto weight = active.weights[i];
+		const auto low = weight * glm::vec3(glm::make_vec3(accessor.minValues.data()));
+		const auto high = weight * glm::vec3(glm::make_vec3(accessor.maxValues.data()));
+		morphed.min += glm::min(low, high);
+		morphed.max += glm::max(low, high);
+	}
+	return morphed;
+}
@@ -0,0 +1,65 @@
+#pragma once
+
+#include <Base/GLResources.hpp>
+
+#include <QOpenGLExtraFunctions>
+
+#include "Bounds.h"
+
+#include <array>
+#include <cstddef>
+#include <vector>
+
+#include <tinygltf/tiny_gltf.h>
+
+// Position and normal deltas of the glTF morph targets of all primitives, in one texture
+// buffer blended by cube.vs. Texels of a primitive are vertex-major, so a vertex finds its
+// deltas at base + (vertex * targetCount + target) * 2, normal delta in the second texel.
+// Dense and sparse accessors are read alike, targets without NORMAL get zero deltas.
+// A draw only blends the targets of non-zero weight, at most MaxActiveTargets of them.
+class MorphTargets final : protected QOpenGLExtraFunctions
+{
+public:
+	// Must match MAX_ACTIVE_TARGETS in Shaders/cube.vs.
+	static constexpr size_t MaxActiveTargets = 8;
+
+	// Targets a draw blends, by weight magnitude when more than MaxActiveTargets are non-zero.
+	struct Active
+	{
+		GLint count = 0;
+		std::array<GLint, MaxActiveTargets> indices{};
+		std::array<GLfloat, MaxActiveTargets> weights{};
+	};
+
+public:
+	MorphTargets() = default;
+	~MorphTargets();
+
+	MorphTargets(const MorphTargets &) = delete;
+	MorphTargets(MorphTargets &&) = delete;
+	MorphTargets & operator=(const MorphTargets &) = delete;
+	MorphTargets & operator=(MorphTargets &&) = delete;
+
+public:
+	// Both require a current context.
+	void load(const tinygltf::Model & model, fgl::GLResources & resources);
+	void destroy();
+
+	// First texel of a primitive's deltas, -1 when it has no targets.
+	[[nodiscard]] GLint baseTexel(size_t mesh, size_t primitive) const;
+
+	// Buffer texture with the deltas, 0 when the model has no morph targets.
+	[[nodiscard]] GLuint texture() const noexcept { return texture_; }
+
+	[[nodiscard]] static Active select(const std::vector<double> & weights);
+
+	// Local bounds of a primitive grown by the largest displacement of the active targets,
+	// from the min/max every target POSITION accessor carries.
+	[[nodiscard]] static Aabb morphedBounds(const tinygltf::Model & model, const tinygltf::Primitive & primitive,
+											const Active & active, const Aabb & bounds);
+
+private:
+	GLuint buffer_ = 0;
+	GLuint texture_ = 0;
+	std::vector<std::vector<GLint>> baseTexels_;// per mesh and primitive
+};
@@ -0,0 +1,58 @@
+#pragma once
+
+#include <Base/ShaderCache.hpp>
+
+#include <array>
+#include <cstddef>
+
+// Feature bits of the cube shader variants, bit i enables ShaderFeatureDefines[i].
+// Light and morph bits are set per frame, pass bits by the pass, the others come from the material
+// of a draw, morph targets from its primitive and the morph shape from its node.
+enum ShaderFeature : fgl::ShaderCache::Key
+{
+	DirectionalLightFeature = 1u << 0,
+	SpotLightFeature = 1u << 1,
+	MorphFeature = 1u << 2,
+	BaseColorMapFeature = 1u << 3,
+	NormalMapFeature = 1u << 4,
+	MetallicRoughnessMapFeature = 1u << 5,
+	OcclusionMapFeature = 1u << 6,
+	EmissiveMapFeature = 1u << 7,
+	AlphaMaskFeature = 1u << 8,
+	DepthOnlyFeature = 1u << 9,
+	WeightedOitFeature = 1u << 10,// accumulation pass of weighted blended transparency
+	MorphTargetsFeature = 1u << 11,// glTF morph targets with non-zero weights
+	SuperellipsoidShapeFeature = 1u << 12,// morph shapes other than the sphere, see MorphShapes.h
+	CylinderShapeFeature = 1u << 13,
+	OctahedronShapeFeature = 1u << 14,
+	TorusShapeFeature = 1u << 15,
+	TessellationFeature = 1u << 16,// morph per generated vertex, triangle draws only, see Tessellation.h
+	MorphStreamFeature = 1u << 17,// morph from precomputed vertices, see MorphStream.h
+	MorphBakedFeature = 1u << 18,// play the morph back from a vertex animation texture, see MorphBake.h
+};
+
+// At most one of these is set, and only together with MorphFeature.
+constexpr fgl::ShaderCache::Key MorphShapeFeatures =
+	SuperellipsoidShapeFeature | CylinderShapeFeature | OctahedronShapeFeature | TorusShapeFeature;
+
+constexpr std::array<const char *, 19> ShaderFeatureDefines = {
+	"LIGHT_DIRECTIONAL",
+	"LIGHT_SPOT",
+	"MORPH",
+	"BASE_COLOR_MAP",
+	"NORMAL_MAP",
+	"METALLIC_ROUGHNESS_MAP",
+	"OCCLUSION_MAP",
+	"EMISSIVE_MAP",
+	"ALPHA_MASK",
+	"DEPTH_ONLY",
+	"WEIGHTED_OIT",
+	"MORPH_TARGETS",
+	"SHAPE_SUPERELLIPSOID",
+	"SHAPE_CYLINDER",
+	"SHAPE_OCTAHEDRON",
+	"SHAPE_TORUS",
+	"TESSELLATION",
+	"MORPH_STREAM",
+	"MORPH_BAKED",
+};
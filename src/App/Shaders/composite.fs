@@ -0,0 +1,20 @@
+#version 330 core
+
+// Resolves weighted blended transparency over the opaque image, see App/Transparency.h.
+
+uniform sampler2D opaque_image;
+uniform sampler2D accumulation;     // color times alpha and weight, revealage in alpha
+uniform sampler2D weights;          // alpha times weight
+
+out vec4 color;
+
+void main() {
+    ivec2 texel = ivec2(gl_FragCoord.xy);
+    vec3 opaque = texelFetch(opaque_image, texel, 0).rgb;
+    vec4 accumulated = texelFetch(accumulation, texel, 0);
+    float weight = texelFetch(weights, texel, 0).r;
+
+    // weighted average of the layers, covering the opaque image by what the layers did not reveal
+    vec3 average = accumulated.rgb / max(weight, 1e-5);
+    color = vec4(mix(average, opaque, accumulated.a), 1.0);
+}
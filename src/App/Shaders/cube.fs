@@ -1,40 +1,184 @@
 #version 330 core
 
+// Variants are compiled by fgl::ShaderCache with the defines of App/ShaderFeatures.h
+// inserted after the version line; texture slots and lights a draw does not use are compiled out.
+
+// Must match MaterialLibrary::MaterialWindowSize.
+#define MAX_MATERIALS 128
+
+const float PI = 3.14159265;
+
 in vec3 normal;
 in vec3 position;
 in vec2 texcoord;
+flat in int material_index;
+#ifdef LIGHT_DIRECTIONAL
 in vec3 sun;
+#endif
+#ifdef LIGHT_SPOT
 in vec3 lightDirection;
 in vec3 spotDirection;
+#endif
 
-uniform sampler2D tex;
-uniform bool directional;
-uniform bool spot;
+// glTF metallic-roughness material, layers are -1 when there is no texture
+struct Material {
+    vec4 base_color_factor;
+    vec4 emissive_factor;
+    float metallic_factor;
+    float roughness_factor;
+    float normal_scale;
+    float occlusion_strength;
+    float alpha_cutoff;
+    ivec4 layers;           // base color, normal, metallic-roughness, occlusion
+    ivec4 emissive_layer;
+};
 
-out vec4 color;
+layout(std140) uniform Materials {
+    Material materials[MAX_MATERIALS];
+};
 
-void main() {
-    
-    vec4 color_dir = vec4(0, 0, 0, 0);
-    vec4 color_spot = vec4(0, 0, 0, 0);
+#ifdef BASE_COLOR_MAP
+uniform sampler2DArray base_color_map;
+#endif
+#ifdef NORMAL_MAP
+uniform sampler2DArray normal_map;
+#endif
+#ifdef METALLIC_ROUGHNESS_MAP
+uniform sampler2DArray metallic_roughness_map;
+#endif
+#ifdef OCCLUSION_MAP
+uniform sampler2DArray occlusion_map;
+#endif
+#ifdef EMISSIVE_MAP
+uniform sampler2DArray emissive_map;
+#endif
+
+layout(std140) uniform Light {
+    vec4 sun_coord;
+    vec4 spot_position;
+    vec4 spot_direction;
+    float spot_cos_cutoff;
+};
+
+layout(location = 0) out vec4 color;
+#ifdef WEIGHTED_OIT
+layout(location = 1) out float weight;
+#endif
+
+
+#ifdef NORMAL_MAP
+// tangent frame from screen-space derivatives, the model provides no tangents
+vec3 perturbNormal(vec3 n, vec3 mapped, float scale) {
+    vec3 dp1 = dFdx(position);
+    vec3 dp2 = dFdy(position);
+    vec2 duv1 = dFdx(texcoord);
+    vec2 duv2 = dFdy(texcoord);
+
+    vec3 dp2perp = cross(dp2, n);
+    vec3 dp1perp = cross(n, dp1);
+    vec3 t = dp2perp * duv1.x + dp1perp * duv2.x;
+    vec3 b = dp2perp * duv1.y + dp1perp * duv2.y;
+    float invmax = inversesqrt(max(dot(t, t), dot(b, b)));
+
+    vec3 tangent_normal = mapped * 2.0 - 1.0;
+    tangent_normal.xy *= scale;
+    return normalize(mat3(t * invmax, b * invmax, n) * tangent_normal);
+}
+#endif
+
+// Cook-Torrance with GGX distribution, Smith-Schlick visibility and Schlick fresnel
+vec3 brdf(vec3 n, vec3 v, vec3 l, vec3 albedo, float metallic, float roughness) {
+    vec3 h = normalize(v + l);
+    float n_dot_l = max(dot(n, l), 0.0);
+    float n_dot_v = max(dot(n, v), 1e-4);
+    float n_dot_h = max(dot(n, h), 0.0);
+    float v_dot_h = max(dot(v, h), 0.0);
+
+    float alpha = roughness * roughness;
+    float alpha2 = alpha * alpha;
+    float denom = n_dot_h * n_dot_h * (alpha2 - 1.0) + 1.0;
+    float d = alpha2 / (PI * denom * denom);
 
-    color = texture(tex, texcoord) * 0.08;          // TODO: ambient
+    float k = alpha / 2.0;
+    float vis = 1.0 / ((n_dot_l * (1.0 - k) + k) * (n_dot_v * (1.0 - k) + k) * 4.0);
 
-    if (!spot && !directional) {
-        return;
+    vec3 f0 = mix(vec3(0.04), albedo, metallic);
+    vec3 f = f0 + (1.0 - f0) * pow(1.0 - v_dot_h, 5.0);
+
+    vec3 diffuse = (1.0 - f) * (1.0 - metallic) * albedo / PI;
+    return (diffuse + f * d * vis) * n_dot_l;
+}
+
+void main() {
+    Material material = materials[material_index];
+
+    vec4 albedo = material.base_color_factor;
+#ifdef BASE_COLOR_MAP
+    albedo *= texture(base_color_map, vec3(texcoord, material.layers.x));
+#endif
+#ifdef ALPHA_MASK
+    if (albedo.a < material.alpha_cutoff) {
+        discard;
     }
+#endif
+
+#ifdef DEPTH_ONLY
+    // depth pre-pass, color writes are masked
+    color = albedo;
+    return;
+#endif
+
+    float metallic = material.metallic_factor;
+    float roughness = material.roughness_factor;
+#ifdef METALLIC_ROUGHNESS_MAP
+    vec4 mr = texture(metallic_roughness_map, vec3(texcoord, material.layers.z));
+    roughness *= mr.g;
+    metallic *= mr.b;
+#endif
+    roughness = clamp(roughness, 0.04, 1.0);
 
-    if (directional) {
-        float cos = dot(normal, normalize(sun));
-        color_dir = cos > 0.0 ? texture(tex, texcoord) * cos : color_dir;
-    } 
-    
-    if (spot) {
-        float cos = dot(normalize(lightDirection), normalize(spotDirection));
-        float angle = acos(cos);
-        color_spot = cos > 0.0 && angle < radians(20.0) ? texture(tex, texcoord) * vec4(1, 1, 0.56, 1) : color_spot;    // TODO: angle param, angle -cos
+    vec3 n = normalize(gl_FrontFacing ? normal : -normal);
+#ifdef NORMAL_MAP
+    n = perturbNormal(n, texture(normal_map, vec3(texcoord, material.layers.y)).rgb, material.normal_scale);
+#endif
+
+    float occlusion = 1.0;
+#ifdef OCCLUSION_MAP
+    occlusion = mix(1.0, texture(occlusion_map, vec3(texcoord, material.layers.w)).r, material.occlusion_strength);
+#endif
+
+    vec3 emissive = material.emissive_factor.rgb;
+#ifdef EMISSIVE_MAP
+    emissive *= texture(emissive_map, vec3(texcoord, material.emissive_layer.x)).rgb;
+#endif
+
+    vec3 v = normalize(-position);
+    vec3 radiance = albedo.rgb * 0.03 * occlusion;          // TODO: ambient
+
+#ifdef LIGHT_DIRECTIONAL
+    radiance += brdf(n, v, normalize(sun), albedo.rgb, metallic, roughness) * PI;
+#endif
+
+#ifdef LIGHT_SPOT
+    // cone test against the precomputed cosine of the half angle
+    float cos_angle = dot(normalize(lightDirection), normalize(spotDirection));
+    if (cos_angle > spot_cos_cutoff) {
+        radiance += brdf(n, v, normalize(-lightDirection), albedo.rgb, metallic, roughness) * PI * vec3(1, 1, 0.56);
     }
+#endif
+
+    radiance += emissive;
 
-    color += color_dir;
-    color += color_spot;   
-}
\ No newline at end of file
+    // material colors are linear, the default framebuffer is not sRGB
+    vec3 encoded = pow(radiance, vec3(1.0 / 2.2));
+#ifdef WEIGHTED_OIT
+    // nearer layers weigh more (McGuire and Bavoil, eq. 9); the blend function sums color and
+    // weight and multiplies (1 - alpha) into the revealage in the alpha channel
+    float z = abs(position.z);
+    float layer_weight = clamp(10.0 / (1e-5 + pow(z / 5.0, 2.0) + pow(z / 200.0, 6.0)), 1e-2, 3e3);
+    color = vec4(encoded * albedo.a * layer_weight, albedo.a);
+    weight = albedo.a * layer_weight;
+#else
+    color = vec4(encoded, albedo.a);
+#endif
+}
@@ -3,65 +3,181 @@
 layout(location = 0) in vec3 in_vertex;
 layout(location = 1) in vec3 in_normal;
 layout(location = 2) in vec2 in_texcoord;
+// per-draw constant, the index of the material in the Materials block
+layout(location = 3) in int in_material;
+#ifdef MORPH_TARGETS
+// per-draw constant, the first texel of the primitive's morph target deltas
+layout(location = 4) in int in_target_base;
+#endif
+#ifdef MORPH_STREAM
+// the vertex fully morphed at load time, see App/MorphStream.h
+layout(location = 5) in vec3 in_morphed_position;
+layout(location = 6) in vec3 in_morphed_normal;
+#endif
+#ifdef MORPH_BAKED
+// per-draw constants, the first texel of the primitive's bake and its decode range:
+// position minimum and extent in xyz, normal minimum and extent in w, see App/MorphBake.h
+layout(location = 7) in int in_bake_base;
+layout(location = 8) in vec4 in_bake_low;
+layout(location = 9) in vec4 in_bake_extent;
+#endif
 
-uniform mat4 ModelMat;
-uniform mat4 ViewMat;
-uniform mat4 ProjMat;
-uniform mat4 normalMV;
-uniform vec3 sun_coord;
-uniform vec3 spot_position;
-uniform vec3 spot_direction;
-uniform int morphing_coef;
+layout(std140) uniform Camera {
+    mat4 ViewMat;
+    mat4 ProjMat;
+    vec4 viewport;// width, height in pixels
+    vec4 tessellation;// tolerance and shortest edge in pixels, highest level; cube.tcs only
+};
+
+// Variants are compiled by fgl::ShaderCache with the defines of App/ShaderFeatures.h
+// inserted after the version line: LIGHT_DIRECTIONAL, LIGHT_SPOT, MORPH and MORPH_TARGETS are used here,
+// one of the SHAPE_* defines replaces the sphere of MORPH with another shape of App/MorphShapes.h,
+// see Shaders/morph.glsl; MORPH_STREAM blends with a precomputed morph instead of evaluating it,
+// and MORPH_BAKED plays it back from the frames of a vertex animation texture.
+// With TESSELLATION the stage only passes the cube on to cube.tcs.
+// MORPH_CAPTURE is only defined by App/MorphCache, which records the morphed vertices.
+
+layout(std140) uniform Light {
+    vec4 sun_coord;
+    vec4 spot_position;
+    vec4 spot_direction;
+    float spot_cos_cutoff;
+};
+
+layout(std140) uniform Object {
+    int world_texel;
+    int normal_texel;
+    float morphing_coef;
+    int target_count;
+    int active_targets;
+    float morph_exponent;
+    ivec4 target_indices[2];
+    vec4 target_weights[2];
+};
+
+// world and normal matrices of all scene nodes, 4 texels per matrix
+uniform samplerBuffer transforms;
+
+#ifdef MORPH_TARGETS
+// Must match MorphTargets::MaxActiveTargets.
+#define MAX_ACTIVE_TARGETS 8
+
+// position and normal delta per vertex and target, vertex-major
+uniform samplerBuffer morph_targets;
+#endif
+
+#ifdef MORPH_BAKED
+// position and normal per vertex and frame, vertex-major, half floats or normalized integers
+uniform samplerBuffer morph_bake;
+// frames per vertex, the same for every bake
+uniform int morph_bake_frames;
+#endif
+
+// the depth pre-pass and the shading pass must produce bit-identical depth for GL_EQUAL
+invariant gl_Position;
 
 out vec3 normal;
 out vec3 position;
 out vec2 texcoord;
+flat out int material_index;
+#ifdef LIGHT_DIRECTIONAL
 out vec3 sun;
+#endif
+#ifdef LIGHT_SPOT
 out vec3 lightDirection;
 out vec3 spotDirection;
+#endif
+#ifdef TESSELLATION
+// object-space vertex with its morph targets, morphed and transformed per generated vertex in cube.tes
+out vec3 tess_position;
+out vec3 tess_normal;
+out vec2 tess_texcoord;
+flat out int tess_material;
+#endif
+#ifdef MORPH_CAPTURE
+// object-space result of the morph, recorded by transform feedback
+out vec3 captured_position;
+out vec3 captured_normal;
+out vec2 captured_texcoord;
+#endif
 
 
-vec4 spherify(vec4 vertex) {
-    float prev_x = vertex.x;
-	float prev_y = vertex.y;
-	float prev_z = vertex.z;
-
-	float prev_x_square = prev_x * prev_x;
-	float prev_y_square = prev_y * prev_y;
-	float prev_z_square = prev_z * prev_z;
-
-    float sqrt_x = sqrt(1 - prev_y_square / 2 - prev_z_square / 2 + prev_y_square * prev_z_square / 3);
-    float sqrt_y = sqrt(1 - prev_z_square / 2 - prev_x_square / 2 + prev_x_square * prev_z_square / 3);
-    float sqrt_z = sqrt(1 - prev_x_square / 2 - prev_y_square / 2 + prev_x_square * prev_y_square / 3);
+mat4 fetchMatrix(int texel) {
+    return mat4(texelFetch(transforms, texel),
+                texelFetch(transforms, texel + 1),
+                texelFetch(transforms, texel + 2),
+                texelFetch(transforms, texel + 3));
+}
 
-    float res_x = sqrt_x + (1 - sqrt_x) / 100 * morphing_coef;
-    float res_y = sqrt_y + (1 - sqrt_y) / 100 * morphing_coef;
-    float res_z = sqrt_z + (1 - sqrt_z) / 100 * morphing_coef;
 
-    vertex.x = prev_x * res_x;
-	vertex.y = prev_y * res_y;
-	vertex.z = prev_z * res_z;
-
-    return vertex;
-}
+#ifdef MORPH
+// Shaders/morph.glsl
+void morph(inout vec3 position, inout vec3 normal, float coefficient, float exponent);
+#endif
 
 
 void main() {
     vec4 vertex;
     vertex = vec4(in_vertex, 1);
-	vertex = spherify(vertex);
-
     vec4 tmp = vec4(in_normal, 1);
-    tmp = normalize(vertex) + (tmp - normalize(vertex)) / 100 * morphing_coef;
 
-    gl_Position = ProjMat * ViewMat * ModelMat * vertex;
-    normal = normalize(mat3(normalMV) * tmp.xyz);
-    position = in_vertex;
+#ifdef MORPH_TARGETS
+    // only targets with non-zero weight are listed
+    for (int i = 0; i < min(active_targets, MAX_ACTIVE_TARGETS); ++i) {
+        float weight = target_weights[i / 4][i % 4];
+        int texel = in_target_base + (gl_VertexID * target_count + target_indices[i / 4][i % 4]) * 2;
+        vertex.xyz += weight * texelFetch(morph_targets, texel).xyz;
+        tmp.xyz += weight * texelFetch(morph_targets, texel + 1).xyz;
+    }
+#endif
+
+#ifdef TESSELLATION
+    tess_position = vertex.xyz;
+    tess_normal = tmp.xyz;
+    tess_texcoord = in_texcoord;
+    tess_material = in_material;
+    return;
+#endif
+
+#if defined(MORPH_BAKED)
+    int frames = morph_bake_frames;
+    float frame = clamp(morphing_coef / 100, 0.0, 1.0) * float(frames - 1);
+    int first = min(int(frame), frames - 2);
+    float blend = frame - float(first);
+    int texel = in_bake_base + (gl_VertexID * frames + first) * 2;
+    vertex.xyz = in_bake_low.xyz + mix(texelFetch(morph_bake, texel).xyz, texelFetch(morph_bake, texel + 2).xyz, blend) * in_bake_extent.xyz;
+    tmp.xyz = in_bake_low.w + mix(texelFetch(morph_bake, texel + 1).xyz, texelFetch(morph_bake, texel + 3).xyz, blend) * in_bake_extent.w;
+#elif defined(MORPH_STREAM)
+    vertex.xyz = mix(in_morphed_position, vertex.xyz, morphing_coef / 100);
+    tmp.xyz = mix(in_morphed_normal, tmp.xyz, morphing_coef / 100);
+#elif defined(MORPH)
+    morph(vertex.xyz, tmp.xyz, morphing_coef, morph_exponent);
+#endif
+
+#ifdef MORPH_CAPTURE
+    // object space is all the capture records, rasterization is discarded
+    captured_position = vertex.xyz;
+    captured_normal = normalize(tmp.xyz);
+    captured_texcoord = in_texcoord;
+#else
+    mat4 ModelMat = fetchMatrix(world_texel);
+    mat3 NormalMat = mat3(fetchMatrix(normal_texel));
+    vec4 world_vertex = ModelMat * vertex;
+
+    gl_Position = ProjMat * ViewMat * world_vertex;
+    normal = normalize(mat3(ViewMat) * NormalMat * tmp.xyz);
+    position = (ViewMat * world_vertex).xyz;
     texcoord = in_texcoord;
+    material_index = in_material;
 
     // light params
-    sun = normalize(mat3(ViewMat) * sun_coord);
+#ifdef LIGHT_DIRECTIONAL
+    sun = normalize(mat3(ViewMat) * sun_coord.xyz);
+#endif
+#ifdef LIGHT_SPOT
     // mat3 modelView = mat3(ViewMat * ModelMat);
-    lightDirection = mat3(ViewMat) * vertex.xyz - mat3(ViewMat) * spot_position;
-    spotDirection = mat3(ViewMat) * spot_direction;
+    lightDirection = mat3(ViewMat) * world_vertex.xyz - mat3(ViewMat) * spot_position.xyz;
+    spotDirection = mat3(ViewMat) * spot_direction.xyz;
+#endif
+#endif
 }
\ No newline at end of file
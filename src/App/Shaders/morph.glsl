@@ -0,0 +1,79 @@
+// Morph of the [-1, 1] cube, linked as a second shader object into every stage that morphs:
+// the vertex stage of cube.vs, and the tessellation stages when vertices are generated there.
+// Without a #version line of its own, it is compiled with the version of the stage's main source,
+// and with the same feature defines. Users declare:
+//     void morph(inout vec3 position, inout vec3 normal, float coefficient, float exponent);
+// The coefficient is morphingCoef of the Object block, 100 keeps the cube; the exponent is only
+// read by the superellipsoid. The CPU versions are App/SpherifyKernel and App/MorphShapes.
+
+vec4 spherify(vec4 vertex, float morphing_coef) {
+    float prev_x = vertex.x;
+	float prev_y = vertex.y;
+	float prev_z = vertex.z;
+
+	float prev_x_square = prev_x * prev_x;
+	float prev_y_square = prev_y * prev_y;
+	float prev_z_square = prev_z * prev_z;
+
+    float sqrt_x = sqrt(1 - prev_y_square / 2 - prev_z_square / 2 + prev_y_square * prev_z_square / 3);
+    float sqrt_y = sqrt(1 - prev_z_square / 2 - prev_x_square / 2 + prev_x_square * prev_z_square / 3);
+    float sqrt_z = sqrt(1 - prev_x_square / 2 - prev_y_square / 2 + prev_x_square * prev_y_square / 3);
+
+    float res_x = sqrt_x + (1 - sqrt_x) / 100 * morphing_coef;
+    float res_y = sqrt_y + (1 - sqrt_y) / 100 * morphing_coef;
+    float res_z = sqrt_z + (1 - sqrt_z) / 100 * morphing_coef;
+
+    vertex.x = prev_x * res_x;
+	vertex.y = prev_y * res_y;
+	vertex.z = prev_z * res_z;
+
+    return vertex;
+}
+
+#if defined(SHAPE_SUPERELLIPSOID) || defined(SHAPE_CYLINDER) || defined(SHAPE_OCTAHEDRON) || defined(SHAPE_TORUS)
+#define MORPH_SHAPE
+#define TORUS_RING_RADIUS 0.75
+#define TORUS_TUBE_RADIUS 0.25
+
+// image of a point of the [-1, 1] cube on the shape, and the shape's normal there
+vec3 shape_target(vec3 p, float morph_exponent, out vec3 shape_normal) {
+#if defined(SHAPE_SUPERELLIPSOID)
+    vec3 powered = pow(max(abs(p), vec3(1e-6)), vec3(morph_exponent));
+    vec3 target = p * pow(powered.x + powered.y + powered.z, -1.0 / morph_exponent);
+    shape_normal = normalize(sign(p) * pow(max(abs(target), vec3(1e-6)), vec3(morph_exponent - 1.0)));
+    return target;
+#elif defined(SHAPE_CYLINDER)
+    vec3 squared = p * p;
+    vec3 target = vec3(p.x * sqrt(1.0 - squared.z * 0.5), p.y, p.z * sqrt(1.0 - squared.x * 0.5));
+    shape_normal = abs(p.y) >= max(abs(p.x), abs(p.z)) ? vec3(0.0, sign(p.y), 0.0) : normalize(vec3(target.x, 0.0, target.z));
+    return target;
+#elif defined(SHAPE_OCTAHEDRON)
+    shape_normal = normalize(sign(p));
+    return p / (abs(p.x) + abs(p.y) + abs(p.z));
+#else
+    // latitude of the spherified point around the tube, longitude around the ring
+    vec3 squared = p * p;
+    vec3 sphere = p * sqrt(1.0 - squared.yzx * 0.5 - squared.zxy * 0.5 + squared.yzx * squared.zxy / 3.0);
+    float u = atan(sphere.z, sphere.x);
+    float v = 2.0 * asin(clamp(sphere.y, -1.0, 1.0));
+    float ring = TORUS_RING_RADIUS + TORUS_TUBE_RADIUS * cos(v);
+    shape_normal = vec3(cos(v) * cos(u), sin(v), cos(v) * sin(u));
+    return vec3(ring * cos(u), TORUS_TUBE_RADIUS * sin(v), ring * sin(u));
+#endif
+}
+#endif
+
+void morph(inout vec3 position, inout vec3 normal, float coefficient, float exponent) {
+#if defined(MORPH_SHAPE)
+    vec3 shape_normal;
+    vec3 shaped = shape_target(position, exponent, shape_normal);
+    position = mix(shaped, position, coefficient / 100);
+    normal = mix(shape_normal, normal, coefficient / 100);
+#else
+    // the normal blends towards the morphed vertex taken as a vec4 with w = 1
+    vec4 vertex = spherify(vec4(position, 1), coefficient);
+    vec4 tmp = normalize(vertex) + (vec4(normal, 1) - normalize(vertex)) / 100 * coefficient;
+    position = vertex.xyz;
+    normal = tmp.xyz;
+#endif
+}
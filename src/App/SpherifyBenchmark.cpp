@@ -0,0 +1,288 @@
+#include "SpherifyBenchmark.h"
+
+#include <QElapsedTimer>
+
+#include "MorphCache.h"
+#include "MorphStream.h"
+#include "UniformBlocks.h"
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <cstring>
+#include <iostream>
+#include <random>
+
+namespace
+{
+constexpr std::array<float, 5> g_coefficients = {0.0f, 25.0f, 50.0f, 75.0f, 100.0f};
+
+constexpr std::array<MorphShapes::Shape, 5> g_shapes = {MorphShapes::Shape::Sphere, MorphShapes::Shape::Superellipsoid,
+														 MorphShapes::Shape::Cylinder, MorphShapes::Shape::Octahedron,
+														 MorphShapes::Shape::Torus};
+
+// Captured per vertex: position, then normal.
+constexpr size_t g_captured_floats = 6;
+
+// Timed per vertex: position, normal, then both morphed by MorphStream.
+constexpr size_t g_streamed_floats = 12;
+
+// Points on the faces of the [-1, 1] cube with their face normals, same seed every run.
+VertexStreams cubeSurface(const size_t count)
+{
+	VertexStreams streams;
+	streams.resize(count);
+
+	std::mt19937 random(42);
+	std::uniform_real_distribution<float> coordinate(-1.0f, 1.0f);
+	std::uniform_int_distribution<int> face(0, 5);
+	for (size_t i = 0; i < count; ++i)
+	{
+		std::array<float, 3> position = {coordinate(random), coordinate(random), coordinate(random)};
+		std::array<float, 3> normal = {0.0f, 0.0f, 0.0f};
+		const auto f = face(random);
+		const auto axis = static_cast<size_t>(f / 2);
+		const auto side = f % 2 == 0 ? 1.0f : -1.0f;
+		position[axis] = side;
+		normal[axis] = side;
+
+		streams.positionX[i] = position[0];
+		streams.positionY[i] = position[1];
+		streams.positionZ[i] = position[2];
+		streams.normalX[i] = normal[0];
+		streams.normalY[i] = normal[1];
+		streams.normalZ[i] = normal[2];
+	}
+	return streams;
+}
+}// namespace
+
+auto SpherifyBenchmark::run(fgl::GLState & state, fgl::GLResources & resources, JobSystem & jobs, const size_t vertices) -> Result
+{
+	initializeOpenGLFunctions();
+
+	const auto in = cubeSurface(std::max(vertices, ValidationVertices));
+	VertexStreams out;
+	out.resize(in.size());
+
+	Result result;
+	result.vertices = in.size();
+	result.threads = jobs.threadCount();
+	result.singleThreadRate = rate(nullptr, in, out);
+	result.multiThreadRate = rate(&jobs, in, out);
+	validate(state, resources, in, result);
+	timeStream(state, resources, jobs, in, result);
+	return result;
+}
+
+double SpherifyBenchmark::rate(JobSystem * jobs, const VertexStreams & in, VertexStreams & out)
+{
+	QElapsedTimer clock;
+	qint64 best = 0;
+	for (size_t round = 0; round < Rounds; ++round)
+	{
+		clock.start();
+		if (jobs != nullptr)
+		{
+			SpherifyKernel::morph(*jobs, in, out, 50.0f);
+		}
+		else
+		{
+			SpherifyKernel::morph(in, out, 50.0f, 0, in.size());
+		}
+		const auto elapsed = clock.nsecsElapsed();
+		best = round == 0 ? elapsed : std::min(best, elapsed);
+	}
+	return best > 0 ? static_cast<double>(in.size()) * 1e9 / static_cast<double>(best) : 0.0;
+}
+
+void SpherifyBenchmark::validate(fgl::GLState & state, fgl::GLResources & resources, const VertexStreams & in, Result & result)
+{
+	const auto count = ValidationVertices;
+	std::vector<GLfloat> interleaved(count * g_captured_floats);
+	for (size_t i = 0; i < count; ++i)
+	{
+		auto * vertex = &interleaved[i * g_captured_floats];
+		vertex[0] = in.positionX[i];
+		vertex[1] = in.positionY[i];
+		vertex[2] = in.positionZ[i];
+		vertex[3] = in.normalX[i];
+		vertex[4] = in.normalY[i];
+		vertex[5] = in.normalZ[i];
+	}
+
+	const auto size = static_cast<GLsizeiptr>(interleaved.size() * sizeof(GLfloat));
+	const auto stride = static_cast<GLsizei>(g_captured_floats * sizeof(GLfloat));
+	const auto vertexBuffer = resources.createBuffer(GL_ARRAY_BUFFER, size, interleaved.data(), false);
+	const auto vao = resources.createVertexArray();
+	resources.vertexAttribute(vao, 0, vertexBuffer, 3, GL_FLOAT, false, stride, 0);
+	resources.vertexAttribute(vao, 1, vertexBuffer, 3, GL_FLOAT, false, stride, static_cast<GLintptr>(3 * sizeof(GLfloat)));
+
+	// the Object block of the capture variant, rewritten for every coefficient
+	constexpr GLsizeiptr blockBufferSize = 256;
+	const std::vector<std::byte> zeros(blockBufferSize);
+	const auto blockBuffer = resources.createBuffer(GL_UNIFORM_BUFFER, blockBufferSize, zeros.data(), true);
+
+	// read back by the CPU, so not immutable storage without GL_MAP_READ_BIT
+	GLuint feedbackBuffer = 0;
+	glGenBuffers(1, &feedbackBuffer);
+	state.bindBuffer(GL_TRANSFORM_FEEDBACK_BUFFER, feedbackBuffer);
+	glBufferData(GL_TRANSFORM_FEEDBACK_BUFFER, size, nullptr, GL_STREAM_READ);
+
+	state.bindVertexArray(vao);
+	state.bindBufferBase(GL_UNIFORM_BUFFER, ObjectBinding, blockBuffer);
+	state.bindBufferBase(GL_TRANSFORM_FEEDBACK_BUFFER, 0, feedbackBuffer);
+	state.enable(GL_RASTERIZER_DISCARD);
+
+	VertexStreams expected;
+	expected.resize(count);
+	result.validated = true;
+	for (const auto shape : g_shapes)
+	{
+		const auto * define = MorphShapes::define(shape);
+		const auto program = MorphCache::captureProgram(*this, {"captured_position", "captured_normal"},
+														define != nullptr ? std::vector<const char *>{define} : std::vector<const char *>{});
+		if (!program)
+		{
+			std::cout << "SpherifyBenchmark: capture program of the " << MorphShapes::shapeName(shape) << " does not build" << std::endl;
+			result.validated = false;
+			break;
+		}
+		state.useProgram(program->programId());
+
+		for (const auto coefficient : g_coefficients)
+		{
+			ObjectBlock block{};
+			block.morphingCoef = coefficient;
+			block.morphExponent = MorphShapes::DefaultExponent;
+			resources.updateBuffer(GL_UNIFORM_BUFFER, blockBuffer, 0, sizeof(block), &block);
+
+			glBeginTransformFeedback(GL_POINTS);
+			glDrawArrays(GL_POINTS, 0, static_cast<GLsizei>(count));
+			glEndTransformFeedback();
+
+			MorphShapes::morph(shape, MorphShapes::DefaultExponent, in, expected, coefficient, 0, count);
+
+			state.bindBuffer(GL_TRANSFORM_FEEDBACK_BUFFER, feedbackBuffer);
+			const auto * captured = static_cast<const GLfloat *>(glMapBufferRange(GL_TRANSFORM_FEEDBACK_BUFFER, 0, size, GL_MAP_READ_BIT));
+			if (captured == nullptr)
+			{
+				result.validated = false;
+				break;
+			}
+			for (size_t i = 0; i < count; ++i)
+			{
+				const auto * vertex = &captured[i * g_captured_floats];
+				result.positionError = std::max({result.positionError,
+												 std::abs(vertex[0] - expected.positionX[i]),
+												 std::abs(vertex[1] - expected.positionY[i]),
+												 std::abs(vertex[2] - expected.positionZ[i])});
+				result.normalError = std::max({result.normalError,
+											   std::abs(vertex[3] - expected.normalX[i]),
+											   std::abs(vertex[4] - expected.normalY[i]),
+											   std::abs(vertex[5] - expected.normalZ[i])});
+			}
+			glUnmapBuffer(GL_TRANSFORM_FEEDBACK_BUFFER);
+		}
+		state.useProgram(0);
+	}
+	result.passed = result.validated && result.positionError <= Tolerance && result.normalError <= Tolerance;
+
+	state.disable(GL_RASTERIZER_DISCARD);
+	state.bindBufferBase(GL_TRANSFORM_FEEDBACK_BUFFER, 0, 0);
+	state.bindVertexArray(0);
+	state.forgetVertexArray(vao);
+	glDeleteVertexArrays(1, &vao);
+	const std::array<GLuint, 3> buffers = {vertexBuffer, blockBuffer, feedbackBuffer};
+	glDeleteBuffers(static_cast<GLsizei>(buffers.size()), buffers.data());
+}
+
+void SpherifyBenchmark::timeStream(fgl::GLState & state, fgl::GLResources & resources, JobSystem & jobs, const VertexStreams & in,
+								   Result & result)
+{
+	const auto count = in.size();
+	VertexStreams streamed;
+	streamed.resize(count);
+	MorphStream::compute(jobs, MorphShapes::Shape::Sphere, MorphShapes::DefaultExponent, in, streamed);
+
+	std::vector<GLfloat> interleaved(count * g_streamed_floats);
+	for (size_t i = 0; i < count; ++i)
+	{
+		auto * vertex = &interleaved[i * g_streamed_floats];
+		vertex[0] = in.positionX[i];
+		vertex[1] = in.positionY[i];
+		vertex[2] = in.positionZ[i];
+		vertex[3] = in.normalX[i];
+		vertex[4] = in.normalY[i];
+		vertex[5] = in.normalZ[i];
+		vertex[6] = streamed.positionX[i];
+		vertex[7] = streamed.positionY[i];
+		vertex[8] = streamed.positionZ[i];
+		vertex[9] = streamed.normalX[i];
+		vertex[10] = streamed.normalY[i];
+		vertex[11] = streamed.normalZ[i];
+	}
+
+	const auto stride = static_cast<GLsizei>(g_streamed_floats * sizeof(GLfloat));
+	const auto vertexBuffer = resources.createBuffer(GL_ARRAY_BUFFER, static_cast<GLsizeiptr>(interleaved.size() * sizeof(GLfloat)),
+													 interleaved.data(), false);
+	const auto vao = resources.createVertexArray();
+	resources.vertexAttribute(vao, 0, vertexBuffer, 3, GL_FLOAT, false, stride, 0);
+	resources.vertexAttribute(vao, 1, vertexBuffer, 3, GL_FLOAT, false, stride, static_cast<GLintptr>(3 * sizeof(GLfloat)));
+	resources.vertexAttribute(vao, MorphStream::PositionAttribute, vertexBuffer, 3, GL_FLOAT, false, stride,
+							  static_cast<GLintptr>(6 * sizeof(GLfloat)));
+	resources.vertexAttribute(vao, MorphStream::NormalAttribute, vertexBuffer, 3, GL_FLOAT, false, stride,
+							  static_cast<GLintptr>(9 * sizeof(GLfloat)));
+
+	ObjectBlock block{};
+	block.morphingCoef = 50.0f;
+	block.morphExponent = MorphShapes::DefaultExponent;
+	constexpr GLsizeiptr blockBufferSize = 256;
+	std::vector<std::byte> blocks(blockBufferSize);
+	std::memcpy(blocks.data(), &block, sizeof(block));
+	const auto blockBuffer = resources.createBuffer(GL_UNIFORM_BUFFER, blockBufferSize, blocks.data(), false);
+
+	// only written by the GPU, capturing keeps both variants from being optimized away
+	const auto feedbackBuffer = resources.createBuffer(GL_TRANSFORM_FEEDBACK_BUFFER,
+													   static_cast<GLsizeiptr>(count * g_captured_floats * sizeof(GLfloat)), nullptr, false);
+
+	state.bindVertexArray(vao);
+	state.bindBufferBase(GL_UNIFORM_BUFFER, ObjectBinding, blockBuffer);
+	state.bindBufferBase(GL_TRANSFORM_FEEDBACK_BUFFER, 0, feedbackBuffer);
+	state.enable(GL_RASTERIZER_DISCARD);
+
+	const auto time = [&](const std::vector<const char *> & defines) {
+		const auto program = MorphCache::captureProgram(*this, {"captured_position", "captured_normal"}, defines);
+		if (!program)
+		{
+			return 0.0;
+		}
+		state.useProgram(program->programId());
+		QElapsedTimer clock;
+		qint64 best = 0;
+		// the first round also warms up the program
+		for (size_t round = 0; round <= Rounds; ++round)
+		{
+			glFinish();
+			clock.start();
+			glBeginTransformFeedback(GL_POINTS);
+			glDrawArrays(GL_POINTS, 0, static_cast<GLsizei>(count));
+			glEndTransformFeedback();
+			glFinish();
+			const auto elapsed = clock.nsecsElapsed();
+			best = round <= 1 ? elapsed : std::min(best, elapsed);
+		}
+		state.useProgram(0);
+		return static_cast<double>(best) / 1e6;
+	};
+	result.shaderMorphMs = time({});
+	result.streamMorphMs = time({"MORPH_STREAM"});
+
+	state.disable(GL_RASTERIZER_DISCARD);
+	state.bindBufferBase(GL_TRANSFORM_FEEDBACK_BUFFER, 0, 0);
+	state.bindVertexArray(0);
+	state.forgetVertexArray(vao);
+	glDeleteVertexArrays(1, &vao);
+	const std::array<GLuint, 3> buffers = {vertexBuffer, blockBuffer, feedbackBuffer};
+	glDeleteBuffers(static_cast<GLsizei>(buffers.size()), buffers.data());
+}
@@ -0,0 +1,54 @@
+#pragma once
+
+#include <Base/GLResources.hpp>
+#include <Base/GLState.hpp>
+
+#include <QOpenGLExtraFunctions>
+
+#include "JobSystem.h"
+#include "MorphShapes.h"
+#include "SpherifyKernel.h"
+
+#include <cstddef>
+#include <vector>
+
+// Checks SpherifyKernel and the other MorphShapes against the GPU and measures the sphere
+// kernel's throughput on points spread over the unit cube surface. The GPU side is the MORPH
+// variant of Shaders/cube.vs built with MORPH_CAPTURE and each shape's define, whose object-space
+// morph result is recorded by transform feedback with rasterization discarded; both run at
+// several coefficients and the largest difference per component over all shapes has to stay
+// within Tolerance. The sphere's MORPH variant is also timed against its MORPH_STREAM variant,
+// which only blends with the vertices MorphStream precomputes.
+class SpherifyBenchmark final : protected QOpenGLExtraFunctions
+{
+public:
+	// GPU square roots and divisions are not correctly rounded, the kernel's are.
+	static constexpr float Tolerance = 1e-4f;
+	// Prefix of the batch that is compared against the GPU.
+	static constexpr size_t ValidationVertices = 64 * 1024;
+	// Throughput is the best of this many runs.
+	static constexpr size_t Rounds = 5;
+
+	struct Result
+	{
+		size_t vertices = 0;
+		double singleThreadRate = 0.0;// vertices per second
+		double multiThreadRate = 0.0;
+		size_t threads = 0;
+		float positionError = 0.0f;
+		float normalError = 0.0f;
+		bool validated = false;// false when a capture program could not be built
+		bool passed = false;
+		double shaderMorphMs = 0.0;// GPU time of one morph of all vertices, best of Rounds
+		double streamMorphMs = 0.0;
+	};
+
+public:
+	// Requires a current context. Bindings go through state.
+	[[nodiscard]] Result run(fgl::GLState & state, fgl::GLResources & resources, JobSystem & jobs, size_t vertices);
+
+private:
+	[[nodiscard]] double rate(JobSystem * jobs, const VertexStreams & in, VertexStreams & out);
+	void validate(fgl::GLState & state, fgl::GLResources & resources, const VertexStreams & in, Result & result);
+	void timeStream(fgl::GLState & state, fgl::GLResources & resources, JobSystem & jobs, const VertexStreams & in, Result & result);
+};
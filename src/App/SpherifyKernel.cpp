@@ -0,0 +1,196 @@
+#include "SpherifyKernel.h"
+
+#include <cmath>
+
+#if defined(__AVX__)
+#define FGL_MORPH_AVX 1
+#include <immintrin.h>
+#elif defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define FGL_MORPH_SSE 1
+#include <emmintrin.h>
+#endif
+
+namespace
+{
+// Vertices per job, large enough that a job streams through several pages of every component.
+constexpr size_t g_morph_grain = 16 * 1024;
+
+// Scale of one coordinate from the squares of the other two, as in spherify().
+float spherifyScale(const float a2, const float b2, const float t)
+{
+	const auto scale = std::sqrt(1.0f - a2 * 0.5f - b2 * 0.5f + a2 * b2 / 3.0f);
+	return scale + (1.0f - scale) * t;
+}
+
+void morphVertex(const VertexStreams & in, VertexStreams & out, const float t, const size_t i)
+{
+	const auto x = in.positionX[i];
+	const auto y = in.positionY[i];
+	const auto z = in.positionZ[i];
+	const auto x2 = x * x;
+	const auto y2 = y * y;
+	const auto z2 = z * z;
+
+	const auto px = x * spherifyScale(y2, z2, t);
+	const auto py = y * spherifyScale(z2, x2, t);
+	const auto pz = z * spherifyScale(x2, y2, t);
+
+	// morph.glsl normalizes the morphed vertex as a vec4 with w = 1
+	const auto inverseLength = 1.0f / std::sqrt(px * px + py * py + pz * pz + 1.0f);
+	const auto sx = px * inverseLength;
+	const auto sy = py * inverseLength;
+	const auto sz = pz * inverseLength;
+
+	const auto nx = sx + (in.normalX[i] - sx) * t;
+	const auto ny = sy + (in.normalY[i] - sy) * t;
+	const auto nz = sz + (in.normalZ[i] - sz) * t;
+	const auto inverseNormal = 1.0f / std::sqrt(nx * nx + ny * ny + nz * nz);
+
+	out.positionX[i] = px;
+	out.positionY[i] = py;
+	out.positionZ[i] = pz;
+	out.normalX[i] = nx * inverseNormal;
+	out.normalY[i] = ny * inverseNormal;
+	out.normalZ[i] = nz * inverseNormal;
+}
+
+#if defined(FGL_MORPH_AVX)
+__m256 spherifyScale(const __m256 a2, const __m256 b2, const __m256 t)
+{
+	const auto one = _mm256_set1_ps(1.0f);
+	const auto half = _mm256_set1_ps(0.5f);
+	auto scale = _mm256_sub_ps(one, _mm256_mul_ps(a2, half));
+	scale = _mm256_sub_ps(scale, _mm256_mul_ps(b2, half));
+	scale = _mm256_add_ps(scale, _mm256_div_ps(_mm256_mul_ps(a2, b2), _mm256_set1_ps(3.0f)));
+	scale = _mm256_sqrt_ps(scale);
+	return _mm256_add_ps(scale, _mm256_mul_ps(_mm256_sub_ps(one, scale), t));
+}
+#elif defined(FGL_MORPH_SSE)
+__m128 spherifyScale(const __m128 a2, const __m128 b2, const __m128 t)
+{
+	const auto one = _mm_set1_ps(1.0f);
+	const auto half = _mm_set1_ps(0.5f);
+	auto scale = _mm_sub_ps(one, _mm_mul_ps(a2, half));
+	scale = _mm_sub_ps(scale, _mm_mul_ps(b2, half));
+	scale = _mm_add_ps(scale, _mm_div_ps(_mm_mul_ps(a2, b2), _mm_set1_ps(3.0f)));
+	scale = _mm_sqrt_ps(scale);
+	return _mm_add_ps(scale, _mm_mul_ps(_mm_sub_ps(one, scale), t));
+}
+#endif
+}// namespace
+
+void VertexStreams::resize(const size_t count)
+{
+	positionX.resize(count);
+	positionY.resize(count);
+	positionZ.resize(count);
+	normalX.resize(count);
+	normalY.resize(count);
+	normalZ.resize(count);
+}
+
+void SpherifyKernel::morph(const VertexStreams & in, VertexStreams & out, const float coefficient,
+						   const size_t first, const size_t last)
+{
+	const auto t = coefficient / 100.0f;
+	auto index = first;
+
+#if defined(FGL_MORPH_AVX)
+	const auto one = _mm256_set1_ps(1.0f);
+	const auto tv = _mm256_set1_ps(t);
+	for (; index + 8 <= last; index += 8)
+	{
+		const auto x = _mm256_loadu_ps(&in.positionX[index]);
+		const auto y = _mm256_loadu_ps(&in.positionY[index]);
+		const auto z = _mm256_loadu_ps(&in.positionZ[index]);
+		const auto x2 = _mm256_mul_ps(x, x);
+		const auto y2 = _mm256_mul_ps(y, y);
+		const auto z2 = _mm256_mul_ps(z, z);
+
+		const auto px = _mm256_mul_ps(x, spherifyScale(y2, z2, tv));
+		const auto py = _mm256_mul_ps(y, spherifyScale(z2, x2, tv));
+		const auto pz = _mm256_mul_ps(z, spherifyScale(x2, y2, tv));
+
+		auto length = _mm256_add_ps(_mm256_mul_ps(px, px), _mm256_mul_ps(py, py));
+		length = _mm256_add_ps(length, _mm256_mul_ps(pz, pz));
+		const auto inverseLength = _mm256_div_ps(one, _mm256_sqrt_ps(_mm256_add_ps(length, one)));
+		const auto sx = _mm256_mul_ps(px, inverseLength);
+		const auto sy = _mm256_mul_ps(py, inverseLength);
+		const auto sz = _mm256_mul_ps(pz, inverseLength);
+
+		const auto nx = _mm256_add_ps(sx, _mm256_mul_ps(_mm256_sub_ps(_mm256_loadu_ps(&in.normalX[index]), sx), tv));
+		const auto ny = _mm256_add_ps(sy, _mm256_mul_ps(_mm256_sub_ps(_mm256_loadu_ps(&in.normalY[index]), sy), tv));
+		const auto nz = _mm256_add_ps(sz, _mm256_mul_ps(_mm256_sub_ps(_mm256_loadu_ps(&in.normalZ[index]), sz), tv));
+		auto normalLength = _mm256_add_ps(_mm256_mul_ps(nx, nx), _mm256_mul_ps(ny, ny));
+		normalLength = _mm256_add_ps(normalLength, _mm256_mul_ps(nz, nz));
+		const auto inverseNormal = _mm256_div_ps(one, _mm256_sqrt_ps(normalLength));
+
+		_mm256_storeu_ps(&out.positionX[index], px);
+		_mm256_storeu_ps(&out.positionY[index], py);
+		_mm256_storeu_ps(&out.positionZ[index], pz);
+		_mm256_storeu_ps(&out.normalX[index], _mm256_mul_ps(nx, inverseNormal));
+		_mm256_storeu_ps(&out.normalY[index], _mm256_mul_ps(ny, inverseNormal));
+		_mm256_storeu_ps(&out.normalZ[index], _mm256_mul_ps(nz, inverseNormal));
+	}
+#elif defined(FGL_MORPH_SSE)
+	const auto one = _mm_set1_ps(1.0f);
+	const auto tv = _mm_set1_ps(t);
+	for (; index + 4 <= last; index += 4)
+	{
+		const auto x = _mm_loadu_ps(&in.positionX[index]);
+		const auto y = _mm_loadu_ps(&in.positionY[index]);
+		const auto z = _mm_loadu_ps(&in.positionZ[index]);
+		const auto x2 = _mm_mul_ps(x, x);
+		const auto y2 = _mm_mul_ps(y, y);
+		const auto z2 = _mm_mul_ps(z, z);
+
+		const auto px = _mm_mul_ps(x, spherifyScale(y2, z2, tv));
+		const auto py = _mm_mul_ps(y, spherifyScale(z2, x2, tv));
+		const auto pz = _mm_mul_ps(z, spherifyScale(x2, y2, tv));
+
+		auto length = _mm_add_ps(_mm_mul_ps(px, px), _mm_mul_ps(py, py));
+		length = _mm_add_ps(length, _mm_mul_ps(pz, pz));
+		const auto inverseLength = _mm_div_ps(one, _mm_sqrt_ps(_mm_add_ps(length, one)));
+		const auto sx = _mm_mul_ps(px, inverseLength);
+		const auto sy = _mm_mul_ps(py, inverseLength);
+		const auto sz = _mm_mul_ps(pz, inverseLength);
+
+		const auto nx = _mm_add_ps(sx, _mm_mul_ps(_mm_sub_ps(_mm_loadu_ps(&in.normalX[index]), sx), tv));
+		const auto ny = _mm_add_ps(sy, _mm_mul_ps(_mm_sub_ps(_mm_loadu_ps(&in.normalY[index]), sy), tv));
+		const auto nz = _mm_add_ps(sz, _mm_mul_ps(_mm_sub_ps(_mm_loadu_ps(&in.normalZ[index]), sz), tv));
+		auto normalLength = _mm_add_ps(_mm_mul_ps(nx, nx), _mm_mul_ps(ny, ny));
+		normalLength = _mm_add_ps(normalLength, _mm_mul_ps(nz, nz));
+		const auto inverseNormal = _mm_div_ps(one, _mm_sqrt_ps(normalLength));
+
+		_mm_storeu_ps(&out.positionX[index], px);
+		_mm_storeu_ps(&out.positionY[index], py);
+		_mm_storeu_ps(&out.positionZ[index], pz);
+		_mm_storeu_ps(&out.normalX[index], _mm_mul_ps(nx, inverseNormal));
+		_mm_storeu_ps(&out.normalY[index], _mm_mul_ps(ny, inverseNormal));
+		_mm_storeu_ps(&out.normalZ[index], _mm_mul_ps(nz, inverseNormal));
+	}
+#endif
+
+	for (; index < last; ++index)
+	{
+		morphVertex(in, out, t, index);
+	}
+}
+
+void SpherifyKernel::morph(JobSystem & jobs, const VertexStreams & in, VertexStreams & out, const float coefficient)
+{
+	jobs.parallelFor(0, in.size(), g_morph_grain, [&](const size_t first, const size_t last) {
+		morph(in, out, coefficient, first, last);
+	});
+}
+
+const char * SpherifyKernel::kernelName() noexcept
+{
+#if defined(FGL_MORPH_AVX)
+	return "avx";
+#elif defined(FGL_MORPH_SSE)
+	return "sse2";
+#else
+	return "scalar";
+#endif
+}
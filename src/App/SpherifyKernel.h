@@ -0,0 +1,39 @@
+#pragma once
+
+#include "JobSystem.h"
+
+#include <cstddef>
+#include <vector>
+
+// Vertex positions and normals as one array per component, so the morph kernel
+// loads 8 (AVX) or 4 (SSE) vertices of a component at once.
+struct VertexStreams
+{
+	std::vector<float> positionX;
+	std::vector<float> positionY;
+	std::vector<float> positionZ;
+	std::vector<float> normalX;
+	std::vector<float> normalY;
+	std::vector<float> normalZ;
+
+	void resize(size_t count);
+	[[nodiscard]] size_t size() const noexcept { return positionX.size(); }
+};
+
+// CPU version of spherify() and the normal blend in Shaders/morph.glsl, for code that needs
+// the morphed surface, such as picking against the drawn triangles. The coefficient has the
+// meaning of morphingCoef in the Object block: 100 keeps the cube, 0 is the sphere.
+// Normals come out normalized; cube.vs normalizes after the normal matrix, which gives
+// the same direction.
+class SpherifyKernel final
+{
+public:
+	// Morphs vertices [first, last) of in into the same range of out, out must be as large as in.
+	static void morph(const VertexStreams & in, VertexStreams & out, float coefficient, size_t first, size_t last);
+
+	// Morphs all vertices, split across the job system.
+	static void morph(JobSystem & jobs, const VertexStreams & in, VertexStreams & out, float coefficient);
+
+	// Name of the kernel compiled into this build.
+	[[nodiscard]] static const char * kernelName() noexcept;
+};
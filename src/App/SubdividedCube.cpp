@@ -0,0 +1,164 @@
+#include "SubdividedCube.h"
+
+#include <glm/glm.hpp>
+
+#include <algorithm>
+#include <array>
+#include <cstdint>
+#include <cstring>
+
+namespace
+{
+constexpr size_t g_faces = 6;
+
+// Outward normal and the two in-plane axes of a face, with u x v = normal so that quads
+// listed along u then v wind counter-clockwise seen from outside.
+struct Face
+{
+	glm::vec3 normal;
+	glm::vec3 u;
+	glm::vec3 v;
+};
+
+constexpr std::array<Face, g_faces> g_cube_faces = {{
+	{{1.0f, 0.0f, 0.0f}, {0.0f, 0.0f, -1.0f}, {0.0f, 1.0f, 0.0f}},
+	{{-1.0f, 0.0f, 0.0f}, {0.0f, 0.0f, 1.0f}, {0.0f, 1.0f, 0.0f}},
+	{{0.0f, 1.0f, 0.0f}, {1.0f, 0.0f, 0.0f}, {0.0f, 0.0f, -1.0f}},
+	{{0.0f, -1.0f, 0.0f}, {1.0f, 0.0f, 0.0f}, {0.0f, 0.0f, 1.0f}},
+	{{0.0f, 0.0f, 1.0f}, {1.0f, 0.0f, 0.0f}, {0.0f, 1.0f, 0.0f}},
+	{{0.0f, 0.0f, -1.0f}, {-1.0f, 0.0f, 0.0f}, {0.0f, 1.0f, 0.0f}},
+}};
+
+// Rows of vertices or quads per job.
+constexpr size_t g_row_grain = 16;
+
+int addView(tinygltf::Model & model, const size_t offset, const size_t length, const int target)
+{
+	tinygltf::BufferView view;
+	view.buffer = 0;
+	view.byteOffset = offset;
+	view.byteLength = length;
+	view.target = target;
+	model.bufferViews.push_back(view);
+	return static_cast<int>(model.bufferViews.size() - 1);
+}
+
+int addAccessor(tinygltf::Model & model, const int view, const int componentType, const int type, const size_t count)
+{
+	tinygltf::Accessor accessor;
+	accessor.bufferView = view;
+	accessor.byteOffset = 0;
+	accessor.componentType = componentType;
+	accessor.type = type;
+	accessor.count = count;
+	model.accessors.push_back(accessor);
+	return static_cast<int>(model.accessors.size() - 1);
+}
+}// namespace
+
+tinygltf::Model SubdividedCube::build(const size_t subdivisions, JobSystem & jobs)
+{
+	const auto n = std::clamp<size_t>(subdivisions, 1, MaxSubdivisions);
+	const auto side = n + 1;
+	const auto vertices = vertexCount(n);
+	const auto indices = indexCount(n);
+
+	// one buffer: positions, normals, texture coordinates, then indices
+	const auto positionOffset = size_t{0};
+	const auto normalOffset = positionOffset + vertices * sizeof(glm::vec3);
+	const auto texcoordOffset = normalOffset + vertices * sizeof(glm::vec3);
+	const auto indexOffset = texcoordOffset + vertices * sizeof(glm::vec2);
+
+	tinygltf::Model model;
+	model.asset.version = "2.0";
+	model.asset.generator = "SubdividedCube";
+	model.buffers.emplace_back();
+	auto & data = model.buffers.front().data;
+	data.resize(indexOffset + indices * sizeof(std::uint32_t));
+	auto * const bytes = data.data();
+
+	// vertex (i, j) of a face sits at normal + (2i/n - 1) u + (2j/n - 1) v
+	jobs.parallelFor(0, g_faces * side, g_row_grain, [&](const size_t first, const size_t last) {
+		for (auto row = first; row < last; ++row)
+		{
+			const auto & face = g_cube_faces[row / side];
+			const auto j = row % side;
+			const auto y = 2.0f * static_cast<float>(j) / static_cast<float>(n) - 1.0f;
+			for (size_t i = 0; i < side; ++i)
+			{
+				const auto x = 2.0f * static_cast<float>(i) / static_cast<float>(n) - 1.0f;
+				const auto vertex = row * side + i;
+				const auto position = face.normal + x * face.u + y * face.v;
+				const glm::vec2 texcoord(static_cast<float>(i) / static_cast<float>(n), 1.0f - static_cast<float>(j) / static_cast<float>(n));
+				std::memcpy(bytes + positionOffset + vertex * sizeof(glm::vec3), &position, sizeof(glm::vec3));
+				std::memcpy(bytes + normalOffset + vertex * sizeof(glm::vec3), &face.normal, sizeof(glm::vec3));
+				std::memcpy(bytes + texcoordOffset + vertex * sizeof(glm::vec2), &texcoord, sizeof(glm::vec2));
+			}
+		}
+	});
+
+	// two triangles per quad, counter-clockwise from outside
+	jobs.parallelFor(0, g_faces * n, g_row_grain, [&](const size_t first, const size_t last) {
+		for (auto row = first; row < last; ++row)
+		{
+			const auto face = row / n;
+			const auto j = row % n;
+			const auto base = static_cast<std::uint32_t>(face * side * side + j * side);
+			for (size_t i = 0; i < n; ++i)
+			{
+				const auto a = base + static_cast<std::uint32_t>(i);
+				const auto b = a + 1;
+				const auto d = a + static_cast<std::uint32_t>(side);
+				const auto c = d + 1;
+				const std::array<std::uint32_t, 6> quad = {a, b, c, a, c, d};
+				std::memcpy(bytes + indexOffset + (row * n + i) * sizeof(quad), quad.data(), sizeof(quad));
+			}
+		}
+	});
+
+	const auto positions = addAccessor(model, addView(model, positionOffset, vertices * sizeof(glm::vec3), TINYGLTF_TARGET_ARRAY_BUFFER),
+									   TINYGLTF_COMPONENT_TYPE_FLOAT, TINYGLTF_TYPE_VEC3, vertices);
+	// culling reads the bounds from here, as from any glTF file
+	model.accessors[positions].minValues = {-1.0, -1.0, -1.0};
+	model.accessors[positions].maxValues = {1.0, 1.0, 1.0};
+	const auto normals = addAccessor(model, addView(model, normalOffset, vertices * sizeof(glm::vec3), TINYGLTF_TARGET_ARRAY_BUFFER),
+									 TINYGLTF_COMPONENT_TYPE_FLOAT, TINYGLTF_TYPE_VEC3, vertices);
+	const auto texcoords = addAccessor(model, addView(model, texcoordOffset, vertices * sizeof(glm::vec2), TINYGLTF_TARGET_ARRAY_BUFFER),
+									   TINYGLTF_COMPONENT_TYPE_FLOAT, TINYGLTF_TYPE_VEC2, vertices);
+	const auto indexAccessor = addAccessor(model,
+										   addView(model, indexOffset, indices * sizeof(std::uint32_t), TINYGLTF_TARGET_ELEMENT_ARRAY_BUFFER),
+										   TINYGLTF_COMPONENT_TYPE_UNSIGNED_INT, TINYGLTF_TYPE_SCALAR, indices);
+
+	tinygltf::Primitive primitive;
+	primitive.attributes["POSITION"] = positions;
+	primitive.attributes["NORMAL"] = normals;
+	primitive.attributes["TEXCOORD_0"] = texcoords;
+	primitive.indices = indexAccessor;
+	primitive.material = -1;
+	primitive.mode = TINYGLTF_MODE_TRIANGLES;
+
+	tinygltf::Mesh mesh;
+	mesh.name = "SubdividedCube";
+	mesh.primitives.push_back(primitive);
+	model.meshes.push_back(mesh);
+
+	tinygltf::Node node;
+	node.mesh = 0;
+	model.nodes.push_back(node);
+
+	tinygltf::Scene scene;
+	scene.nodes.push_back(0);
+	model.scenes.push_back(scene);
+	model.defaultScene = 0;
+	return model;
+}
+
+size_t SubdividedCube::vertexCount(const size_t subdivisions) noexcept
+{
+	return g_faces * (subdivisions + 1) * (subdivisions + 1);
+}
+
+size_t SubdividedCube::indexCount(const size_t subdivisions) noexcept
+{
+	return g_faces * subdivisions * subdivisions * 6;
+}
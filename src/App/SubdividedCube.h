@@ -0,0 +1,27 @@
+#pragma once
+
+#include "JobSystem.h"
+
+#include <cstddef>
+
+#include <tinygltf/tiny_gltf.h>
+
+// Procedural [-1, 1] cube with N x N quads per face, built as an in-memory glTF model so it
+// takes the same upload, culling and draw path as a loaded file. Vertices are shared within a
+// face, each face keeping its own border vertices so the normals stay flat up to the edges;
+// every face maps the whole [0, 1] texture square. The mesh has 6 (N + 1)^2 vertices and
+// 36 N^2 32-bit indices in one primitive with the default material, which makes the vertex
+// count of the morph, upload and culling paths a command-line knob instead of an asset.
+class SubdividedCube final
+{
+public:
+	// 25 million vertices and 150 million indices, about 1.4 GB of buffers.
+	static constexpr size_t MaxSubdivisions = 2048;
+
+public:
+	// Subdivisions are clamped to [1, MaxSubdivisions]. Rows are filled on the job system.
+	[[nodiscard]] static tinygltf::Model build(size_t subdivisions, JobSystem & jobs);
+
+	[[nodiscard]] static size_t vertexCount(size_t subdivisions) noexcept;
+	[[nodiscard]] static size_t indexCount(size_t subdivisions) noexcept;
+};
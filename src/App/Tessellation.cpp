@@ -0,0 +1,63 @@
+#include "Tessellation.h"
+
+#include "ShaderFeatures.h"
+
+#include <QOpenGLContext>
+
+#include <iostream>
+
+#ifndef GL_PATCH_VERTICES
+#define GL_PATCH_VERTICES 0x8E72
+#endif
+
+void Tessellation::create(fgl::ShaderCache & shaders)
+{
+	patchParameteri_ = nullptr;
+	const auto context = QOpenGLContext::currentContext();
+	if (mode_ == Mode::Off || context == nullptr || context->isOpenGLES())
+	{
+		return;
+	}
+	// cube.tcs and cube.tes are #version 400, the extension alone does not compile them
+	if (context->format().version() < qMakePair(4, 0))
+	{
+		std::cout << "Tessellation: needs GL 4.0, morphing stays in the vertex shader" << std::endl;
+		return;
+	}
+	if (shaders.program(MorphFeature | TessellationFeature) == 0)
+	{
+		std::cout << "Tessellation: the tessellation shaders do not build, morphing stays in the vertex shader" << std::endl;
+		return;
+	}
+
+	patchParameteri_ = reinterpret_cast<PatchParameteriProc>(context->getProcAddress("glPatchParameteri"));
+	if (patchParameteri_ != nullptr)
+	{
+		// every tessellated draw is a triangle list, patches never change size
+		patchParameteri_(GL_PATCH_VERTICES, 3);
+	}
+}
+
+const char * Tessellation::modeName(const Mode mode) noexcept
+{
+	switch (mode)
+	{
+		case Mode::Off:
+			return "off";
+		case Mode::On:
+			return "on";
+	}
+	return "";
+}
+
+std::optional<Tessellation::Mode> Tessellation::parseMode(const QString & name)
+{
+	for (const auto mode : {Mode::Off, Mode::On})
+	{
+		if (name == QLatin1String(modeName(mode)))
+		{
+			return mode;
+		}
+	}
+	return std::nullopt;
+}
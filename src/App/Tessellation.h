@@ -0,0 +1,57 @@
+#pragma once
+
+#include <Base/ShaderCache.hpp>
+
+#include <QOpenGLExtraFunctions>
+#include <QString>
+
+#include <glm/glm.hpp>
+
+#include <optional>
+
+// Optional GL 4.0 tessellation of morphing triangle draws. The vertex stage of cube.vs only
+// passes the cube through; cube.tcs picks a level per edge and cube.tes morphs every generated
+// vertex with Shaders/morph.glsl, so the silhouette is smooth however coarse the mesh is.
+// An edge is split until its midpoint lies within TolerancePixels of the morphed surface on
+// screen, the deviation falling with the square of the level, but not into segments shorter
+// than MinEdgePixels: small or distant objects and a flat cube stay at level 1.
+// Frames that do not morph draw as before. Without a GL 4.0 context, whose version the
+// tessellation stages declare, or when a TESSELLATION variant does not link, the mode falls
+// back to off.
+class Tessellation final
+{
+public:
+	enum class Mode
+	{
+		Off,
+		On,
+	};
+
+	static constexpr float TolerancePixels = 0.5f;
+	static constexpr float MinEdgePixels = 4.0f;
+	// Within the GL_MAX_TESS_GEN_LEVEL of 64 every implementation has.
+	static constexpr float MaxLevel = 32.0f;
+
+public:
+	void setMode(Mode mode) noexcept { mode_ = mode; }
+	[[nodiscard]] Mode mode() const noexcept { return mode_; }
+
+	// Requires a current context, sets up triangle patches when tessellation is available and a
+	// morphing TESSELLATION variant of shaders builds.
+	void create(fgl::ShaderCache & shaders);
+
+	[[nodiscard]] bool supported() const noexcept { return patchParameteri_ != nullptr; }
+	[[nodiscard]] bool active() const noexcept { return mode_ == Mode::On && supported(); }
+
+	// Tessellation vector of the Camera block.
+	[[nodiscard]] static glm::vec4 parameters() noexcept { return {TolerancePixels, MinEdgePixels, MaxLevel, 0.0f}; }
+
+	[[nodiscard]] static const char * modeName(Mode mode) noexcept;
+	[[nodiscard]] static std::optional<Mode> parseMode(const QString & name);
+
+private:
+	using PatchParameteriProc = void(QOPENGLF_APIENTRYP)(GLenum pname, GLint value);
+
+	Mode mode_ = Mode::Off;
+	PatchParameteriProc patchParameteri_ = nullptr;
+};
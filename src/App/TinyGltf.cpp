@@ -0,0 +1,6 @@
+// tinygltf and stb are header-only; their implementation is compiled once, here.
+#define TINYGLTF_IMPLEMENTATION
+#define STB_IMAGE_IMPLEMENTATION
+#define STB_IMAGE_WRITE_IMPLEMENTATION
+
+#include <tinygltf/tiny_gltf.h>
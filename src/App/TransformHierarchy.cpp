@@ -0,0 +1,242 @@
+#include "TransformHierarchy.h"
+
+#include <glm/gtc/matrix_inverse.hpp>
+#include <glm/gtc/matrix_transform.hpp>
+#include <glm/gtc/type_ptr.hpp>
+
+#include <algorithm>
+
+namespace
+{
+// Nodes below this count are updated on the calling thread.
+constexpr size_t g_parallel_grain = 2048;
+
+glm::mat4 composeTRS(const glm::vec3 & translation, const glm::quat & rotation, const glm::vec3 & scale)
+{
+	return glm::translate(glm::mat4(1.0f), translation)
+		* glm::mat4_cast(rotation)
+		* glm::scale(glm::mat4(1.0f), scale);
+}
+}// namespace
+
+void TransformHierarchy::build(const tinygltf::Model & model, const int sceneIndex)
+{
+	*this = TransformHierarchy{};
+	flatIndex_.assign(model.nodes.size(), NoParent);
+
+	if (sceneIndex < 0 || static_cast<size_t>(sceneIndex) >= model.scenes.size())
+	{
+		return;
+	}
+
+	for (const auto root : model.scenes[sceneIndex].nodes)
+	{
+		append(model, root, NoParent);
+	}
+
+	world_.resize(size());
+	normal_.resize(size());
+	changed_.resize(size());
+	dirty_.assign(size(), 1);
+	dirtyCount_ = size();
+}
+
+void TransformHierarchy::append(const tinygltf::Model & model, const int gltfNode, const int parent)
+{
+	const auto & node = model.nodes[gltfNode];
+	const auto index = size();
+
+	parent_.push_back(parent);
+	subtreeEnd_.push_back(index + 1);
+	gltfNode_.push_back(gltfNode);
+	flatIndex_[gltfNode] = static_cast<int>(index);
+
+	glm::vec3 translation(0.0f);
+	glm::quat rotation(1.0f, 0.0f, 0.0f, 0.0f);
+	glm::vec3 scale(1.0f);
+	glm::mat4 local(1.0f);
+
+	if (node.matrix.size() == 16)
+	{
+		local = glm::mat4(glm::make_mat4(node.matrix.data()));
+	}
+	else
+	{
+		if (node.translation.size() == 3)
+		{
+			translation = glm::vec3(glm::make_vec3(node.translation.data()));
+		}
+		if (node.rotation.size() == 4)
+		{
+			// glTF stores quaternions as (x, y, z, w)
+			rotation = glm::quat(static_cast<float>(node.rotation[3]), static_cast<float>(node.rotation[0]),
+								 static_cast<float>(node.rotation[1]), static_cast<float>(node.rotation[2]));
+		}
+		if (node.scale.size() == 3)
+		{
+			scale = glm::vec3(glm::make_vec3(node.scale.data()));
+		}
+		local = composeTRS(translation, rotation, scale);
+	}
+
+	translation_.push_back(translation);
+	rotation_.push_back(rotation);
+	scale_.push_back(scale);
+	local_.push_back(local);
+
+	for (const auto child : node.children)
+	{
+		append(model, child, static_cast<int>(index));
+	}
+
+	subtreeEnd_[index] = size();
+}
+
+int TransformHierarchy::indexOf(const int gltfNode) const
+{
+	if (gltfNode < 0 || static_cast<size_t>(gltfNode) >= flatIndex_.size())
+	{
+		return NoParent;
+	}
+	return flatIndex_[gltfNode];
+}
+
+void TransformHierarchy::setRootTransform(const glm::mat4 & transform)
+{
+	if (transform != root_)
+	{
+		root_ = transform;
+		rootDirty_ = true;
+	}
+}
+
+void TransformHierarchy::setLocal(const size_t index, const glm::vec3 & translation, const glm::quat & rotation, const glm::vec3 & scale)
+{
+	translation_[index] = translation;
+	rotation_[index] = rotation;
+	scale_[index] = scale;
+	local_[index] = composeTRS(translation, rotation, scale);
+	markDirty(index);
+}
+
+void TransformHierarchy::setLocalMatrix(const size_t index, const glm::mat4 & matrix)
+{
+	local_[index] = matrix;
+	markDirty(index);
+}
+
+void TransformHierarchy::markDirty(const size_t index)
+{
+	if (!dirty_[index])
+	{
+		dirty_[index] = 1;
+		++dirtyCount_;
+	}
+}
+
+auto TransformHierarchy::update() -> Range
+{
+	if (dirtyCount_ == 0 && !rootDirty_)
+	{
+		return {};
+	}
+
+	const auto range = updateNodes(0, size());
+	dirtyCount_ = 0;
+	rootDirty_ = false;
+	return range;
+}
+
+auto TransformHierarchy::update(JobSystem & jobs) -> Range
+{
+	if (dirtyCount_ == 0 && !rootDirty_)
+	{
+		return {};
+	}
+
+	// The scene roots form one run of sibling subtrees.
+	const auto range = updateSiblings(0, size(), jobs);
+	dirtyCount_ = 0;
+	rootDirty_ = false;
+	return range;
+}
+
+auto TransformHierarchy::updateNodes(const size_t first, const size_t last) -> Range
+{
+	Range range{size(), 0};
+
+	for (size_t index = first; index < last; ++index)
+	{
+		const auto parent = parent_[index];
+		const bool parentChanged = parent == NoParent ? rootDirty_ : changed_[parent] != 0;
+
+		changed_[index] = dirty_[index] || parentChanged;
+		if (!changed_[index])
+		{
+			continue;
+		}
+
+		const auto & parentWorld = parent == NoParent ? root_ : world_[parent];
+		world_[index] = parentWorld * local_[index];
+		normal_[index] = glm::mat4(glm::inverseTranspose(glm::mat3(world_[index])));
+		dirty_[index] = 0;
+
+		range.first = std::min(range.first, index);
+		range.last = index + 1;
+	}
+
+	return range;
+}
+
+auto TransformHierarchy::updateSiblings(size_t first, size_t last, JobSystem & jobs) -> Range
+{
+	Range range{size(), 0};
+	const auto merge = [&range](const Range & other) {
+		range.first = std::min(range.first, other.first);
+		range.last = std::max(range.last, other.last);
+	};
+
+	while (last - first > g_parallel_grain)
+	{
+		// A single subtree: its root goes first, after that its children are siblings again.
+		if (subtreeEnd_[first] == last)
+		{
+			merge(updateNodes(first, first + 1));
+			++first;
+			continue;
+		}
+
+		// Split the run at the sibling boundary closest to the middle.
+		auto split = subtreeEnd_[first];
+		while (subtreeEnd_[split] < last && split - first < (last - first) / 2)
+		{
+			split = subtreeEnd_[split];
+		}
+
+		// A small side is not worth a job, update it here and keep descending into the large one.
+		if (split - first < g_parallel_grain)
+		{
+			merge(updateNodes(first, split));
+			first = split;
+			continue;
+		}
+		if (last - split < g_parallel_grain)
+		{
+			merge(updateNodes(split, last));
+			last = split;
+			continue;
+		}
+
+		// Both halves only read parents that are already up to date.
+		Range left{size(), 0};
+		Range right{size(), 0};
+		jobs.invoke([&] { left = updateSiblings(first, split, jobs); },
+					[&] { right = updateSiblings(split, last, jobs); });
+		merge(left);
+		merge(right);
+		return range;
+	}
+
+	merge(updateNodes(first, last));
+	return range;
+}
@@ -0,0 +1,88 @@
+#pragma once
+
+#include "JobSystem.h"
+
+#include <glm/glm.hpp>
+#include <glm/gtc/quaternion.hpp>
+
+#include <tinygltf/tiny_gltf.h>
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// Node transforms of a glTF scene flattened into structure-of-arrays storage.
+// Nodes are stored in depth-first pre-order, so parents always precede their children
+// and every subtree occupies a contiguous index range.
+class TransformHierarchy final
+{
+public:
+	static constexpr int NoParent = -1;
+
+	// Half-open range of flat indices whose world transforms changed in the last update().
+	struct Range
+	{
+		size_t first = 0;
+		size_t last = 0;
+
+		[[nodiscard]] bool empty() const noexcept { return first >= last; }
+	};
+
+public:
+	void build(const tinygltf::Model & model, int sceneIndex);
+
+	// Transform applied on top of every scene root.
+	void setRootTransform(const glm::mat4 & transform);
+
+	void setLocal(size_t index, const glm::vec3 & translation, const glm::quat & rotation, const glm::vec3 & scale);
+	void setLocalMatrix(size_t index, const glm::mat4 & matrix);
+
+	// Recomputes world and normal matrices of dirty nodes and their descendants only.
+	Range update();
+
+	// Same, with independent subtrees updated in parallel.
+	Range update(JobSystem & jobs);
+
+	[[nodiscard]] size_t size() const noexcept { return parent_.size(); }
+	[[nodiscard]] int indexOf(int gltfNode) const;
+	[[nodiscard]] int gltfNode(size_t index) const { return gltfNode_[index]; }
+	[[nodiscard]] int parent(size_t index) const { return parent_[index]; }
+	[[nodiscard]] size_t subtreeEnd(size_t index) const { return subtreeEnd_[index]; }
+
+	[[nodiscard]] const glm::mat4 & world(size_t index) const { return world_[index]; }
+	[[nodiscard]] const std::vector<glm::mat4> & worlds() const noexcept { return world_; }
+	[[nodiscard]] const std::vector<glm::mat4> & normals() const noexcept { return normal_; }
+
+private:
+	void append(const tinygltf::Model & model, int gltfNode, int parent);
+	void markDirty(size_t index);
+
+	Range updateNodes(size_t first, size_t last);
+	// [first, last) holds whole sibling subtrees whose parents are up to date.
+	Range updateSiblings(size_t first, size_t last, JobSystem & jobs);
+
+private:
+	// hierarchy
+	std::vector<int> parent_;
+	std::vector<size_t> subtreeEnd_;
+	std::vector<int> gltfNode_;
+	std::vector<int> flatIndex_;
+
+	// local transforms
+	std::vector<glm::vec3> translation_;
+	std::vector<glm::quat> rotation_;
+	std::vector<glm::vec3> scale_;
+	std::vector<glm::mat4> local_;
+
+	// results
+	std::vector<glm::mat4> world_;
+	std::vector<glm::mat4> normal_;
+
+	// change tracking
+	std::vector<std::uint8_t> dirty_;
+	std::vector<std::uint8_t> changed_;
+	size_t dirtyCount_ = 0;
+
+	glm::mat4 root_{1.0f};
+	bool rootDirty_ = true;
+};
@@ -0,0 +1,141 @@
+#include "Transparency.h"
+
+#include <algorithm>
+#include <cstring>
+#include <iostream>
+#include <numeric>
+
+namespace
+{
+constexpr double g_ns_per_ms = 1e6;
+
+// Unsigned key with the order of the float: negatives are flipped entirely, positives get the sign bit.
+std::uint32_t sortableKey(const float value)
+{
+	std::uint32_t bits = 0;
+	std::memcpy(&bits, &value, sizeof(bits));
+	return (bits & 0x80000000u) != 0 ? ~bits : bits | 0x80000000u;
+}
+}// namespace
+
+Transparency::~Transparency()
+{
+	// GL objects are expected to be released with destroy() while the context is current.
+	Q_ASSERT(vao_ == 0);
+}
+
+void Transparency::create(fgl::GLState & state, fgl::GLResources & resources)
+{
+	initializeOpenGLFunctions();
+	state_ = &state;
+	clock_.start();
+
+	composite_ = std::make_unique<QOpenGLShaderProgram>();
+	if (!composite_->addShaderFromSourceFile(QOpenGLShader::Vertex, ":/Shaders/composite.vs")
+		|| !composite_->addShaderFromSourceFile(QOpenGLShader::Fragment, ":/Shaders/composite.fs")
+		|| !composite_->link())
+	{
+		std::cout << "Transparency: composite program does not build" << std::endl;
+	}
+
+	state_->useProgram(composite_->programId());
+	composite_->setUniformValue("opaque_image", static_cast<GLint>(CompositeUnits[0]));
+	composite_->setUniformValue("accumulation", static_cast<GLint>(CompositeUnits[1]));
+	composite_->setUniformValue("weights", static_cast<GLint>(CompositeUnits[2]));
+
+	vao_ = resources.createVertexArray();
+}
+
+void Transparency::destroy()
+{
+	if (vao_ != 0)
+	{
+		state_->forgetVertexArray(vao_);
+		glDeleteVertexArrays(1, &vao_);
+		vao_ = 0;
+	}
+	composite_.reset();
+}
+
+// LSD radix sort on inverted keys, so the farthest draw comes first; passes whose digit
+// is the same for every key leave the order as it is and are skipped
+void Transparency::sort(const std::vector<float> & depths, std::vector<std::uint32_t> & order)
+{
+	const auto start = clock_.nsecsElapsed();
+	const auto count = depths.size();
+
+	keys_.resize(count);
+	order.resize(count);
+	scratchKeys_.resize(count);
+	scratchOrder_.resize(count);
+	for (size_t i = 0; i < count; ++i)
+	{
+		keys_[i] = ~sortableKey(depths[i]);
+		order[i] = static_cast<std::uint32_t>(i);
+	}
+
+	for (size_t shift = 0; shift < 32; shift += RadixBits)
+	{
+		std::array<size_t, RadixSize + 1> offsets{};
+		for (const auto key : keys_)
+		{
+			++offsets[((key >> shift) & (RadixSize - 1)) + 1];
+		}
+		if (std::find(offsets.begin(), offsets.end(), count) != offsets.end())
+		{
+			continue;
+		}
+		std::partial_sum(offsets.begin(), offsets.end(), offsets.begin());
+
+		for (size_t i = 0; i < count; ++i)
+		{
+			const auto target = offsets[(keys_[i] >> shift) & (RadixSize - 1)]++;
+			scratchKeys_[target] = keys_[i];
+			scratchOrder_[target] = order[i];
+		}
+		keys_.swap(scratchKeys_);
+		order.swap(scratchOrder_);
+	}
+
+	sortMs_ = static_cast<double>(clock_.nsecsElapsed() - start) / g_ns_per_ms;
+}
+
+void Transparency::composite(const GLuint opaque, const GLuint accumulation, const GLuint weights)
+{
+	state_->useProgram(composite_->programId());
+	state_->bindTexture(CompositeUnits[0], GL_TEXTURE_2D, opaque);
+	state_->bindTexture(CompositeUnits[1], GL_TEXTURE_2D, accumulation);
+	state_->bindTexture(CompositeUnits[2], GL_TEXTURE_2D, weights);
+	state_->bindVertexArray(vao_);
+
+	// every pixel is written once, the resolve replaces the backbuffer content
+	state_->disable(GL_DEPTH_TEST);
+	state_->disable(GL_BLEND);
+	state_->disable(GL_CULL_FACE);
+	glDrawArrays(GL_TRIANGLES, 0, 3);
+	state_->enable(GL_DEPTH_TEST);
+}
+
+const char * Transparency::modeName(const Mode mode) noexcept
+{
+	switch (mode)
+	{
+		case Mode::Sorted:
+			return "sorted";
+		case Mode::WeightedBlended:
+			return "oit";
+	}
+	return "";
+}
+
+std::optional<Transparency::Mode> Transparency::parseMode(const QString & name)
+{
+	for (const auto mode : {Mode::Sorted, Mode::WeightedBlended})
+	{
+		if (name == QLatin1String(modeName(mode)))
+		{
+			return mode;
+		}
+	}
+	return std::nullopt;
+}
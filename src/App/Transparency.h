@@ -0,0 +1,81 @@
+#pragma once
+
+#include <Base/GLResources.hpp>
+#include <Base/GLState.hpp>
+
+#include <QElapsedTimer>
+#include <QOpenGLExtraFunctions>
+#include <QOpenGLShaderProgram>
+#include <QString>
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <optional>
+#include <vector>
+
+// How primitives of glTF materials with alphaMode BLEND are composited over the opaque scene.
+// Sorted draws them after the opaque pass with regular alpha blending, back to front in the
+// order of a radix sort on view depth. WeightedBlended draws them unsorted in one pass into an
+// accumulation and a revealage target and resolves both over the opaque image (McGuire and
+// Bavoil, weighted blended order-independent transparency); no sort is needed, but layers at
+// similar depth blend approximately. Frames without visible transparent draws skip both.
+class Transparency final : protected QOpenGLExtraFunctions
+{
+public:
+	enum class Mode
+	{
+		Sorted,
+		WeightedBlended,
+	};
+
+	// Units the composite samples the opaque image, the accumulation and the weights from.
+	static constexpr std::array<GLuint, 3> CompositeUnits = {0, 2, 3};
+
+	// Digits of the radix sort, 4 passes over 32-bit keys.
+	static constexpr size_t RadixBits = 8;
+	static constexpr size_t RadixSize = size_t{1} << RadixBits;
+
+public:
+	Transparency() = default;
+	~Transparency();
+
+	Transparency(const Transparency &) = delete;
+	Transparency(Transparency &&) = delete;
+	Transparency & operator=(const Transparency &) = delete;
+	Transparency & operator=(Transparency &&) = delete;
+
+public:
+	void setMode(Mode mode) noexcept { mode_ = mode; }
+	[[nodiscard]] Mode mode() const noexcept { return mode_; }
+
+	// Both require a current context. Bindings go through state.
+	void create(fgl::GLState & state, fgl::GLResources & resources);
+	void destroy();
+
+	// Back-to-front order of draws given their distances along the view direction.
+	void sort(const std::vector<float> & depths, std::vector<std::uint32_t> & order);
+
+	// Resolves the weighted-blended targets over the opaque image into the bound framebuffer.
+	void composite(GLuint opaque, GLuint accumulation, GLuint weights);
+
+	// Duration of the last sort.
+	[[nodiscard]] double sortMs() const noexcept { return sortMs_; }
+
+	[[nodiscard]] static const char * modeName(Mode mode) noexcept;
+	[[nodiscard]] static std::optional<Mode> parseMode(const QString & name);
+
+private:
+	fgl::GLState * state_ = nullptr;
+	Mode mode_ = Mode::Sorted;
+
+	std::unique_ptr<QOpenGLShaderProgram> composite_;
+	GLuint vao_ = 0;// the fullscreen triangle has no attributes, core profile still wants a vertex array
+
+	std::vector<std::uint32_t> keys_;
+	std::vector<std::uint32_t> scratchKeys_;
+	std::vector<std::uint32_t> scratchOrder_;
+	QElapsedTimer clock_;
+	double sortMs_ = 0.0;
+};
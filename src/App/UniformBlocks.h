@@ -0,0 +1,70 @@
+#pragma once
+
+#include <QOpenGLFunctions>
+
+#include <glm/glm.hpp>
+
+// CPU mirrors of the std140 uniform blocks declared in Shaders/cube.vs and Shaders/cube.fs.
+// vec3 members are padded to vec4 and scalars are grouped at the end of a block.
+
+enum UniformBinding : GLuint
+{
+	CameraBinding = 0,
+	LightBinding = 1,
+	ObjectBinding = 2,
+	MaterialBinding = 3,
+};
+
+struct CameraBlock
+{
+	glm::mat4 view;
+	glm::mat4 projection;
+	glm::vec4 viewport;// width, height in pixels
+	glm::vec4 tessellation;// see Tessellation::parameters()
+};
+
+struct LightBlock
+{
+	glm::vec4 sunCoord;
+	glm::vec4 spotPosition;
+	glm::vec4 spotDirection;
+	GLfloat spotCosCutoff;// lights are switched by shader variant, not here
+	GLfloat padding_[3];
+};
+
+// Texel offsets point into the node transform buffer, 4 texels per matrix.
+// Morph targets: targets per vertex in the delta buffer and the ones blended, see MorphTargets.h.
+// The exponent is read by the superellipsoid morph shape only, see MorphShapes.h.
+struct ObjectBlock
+{
+	GLint worldTexel;
+	GLint normalTexel;
+	GLfloat morphingCoef;
+	GLint targetCount;
+	GLint activeTargets;
+	GLfloat morphExponent;
+	GLint padding_[2];
+	glm::ivec4 targetIndices[2];
+	glm::vec4 targetWeights[2];
+};
+
+// glTF metallic-roughness material, an array of these forms the Materials block.
+// Layers index the texture array bound for the slot, -1 when the material has no such texture.
+struct MaterialBlock
+{
+	glm::vec4 baseColorFactor;
+	glm::vec4 emissiveFactor;
+	GLfloat metallicFactor;
+	GLfloat roughnessFactor;
+	GLfloat normalScale;
+	GLfloat occlusionStrength;
+	GLfloat alphaCutoff;// negative unless the alpha mode is MASK
+	GLfloat padding_[3];
+	glm::ivec4 layers;       // base color, normal, metallic-roughness, occlusion
+	glm::ivec4 emissiveLayer;// x only
+};
+
+static_assert(sizeof(CameraBlock) == 160, "CameraBlock must match std140 layout");
+static_assert(sizeof(LightBlock) == 64, "LightBlock must match std140 layout");
+static_assert(sizeof(ObjectBlock) == 96, "ObjectBlock must match std140 layout");
+static_assert(sizeof(MaterialBlock) == 96, "MaterialBlock must match std140 array stride");
@@ -9,14 +9,118 @@
 
 #include <QCheckBox>
 #include <QSlider>
+#include <algorithm>
 #include <array>
+#include <cmath>
+#include <cstring>
+#include <limits>
+#include <map>
+#include <numeric>
+#include <optional>
+#include <utility>
+
+#include "CullBenchmark.h"
+#include "GltfAccessors.h"
+#include "SpherifyBenchmark.h"
+#include "SubdividedCube.h"
+#include "UniformBlocks.h"
+#include "Window.h"
 
-#define TINYGLTF_IMPLEMENTATION
-#define STB_IMAGE_IMPLEMENTATION
-#define STB_IMAGE_WRITE_IMPLEMENTATION
+#ifndef GL_PATCHES
+#define GL_PATCHES 0x000E
+#endif
 
-#include "Window.h"
+namespace
+{
+constexpr GLsizeiptr g_uniform_ring_segment_size = 64 * 1024;
+
+constexpr std::array<GLfloat, 4> g_background_color = {0.3f, 0.3f, 0.3f, 1.0f};
+
+// Frames between retimings of the slower cull path. --cull-benchmark found the linear SIMD
+// sweep ahead of the BVH even at 1M random boxes with 5% in view, so which one wins depends
+// on the scene and the view and is measured rather than fixed.
+constexpr size_t g_cull_probe_interval = 64;
+
+// Items per job when frame preparation is split across threads.
+constexpr size_t g_job_grain = 1024;
+
+// Integer vertex attribute without an array, carries the material index of a draw.
+constexpr GLuint g_material_attribute = 3;
+
+// Half angle of the spot light cone.
+constexpr float g_spot_cone_degrees = 20.0f;
+
+// Texture units of the material slots, unit 1 holds the node transforms.
+constexpr std::array<GLuint, MaterialTextureCount> g_material_texture_units = {0, 2, 3, 4, 5};
+
+// Integer vertex attribute without an array, carries the first morph target texel of a draw.
+constexpr GLuint g_target_base_attribute = 4;
+
+// Texture unit of the morph target deltas.
+constexpr GLuint g_morph_target_unit = 6;
+
+// Vertex attributes without an array, carry the first texel of a draw's baked morph and its range.
+constexpr GLuint g_bake_base_attribute = 7;
+constexpr GLuint g_bake_low_attribute = 8;
+constexpr GLuint g_bake_extent_attribute = 9;
+
+// Texture unit of the baked morph frames.
+constexpr GLuint g_morph_bake_unit = 7;
 
+// Local bounds of a primitive from the min/max of its POSITION accessor.
+// Spherify only pulls vertices of the unit cube inwards, so these stay conservative.
+Aabb primitiveBounds(const tinygltf::Model &model, const tinygltf::Primitive &primitive)
+{
+	const auto position = primitive.attributes.find("POSITION");
+	if (position != primitive.attributes.end()) {
+		const tinygltf::Accessor &accessor = model.accessors[position->second];
+		if (accessor.minValues.size() == 3 && accessor.maxValues.size() == 3) {
+			return Aabb{glm::vec3(glm::make_vec3(accessor.minValues.data())),
+						glm::vec3(glm::make_vec3(accessor.maxValues.data()))};
+		}
+	}
+
+	// no bounds in the file, never cull
+	constexpr auto unbounded = 1e30f;
+	return Aabb{glm::vec3(-unbounded), glm::vec3(unbounded)};
+}
+
+// Closest triangle of a list hit by the ray from either side (Moller-Trumbore), distances in
+// units of direction, infinity on a miss.
+float intersectTriangles(const VertexStreams &vertices, const std::vector<std::uint32_t> &indices,
+						 const glm::vec3 &origin, const glm::vec3 &direction)
+{
+	constexpr auto parallel = 1e-12f;
+	const auto vertex = [&](const std::uint32_t i) {
+		return glm::vec3(vertices.positionX[i], vertices.positionY[i], vertices.positionZ[i]);
+	};
+
+	auto closest = std::numeric_limits<float>::infinity();
+	for (size_t i = 0; i + 2 < indices.size(); i += 3) {
+		if (std::max({indices[i], indices[i + 1], indices[i + 2]}) >= vertices.size()) {
+			continue;
+		}
+		const auto a = vertex(indices[i]);
+		const auto ab = vertex(indices[i + 1]) - a;
+		const auto ac = vertex(indices[i + 2]) - a;
+		const auto p = glm::cross(direction, ac);
+		const auto determinant = glm::dot(ab, p);
+		if (std::abs(determinant) < parallel) {
+			continue;
+		}
+		const auto inverse = 1.0f / determinant;
+		const auto offset = origin - a;
+		const auto u = glm::dot(offset, p) * inverse;
+		const auto q = glm::cross(offset, ab);
+		const auto v = glm::dot(direction, q) * inverse;
+		const auto t = glm::dot(ac, q) * inverse;
+		if (u >= 0.0f && v >= 0.0f && u + v <= 1.0f && t >= 0.0f) {
+			closest = std::min(closest, t);
+		}
+	}
+	return closest;
+}
+}// namespace
 
 Window::Window() noexcept
 {
@@ -36,6 +140,10 @@ Window::Window() noexcept
 	auto morphing_label = new QLabel("Spherify 🔮");
 	morphing_label->setFont(QFont("Arial", 10));
 
+	auto morph_animation_checkbox = new QCheckBox();
+	morph_animation_checkbox->setChecked(false);
+	morph_animation_checkbox->setText("animate ⏯");
+
 	auto directional_light_checkbox = new QCheckBox();
 	directional_light_checkbox->setChecked(false);
 	directional_light_checkbox->setText("directional 🌞");
@@ -51,12 +159,94 @@ Window::Window() noexcept
 	auto fps = new QLabel(formatFPS(0), this);
 	fps->setStyleSheet("QLabel { color : white; }");
 
+	const auto formatCulled = [](const auto culled, const auto draws) {
+		return QString("Culled: %1 / %2").arg(QString::number(culled)).arg(QString::number(draws));
+	};
+
+	auto culled = new QLabel(formatCulled(0, 0), this);
+	culled->setStyleSheet("QLabel { color : white; }");
+
+	const auto formatNearest = [](const auto distance) {
+		return QString("Nearest: %1").arg(QString::number(distance, 'f', 2));
+	};
+
+	auto nearest = new QLabel(formatNearest(0.0), this);
+	nearest->setStyleSheet("QLabel { color : white; }");
+
+	const auto formatGLCalls = [](const auto issued, const auto elided) {
+		return QString("GL calls: %1 (%2 elided)").arg(QString::number(issued)).arg(QString::number(elided));
+	};
+
+	auto glCalls = new QLabel(formatGLCalls(0, 0), this);
+	glCalls->setStyleSheet("QLabel { color : white; }");
+
+	const auto formatPasses = [](const auto passes, const auto clears, const auto invalidations) {
+		return QString("Passes: %1, clears: %2, invalidations: %3")
+			.arg(QString::number(passes)).arg(QString::number(clears)).arg(QString::number(invalidations));
+	};
+
+	auto passes = new QLabel(formatPasses(0, 0, 0), this);
+	passes->setStyleSheet("QLabel { color : white; }");
+
+	const auto formatPacing = [](const auto frameMs, const auto jitterMs) {
+		return QString("Frame: %1 ms ± %2").arg(QString::number(frameMs, 'f', 2)).arg(QString::number(jitterMs, 'f', 2));
+	};
+
+	auto pacing = new QLabel(formatPacing(0.0, 0.0), this);
+	pacing->setStyleSheet("QLabel { color : white; }");
+
+	const auto formatStall = [](const auto stallMs, const auto framesInFlight) {
+		return QString("Stall: %1 ms, %2 in flight").arg(QString::number(stallMs, 'f', 2)).arg(QString::number(framesInFlight));
+	};
+
+	auto stall = new QLabel(formatStall(0.0, 0), this);
+	stall->setStyleSheet("QLabel { color : white; }");
+
+	const auto formatPrepass = [](const auto enabled, const auto overdraw) {
+		return QString("Depth pre-pass: %1, overdraw %2x").arg(enabled ? "on" : "off").arg(QString::number(overdraw, 'f', 2));
+	};
+
+	auto prepass = new QLabel(formatPrepass(false, 0.0), this);
+	prepass->setStyleSheet("QLabel { color : white; }");
+
+	const auto formatShaders = [](const auto variants, const auto switches) {
+		return QString("Shaders: %1 variants, %2 switches").arg(QString::number(variants)).arg(QString::number(switches));
+	};
+
+	auto shaders = new QLabel(formatShaders(0, 0), this);
+	shaders->setStyleSheet("QLabel { color : white; }");
+
+	const auto formatTransparency = [](const auto mode, const auto draws, const auto sortMs) {
+		return QString("Transparency: %1, %2 draws, sort %3 ms").arg(mode).arg(QString::number(draws)).arg(QString::number(sortMs, 'f', 3));
+	};
+
+	auto transparency = new QLabel(formatTransparency("sorted", 0, 0.0), this);
+	transparency->setStyleSheet("QLabel { color : white; }");
+
+	const auto formatMorphCache = [](const auto mode, const auto cached, const auto captures) {
+		return QString("Morph cache: %1%2, %3 captures").arg(mode).arg(cached ? " (cached)" : "").arg(QString::number(captures));
+	};
+
+	auto morphCache = new QLabel(formatMorphCache("on", false, 0), this);
+	morphCache->setStyleSheet("QLabel { color : white; }");
+
 	auto layout = new QVBoxLayout();
 	layout->addWidget(fps, 2);
+	layout->addWidget(culled, 1);
+	layout->addWidget(nearest, 1);
+	layout->addWidget(glCalls, 1);
+	layout->addWidget(passes, 1);
+	layout->addWidget(pacing, 1);
+	layout->addWidget(stall, 1);
+	layout->addWidget(shaders, 1);
+	layout->addWidget(prepass, 1);
+	layout->addWidget(transparency, 1);
+	layout->addWidget(morphCache, 1);
 	layout->addWidget(speed_slider, 3);
 	layout->addWidget(speed_label, 1);
 	layout->addWidget(morphing_slider, 3);
 	layout->addWidget(morphing_label, 1);
+	layout->addWidget(morph_animation_checkbox);
 	layout->addWidget(directional_light_checkbox);		// TODO: add other checkboxes + control spaces
 	layout->addWidget(spot_light_checkbox);
 
@@ -66,9 +256,20 @@ Window::Window() noexcept
 
 	connect(this, &Window::updateUI, [=] {
 		fps->setText(formatFPS(ui_.fps));
+		culled->setText(formatCulled(ui_.culled, ui_.draws));
+		nearest->setText(formatNearest(ui_.nearest));
+		glCalls->setText(formatGLCalls(ui_.glCalls, ui_.glCallsElided));
+		passes->setText(formatPasses(ui_.passes, ui_.clears, ui_.invalidations));
+		pacing->setText(formatPacing(ui_.frameMs, ui_.jitterMs));
+		stall->setText(formatStall(ui_.stallMs, ui_.framesInFlight));
+		shaders->setText(formatShaders(ui_.shaderVariants, ui_.shaderSwitches));
+		prepass->setText(formatPrepass(ui_.depthPrepass, ui_.overdraw));
+		morphCache->setText(formatMorphCache(MorphCache::modeName(morphCache_.mode()), morphCached_, ui_.morphCaptures));
+		transparency->setText(formatTransparency(Transparency::modeName(transparency_.mode()), ui_.transparentDraws, ui_.sortMs));
 	});
 	connect(speed_slider, &QSlider::valueChanged, this, &Window::change_camera_speed);
 	connect(morphing_slider, &QSlider::valueChanged, this, &Window::change_morphing_param);
+	connect(morph_animation_checkbox, &QCheckBox::stateChanged, this, &Window::change_morph_animation);
 	connect(directional_light_checkbox, &QCheckBox::stateChanged, this, &Window::change_directional_light);
 	connect(spot_light_checkbox, &QCheckBox::stateChanged, this, &Window::change_spot_light);
 }
@@ -78,53 +279,141 @@ Window::~Window()
 	{
 		// Free resources with context bounded.
 		const auto guard = bindContext();
-		texture_.reset();
-		program_.reset();
+		frameGraph_.destroy();
+		depthPrepass_.destroy();
+		transparency_.destroy();
+		morphCache_.destroy();
+		morphCompute_.destroy();
+		morphStream_.destroy();
+		morphBake_.destroy();
+		morphTargets_.destroy();
+		uniforms_.destroy();
+		glDeleteTextures(1, &transformTexture_);
+		transformRegions_.destroy();
+		glDeleteBuffers(1, &materialBuffer_);
+		for (auto & vaos : primitiveVaos_) {
+			glDeleteVertexArrays(static_cast<GLsizei>(vaos.size()), vaos.data());
+		}
+		textureAtlas_.destroy();
+		shaders_.destroy();
+	}
+
+	std::cout << "Shader variant usage (draws):" << std::endl;
+	for (const auto &[key, draws] : shaders_.histogram()) {
+		std::cout << "  " << shaders_.describe(key).toStdString() << ": " << draws << std::endl;
 	}
 }
 
 #include <filesystem>
 void Window::onInit()
 {
-	// Configure shaders
-	program_ = std::make_unique<QOpenGLShaderProgram>(this);
-	program_->addShaderFromSourceFile(QOpenGLShader::Vertex, ":/Shaders/cube.vs");
-	program_->addShaderFromSourceFile(QOpenGLShader::Fragment, ":/Shaders/cube.fs");
-	program_->link();
+	// Shader variants are compiled on first use, each gets its block bindings and sampler units
+	std::vector<QByteArray> defines(ShaderFeatureDefines.begin(), ShaderFeatureDefines.end());
+	shaders_.create(state(),
+					{{QOpenGLShader::Vertex, ":/Shaders/cube.vs"},
+					 {QOpenGLShader::Vertex, ":/Shaders/morph.glsl"},
+					 {QOpenGLShader::TessellationControl, ":/Shaders/cube.tcs", TessellationFeature},
+					 {QOpenGLShader::TessellationControl, ":/Shaders/morph.glsl", TessellationFeature},
+					 {QOpenGLShader::TessellationEvaluation, ":/Shaders/cube.tes", TessellationFeature},
+					 {QOpenGLShader::TessellationEvaluation, ":/Shaders/morph.glsl", TessellationFeature},
+					 {QOpenGLShader::Fragment, ":/Shaders/cube.fs"}},
+					std::move(defines),
+					[this](QOpenGLShaderProgram &program) {
+		// Attach uniform blocks to their binding points, a variant may not use all of them
+		const auto programId = program.programId();
+		const auto bindBlock = [&](const char *name, const UniformBinding binding) {
+			const auto index = glGetUniformBlockIndex(programId, name);
+			if (index != GL_INVALID_INDEX) {
+				glUniformBlockBinding(programId, index, binding);
+			}
+		};
+		bindBlock("Camera", CameraBinding);
+		bindBlock("Light", LightBinding);
+		bindBlock("Object", ObjectBinding);
+		bindBlock("Materials", MaterialBinding);
+
+		// Material images are array layers on their slot's unit, node transforms a texture buffer on unit 1;
+		// samplers a variant compiled out have no location and are skipped
+		program.setUniformValue("transforms", 1);
+		program.setUniformValue("morph_targets", static_cast<GLint>(g_morph_target_unit));
+		program.setUniformValue("morph_bake", static_cast<GLint>(g_morph_bake_unit));
+		program.setUniformValue("morph_bake_frames", static_cast<GLint>(morphBake_.frames()));
+		program.setUniformValue("base_color_map", static_cast<GLint>(g_material_texture_units[BaseColorTexture]));
+		program.setUniformValue("normal_map", static_cast<GLint>(g_material_texture_units[NormalTexture]));
+		program.setUniformValue("metallic_roughness_map", static_cast<GLint>(g_material_texture_units[MetallicRoughnessTexture]));
+		program.setUniformValue("occlusion_map", static_cast<GLint>(g_material_texture_units[OcclusionTexture]));
+		program.setUniformValue("emissive_map", static_cast<GLint>(g_material_texture_units[EmissiveTexture]));
+	});
 
 	// Create VAO object
 	vao_.create();
 	vao_.bind();
 
+	// Texture pages for the model images
+	textureAtlas_.create(state(), resources());
+
+	// Triangle patches when the context has tessellation
+	tessellation_.create(shaders_);
+
+	// Precomputed morphs of the primitives, added by bindModel()
+	morphStream_.create(resources());
+	morphBake_.create(resources());
+
+	// Compute morph on GL 4.3, replaces the capture below for the primitives it takes
+	morphCompute_.create(state(), resources());
+
+	// Transform feedback capture of the morph, primitives are added by bindModel()
+	morphCache_.create(state(), resources());
+
 	// ----------------------------------------------------------------
-	loadModel("Models/oxycube.glb");
+	if (cubeSubdivisions_ != 0) {
+		model = SubdividedCube::build(cubeSubdivisions_, jobs_);
+		std::cout << "Built subdivided cube: " << model.accessors[0].count << " vertices, "
+				  << model.accessors[model.meshes[0].primitives[0].indices].count << " indices" << std::endl;
+	} else {
+		loadModel("Models/oxycube.glb");
+	}
 	vbos = bindModel();
 	// ---------------------------------------------
 
-	texture_ = std::make_unique<QOpenGLTexture>(QImage(":/Textures/oxy.png"));
-	texture_->setMinMagFilters(QOpenGLTexture::Linear, QOpenGLTexture::Linear);
-	texture_->setWrapMode(QOpenGLTexture::WrapMode::Repeat);
+	vao_.release();
 
-	// Bind attributes
-	program_->bind();
+	// Streaming storage for the uniform blocks, grown on demand
+	uniforms_.create(state(), frames(), g_uniform_ring_segment_size);
 
+	// Render targets and framebuffers of the passes, created on first use
+	frameGraph_.create(state());
 
-	modelUniform_ = program_->uniformLocation("ModelMat");
-	viewUniform_ = program_-> uniformLocation("ViewMat");
-	projectionUniform_ = program_->uniformLocation("ProjMat");
-	sunCoord_ = program_->uniformLocation("sun_coord");
-	normalTrasform_ = program_->uniformLocation("normalMV");
-	isDirectionalLightUniform_ = program_->uniformLocation("directional");
-	isSpotLightUniform_ = program_->uniformLocation("spot");
-	morphingParam_ = program_->uniformLocation("morphing_coef");
-	spotPositionUniform_ = program_->uniformLocation("spot_position");
-	spotDirection_ = program_->uniformLocation("spot_direction");
-	// spotAngle_ = program_->uniformLocation("spot_angle");
+	// Sample queries of the depth pre-pass decision
+	depthPrepass_.create(frames());
 
-	// Release all
-	program_->release();
+	// Resolve program of weighted blended transparency
+	transparency_.create(state(), resources());
 
-	vao_.release();
+	// CPU morph kernel against the GPU, and its throughput
+	if (morphBenchmarkVertices_ != 0) {
+		const auto result = SpherifyBenchmark{}.run(state(), resources(), jobs_, morphBenchmarkVertices_);
+		std::cout << "Spherify kernel " << SpherifyKernel::kernelName() << ", " << result.vertices << " vertices: "
+				  << result.singleThreadRate / 1e6 << " M/s on one thread, "
+				  << result.multiThreadRate / 1e6 << " M/s on " << result.threads << std::endl;
+		if (result.validated) {
+			std::cout << "Morph shapes vs GPU: position error " << result.positionError << ", normal error "
+					  << result.normalError << (result.passed ? ", within " : ", OUTSIDE ") << SpherifyBenchmark::Tolerance << std::endl;
+		}
+		if (result.shaderMorphMs > 0.0 && result.streamMorphMs > 0.0) {
+			std::cout << "Sphere morph on the GPU: " << result.shaderMorphMs << " ms in the shader, "
+					  << result.streamMorphMs << " ms from the morph stream" << std::endl;
+		}
+	}
+
+	// Linear frustum sweep against the BVH on random boxes
+	if (cullBenchmarkBoxes_ != 0) {
+		const auto result = CullBenchmark::run(jobs_, cullBenchmarkBoxes_);
+		std::cout << "Cull " << result.boxes << " boxes, " << result.visible << " visible: "
+				  << result.linearMs << " ms linear (" << FrustumCuller::kernelName() << "), "
+				  << result.bvhMs << " ms BVH, best of " << CullBenchmark::Rounds << " on one thread; BVH built in "
+				  << result.buildMs << " ms" << (result.identical ? "" : ", RESULTS DIFFER") << std::endl;
+	}
 
 	// Еnable depth test and face culling
 	glEnable(GL_DEPTH_TEST);
@@ -133,6 +422,9 @@ void Window::onInit()
 	// Clear all FBO buffers
 	glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
 
+	// Loading used raw GL calls, forget whatever the state layer assumed
+	state().invalidate();
+
 	// Set initial parameters
 	cameraPos_ = glm::vec3(0, 2, 7);
 	cameraFront_ = glm::vec3(0, 0, -4);
@@ -150,65 +442,83 @@ void Window::onInit()
 	spotPosition = glm::vec3(0.0, 5.0, 3.0);
 
 	// morphing parameters
-	morphing_param = 100;
+	morphing_param = 100.0f;
 }
 
 void Window::onRender()
 {
 	const auto guard = captureMetrics();
 
-	// Clear buffers
-	glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+	// Per-frame state goes through the shadowing layer, redundant calls are dropped
+	auto &state = this->state();
+	state.enable(GL_DEPTH_TEST);
+	state.enable(GL_CULL_FACE);
 
-	// Bind VAO and shader program
-	program_->bind();
-	vao_.bind();
+	// Shader variants are selected per draw in drawModel()
 
-	// Update uniform value
-//	program_->setUniformValue(mvpUniform_, mvp);
-
-	// Activate texture unit and bind texture
-	glActiveTexture(GL_TEXTURE0);
-	texture_->bind();
+	// Bind transforms, texture pages are bound per draw when they change
+	state.bindTexture(1, GL_TEXTURE_BUFFER, transformTexture_);
+	if (morphTargets_.texture() != 0) {
+		state.bindTexture(g_morph_target_unit, GL_TEXTURE_BUFFER, morphTargets_.texture());
+	}
+	if (morphBake_.texture() != 0) {
+		state.bindTexture(g_morph_bake_unit, GL_TEXTURE_BUFFER, morphBake_.texture());
+	}
 
 	// Draw
 	display();
 
 	// Release VAO and shader program
-	texture_->release();
-	vao_.release();
-	program_->release();
+	state.bindVertexArray(0);
+	state.useProgram(0);
+
+	ui_.glCalls = state.currentFrame().issued;
+	ui_.glCallsElided = state.currentFrame().elided;
+	ui_.passes = frameGraph_.stats().passes - frameGraph_.stats().culledPasses;
+	ui_.clears = frameGraph_.stats().clears;
+	ui_.invalidations = frameGraph_.stats().invalidations;
+	ui_.shaderVariants = shaders_.stats().variants;
+	ui_.shaderSwitches = shaders_.stats().switches;
+	ui_.stallMs = frames().stalls().meanMs;
+	ui_.framesInFlight = frames().framesInFlight();
+	ui_.depthPrepass = depthPrepass_.enabled();
+	ui_.overdraw = depthPrepass_.overdraw();
+	ui_.transparentDraws = transparentCommands_.size();
+	ui_.morphCaptures = morphCache_.captures();
+
+	const auto & pacing = scheduler().pacing();
+	ui_.frameMs = pacing.meanMs;
+	ui_.jitterMs = pacing.jitterMs;
 
 	++frameCount_;
-
-	// Request redraw if animated
-	if (animated_)
-	{
-		update();
-	}
 }
 
 void Window::onResize([[maybe_unused]] const size_t width, [[maybe_unused]] const size_t height)
 {}
 
 void Window::change_morphing_param(int state) {
-	morphing_param = 100 - state;
-	update();
+	morphing_param = 100.0f - static_cast<float>(state);
+	requestFrame();
+}
+
+void Window::change_morph_animation(int state) {
+	morphAnimation_.setPlaying(state == Qt::Checked);
+	requestFrame();
 }
 
 void Window::change_camera_speed(int s) {
 	cameraSpeed_ = s / static_cast<float>(1000);
-	update();
+	requestFrame();
 }
 
 void Window::change_directional_light([[maybe_unused]] int state) {
 	is_directional = !is_directional;
-	update();
+	requestFrame();
 }
 
 void Window::change_spot_light([[maybe_unused]] int state) {
 	is_spot = !is_spot;
-	update();
+	requestFrame();
 }
 
 void Window::keyPressEvent(QKeyEvent * got_event) {
@@ -232,10 +542,15 @@ void Window::keyPressEvent(QKeyEvent * got_event) {
 		return;
 	}
 
-	update();
+	requestFrame();
 }
 
 void Window::mousePressEvent(QMouseEvent * got_event) {
+	if (got_event->button() == Qt::RightButton) {
+		pickAt(got_event->pos());
+		return;
+	}
+
 	mouseStartPos_ = got_event->pos();
 	dragged_ = true;
 }
@@ -253,7 +568,7 @@ void Window::mouseMoveEvent(QMouseEvent * got_event) {
 
 		mouseStartPos_ = got_event->pos();
 
-		update();
+		requestFrame();
 	}
 }
 
@@ -315,29 +630,10 @@ bool Window::loadModel(const char *filename) {
 	return res;
 }
 
-void Window::bindModelNodes(std::map<int, GLuint>& vbos,
-					tinygltf::Node &node) {
-	if ((node.mesh >= 0) && (static_cast<size_t>(node.mesh) < model.meshes.size())) {
-		bindMesh(vbos, model.meshes[node.mesh]);
-	}
-
-	for (size_t i = 0; i < node.children.size(); i++) {
-		bindModelNodes(vbos, model.nodes[node.children[i]]);
-	}
-}
-
 std::map<int, GLuint> Window::bindModel() {
 	std::map<int, GLuint> vbos;
 
-	const tinygltf::Scene &scene = model.scenes[model.defaultScene];
-	for (size_t i = 0; i < scene.nodes.size(); ++i) {
-		bindModelNodes(vbos, model.nodes[scene.nodes[i]]);
-	}
-
-	return vbos;
-}
-
-void Window::bindMesh(std::map<int, GLuint>& vbos, tinygltf::Mesh &mesh) {
+	// upload every buffer view once, primitives reference them through accessors
 	for (size_t i = 0; i < model.bufferViews.size(); ++i) {
 		const tinygltf::BufferView &bufferView = model.bufferViews[i];
 		if (bufferView.target == 0) {
@@ -345,27 +641,133 @@ void Window::bindMesh(std::map<int, GLuint>& vbos, tinygltf::Mesh &mesh) {
 		}
 
 		const tinygltf::Buffer &buffer = model.buffers[bufferView.buffer];
+		vbos[i] = resources().createBuffer(bufferView.target, static_cast<GLsizeiptr>(bufferView.byteLength),
+										   &buffer.data.at(0) + bufferView.byteOffset, false);
+	}
 
-		GLuint vbo;
-		glGenBuffers(1, &vbo);
-		vbos[i] = vbo;
-		glBindBuffer(bufferView.target, vbo);
-
-		glBufferData(bufferView.target, bufferView.byteLength,
-					 &buffer.data.at(0) + bufferView.byteOffset, GL_STATIC_DRAW);
+	primitiveVaos_.clear();
+	for (auto &mesh : model.meshes) {
+		primitiveVaos_.push_back(bindMesh(vbos, mesh));
+	}
+	morphCache_.build();
+	morphTargets_.load(model, resources());
+
+	loadMaterials();
+
+	// flatten the node hierarchy and remember which nodes draw a mesh
+	transforms_.build(model, model.defaultScene >= 0 ? model.defaultScene : 0);
+
+	meshNodes_.clear();
+	for (size_t i = 0; i < transforms_.size(); ++i) {
+		const tinygltf::Node &node = model.nodes[transforms_.gltfNode(i)];
+		if ((node.mesh >= 0) && (static_cast<size_t>(node.mesh) < model.meshes.size())) {
+			const auto &weights = node.weights.empty() ? model.meshes[node.mesh].weights : node.weights;
+
+			// the morph shape of a node may be overridden in its extras
+			auto shape = morphShape_;
+			auto exponent = morphExponent_;
+			if (node.extras.Has("morph_shape") && node.extras.Get("morph_shape").IsString()) {
+				const auto &name = node.extras.Get("morph_shape").Get<std::string>();
+				if (const auto parsed = MorphShapes::parseShape(QString::fromStdString(name))) {
+					shape = *parsed;
+				} else {
+					std::cout << "Unknown morph shape '" << name << "' of node " << transforms_.gltfNode(i) << std::endl;
+				}
+			}
+			if (node.extras.Has("morph_exponent") && node.extras.Get("morph_exponent").IsNumber()) {
+				exponent = static_cast<float>(node.extras.Get("morph_exponent").GetNumberAsDouble());
+			}
+			meshNodes_.push_back({i, node.mesh, MorphTargets::select(weights), shape, exponent});
+		}
+	}
 
-		// TODO: unbind buffer?
+	// one culled draw per primitive of every mesh node; the first node drawing a primitive
+	// decides the shape its morph stream is computed for
+	using StreamShape = std::pair<MorphShapes::Shape, float>;
+	std::map<std::pair<int, size_t>, std::optional<StreamShape>> streamShapes;
+	drawItems_.clear();
+	transparentItems_.clear();
+	for (size_t i = 0; i < meshNodes_.size(); ++i) {
+		const tinygltf::Mesh &mesh = model.meshes[meshNodes_[i].mesh];
+		for (size_t p = 0; p < mesh.primitives.size(); ++p) {
+			const tinygltf::Primitive &primitive = mesh.primitives[p];
+			const tinygltf::Accessor &indexAccessor = model.accessors[primitive.indices];
+			const auto material = materials_.index(primitive.material);
+			// targets are blended only while some weight is non-zero
+			const auto targetBase = meshNodes_[i].targets.count > 0 ? morphTargets_.baseTexel(meshNodes_[i].mesh, p) : -1;
+			const auto vao = primitiveVaos_[meshNodes_[i].mesh][p];
+			const StreamShape shape{meshNodes_[i].shape, meshNodes_[i].exponent};
+			const auto bake = morphBake_.add(model, primitive, vao, shape.first, shape.second, jobs_);
+			auto stream = streamShapes.find({meshNodes_[i].mesh, p});
+			if (stream == streamShapes.end()) {
+				const auto added = primitive.targets.empty() && !bake && morphStream_.add(model, primitive, vao, shape.first, shape.second, jobs_);
+				stream = streamShapes.emplace(std::make_pair(meshNodes_[i].mesh, p), added ? std::optional<StreamShape>(shape) : std::nullopt).first;
+			}
+			const auto streamed = stream->second == shape;
+			// nodes of the same shape share one compute morph state
+			const DrawCommand command{vao,
+									  morphCache_.cachedVertexArray(vao),
+									  morphCompute_.vertexArray(vao, shape.first, shape.second),
+									  vbos.at(indexAccessor.bufferView),
+									  static_cast<GLenum>(primitive.mode),
+									  static_cast<GLsizei>(indexAccessor.count),
+									  static_cast<GLenum>(indexAccessor.componentType),
+									  static_cast<GLintptr>(indexAccessor.byteOffset),
+									  i,
+									  static_cast<GLint>(material % MaterialLibrary::MaterialWindowSize),
+									  targetBase,
+									  bake.value_or(MorphBake::Bake{}),
+									  material / MaterialLibrary::MaterialWindowSize,
+									  materials_.material(material).textures,
+									  materials_.material(material).doubleSided,
+									  materials_.material(material).blend,
+									  materials_.material(material).features | (targetBase >= 0 ? MorphTargetsFeature : 0u)
+										  | MorphShapes::feature(meshNodes_[i].shape) | (streamed ? MorphStreamFeature : 0u)
+										  | (bake ? MorphBakedFeature : 0u)};
+			const auto bounds = MorphTargets::morphedBounds(model, primitive, meshNodes_[i].targets, primitiveBounds(model, primitive));
+			drawItems_.push_back({i, meshNodes_[i].mesh, static_cast<int>(p), bounds, command});
+			if (command.blend) {
+				transparentItems_.push_back(drawItems_.size() - 1);
+			}
+		}
+	}
+	culler_.resize(drawItems_.size());
+	morphBake_.upload();
+	if (morphCompute_.active()) {
+		std::cout << "MorphCompute: " << morphCompute_.states() << " morph states for " << drawItems_.size() << " draws" << std::endl;
 	}
 
+	// per region: world matrices of all nodes followed by their normal matrices
+	transformRegions_.create(state(), resources(), frames(), GL_TEXTURE_BUFFER,
+							 static_cast<GLsizeiptr>(2 * transforms_.size() * sizeof(glm::mat4)));
+	transformTexture_ = resources().createBufferTexture(GL_RGBA32F, transformRegions_.bufferId());
+
+	// every region is written by the first frame that uses it
+	const auto initial = transforms_.update();
+	pendingTransforms_.fill(initial);
+
+	// hierarchy over the initial world bounds, refitted when nodes move
+	worldBounds_.resize(drawItems_.size());
+	updateWorldBounds(initial);
+	bvh_.build(worldBounds_, jobs_);
+	cullMs_ = {};
+	nearestFrom_.reset();
+
+	return vbos;
+}
+
+std::vector<GLuint> Window::bindMesh(const std::map<int, GLuint>& vbos, tinygltf::Mesh &mesh) {
+	// every primitive gets its own vertex array with its attribute layout
+	std::vector<GLuint> vaos(mesh.primitives.size());
+
 	for (size_t i = 0; i < mesh.primitives.size(); ++i) {
 		tinygltf::Primitive primitive = mesh.primitives[i];
+		vaos[i] = resources().createVertexArray();
 
 		for (auto &attrib : primitive.attributes) {
 			tinygltf::Accessor accessor = model.accessors[attrib.second];
 			int byteStride =
 				accessor.ByteStride(model.bufferViews[accessor.bufferView]);
-			glBindBuffer(GL_ARRAY_BUFFER, vbos[accessor.bufferView]);
-			// TODO: unbind buffer?
 
 			int size = 1;
 			if (accessor.type != TINYGLTF_TYPE_SCALAR) {
@@ -380,53 +782,311 @@ void Window::bindMesh(std::map<int, GLuint>& vbos, tinygltf::Mesh &mesh) {
 //			if (attrib.first.compare("TANGENT") == 0) continue;
 			// --------------------------------------------------------
 			if (vaa > -1) {
-				glEnableVertexAttribArray(vaa);
-				// 1: номер параметра (номер регистра видеокарты)
-				// 2: сколько параметров поступит (у треуг., напр, 3)
-				// 3: какого типа будут эти параметры
-				// 4: нужно ли normalize применить ко входу (?)
-				// 5: где от текущей позиции будет в буффере след значение (значение сдвига)
-				// 6: сдвиг от начала буфера: где первое значение
-				glVertexAttribPointer(vaa, size, accessor.componentType,
-									  accessor.normalized ? GL_TRUE : GL_FALSE,
-									  byteStride, BUFFER_OFFSET(accessor.byteOffset));
+				// attribute index, component count and type, normalization, stride and offset in the buffer
+				resources().vertexAttribute(vaos[i], static_cast<GLuint>(vaa), vbos.at(accessor.bufferView), size,
+											static_cast<GLenum>(accessor.componentType), accessor.normalized,
+											byteStride, static_cast<GLintptr>(accessor.byteOffset));
 			} else
 				std::cout << "vaa missing: " << attrib.first << std::endl;
 		}
+
+		// the capture knows nothing of node weights, primitives with morph targets morph per draw
+		const auto position = primitive.attributes.find("POSITION");
+		if (position != primitive.attributes.end() && primitive.targets.empty()
+			&& !morphCompute_.addPrimitive(model, primitive, vaos[i])) {
+			morphCache_.addPrimitive(vaos[i], static_cast<GLsizei>(model.accessors[position->second].count));
+		}
 	}
-	// TODO: add texture binding
+
+	return vaos;
 }
 
-void Window::drawMesh(tinygltf::Mesh &mesh) {
-	for (size_t i = 0; i < mesh.primitives.size(); ++i) {
-		tinygltf::Primitive primitive = mesh.primitives[i];
-		tinygltf::Accessor indexAccessor = model.accessors[primitive.indices];
+// material blocks go to a static uniform buffer, padded to whole windows at the offset alignment
+void Window::loadMaterials() {
+	materials_.load(model, textureAtlas_, QImage(":/Textures/oxy.png"));
+
+	GLint alignment = 0;
+	glGetIntegerv(GL_UNIFORM_BUFFER_OFFSET_ALIGNMENT, &alignment);
+	const auto windowSize = static_cast<GLsizeiptr>(MaterialLibrary::MaterialWindowSize * sizeof(MaterialBlock));
+	materialWindowStride_ = (windowSize + alignment - 1) / alignment * alignment;
+
+	const auto windows = (materials_.size() + MaterialLibrary::MaterialWindowSize - 1) / MaterialLibrary::MaterialWindowSize;
+	std::vector<std::byte> data(windows * static_cast<size_t>(materialWindowStride_));
+	for (size_t i = 0; i < materials_.size(); ++i) {
+		const auto window = i / MaterialLibrary::MaterialWindowSize;
+		const auto slot = i % MaterialLibrary::MaterialWindowSize;
+		std::memcpy(data.data() + window * static_cast<size_t>(materialWindowStride_) + slot * sizeof(MaterialBlock),
+					&materials_.blocks()[i], sizeof(MaterialBlock));
+	}
+
+	materialBuffer_ = resources().createBuffer(GL_UNIFORM_BUFFER, static_cast<GLsizeiptr>(data.size()), data.data(), false);
+}
+
+// compact the visible opaque items into draw commands: count per chunk, prefix sum, then scatter
+void Window::buildDrawCommands() {
+	const auto chunkCount = (drawItems_.size() + g_job_grain - 1) / g_job_grain;
+	const auto chunkEnd = [this](const size_t chunk) {
+		return std::min((chunk + 1) * g_job_grain, drawItems_.size());
+	};
+
+	drawChunkOffsets_.assign(chunkCount + 1, 0);
+	jobs_.parallelFor(0, chunkCount, 1, [&](const size_t first, const size_t last) {
+		for (auto chunk = first; chunk < last; ++chunk) {
+			size_t count = 0;
+			for (auto i = chunk * g_job_grain; i < chunkEnd(chunk); ++i) {
+				count += visibleItems_[i] && !drawItems_[i].command.blend ? 1 : 0;
+			}
+			drawChunkOffsets_[chunk + 1] = count;
+		}
+	});
+	std::partial_sum(drawChunkOffsets_.begin(), drawChunkOffsets_.end(), drawChunkOffsets_.begin());
+
+	drawCommands_.resize(drawChunkOffsets_.back());
+	jobs_.parallelFor(0, chunkCount, 1, [&](const size_t first, const size_t last) {
+		for (auto chunk = first; chunk < last; ++chunk) {
+			auto out = drawChunkOffsets_[chunk];
+			for (auto i = chunk * g_job_grain; i < chunkEnd(chunk); ++i) {
+				if (visibleItems_[i] && !drawItems_[i].command.blend) {
+					drawCommands_[out++] = drawItems_[i].command;
+				}
+			}
+		}
+	});
+}
+
+// blended draws are few; when sorted, they are ordered back to front by the view depth of their bounds
+void Window::buildTransparentCommands() {
+	visibleTransparent_.clear();
+	transparentDepths_.clear();
+	for (const auto item : transparentItems_) {
+		if (visibleItems_[item]) {
+			visibleTransparent_.push_back(item);
+			transparentDepths_.push_back(-(view_ * glm::vec4(worldBounds_[item].center(), 1.0f)).z);
+		}
+	}
 
-		glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, vbos.at(indexAccessor.bufferView));
+	const auto sorted = transparency_.mode() == Transparency::Mode::Sorted;
+	if (sorted) {
+		transparency_.sort(transparentDepths_, transparentOrder_);
+	}
+	ui_.sortMs = sorted ? transparency_.sortMs() : 0.0;
 
-		glDrawElements(primitive.mode, indexAccessor.count,
-					   indexAccessor.componentType,
-					   BUFFER_OFFSET(indexAccessor.byteOffset));
+	transparentCommands_.resize(visibleTransparent_.size());
+	for (size_t i = 0; i < visibleTransparent_.size(); ++i) {
+		transparentCommands_[i] = drawItems_[visibleTransparent_[sorted ? transparentOrder_[i] : i]].command;
 	}
 }
 
-// recursively draw node and children nodes of model
-void Window::drawModelNodes(tinygltf::Node &node) {
-	if ((node.mesh >= 0) && (static_cast<size_t>(node.mesh) < model.meshes.size())) {
-		drawMesh(model.meshes[node.mesh]);
+// submit the draw commands, each mesh node with its own object block; material parameters
+// stay in one buffer, a draw only selects its index and the texture pages of its slots.
+// The depth-only variant keeps the morphs and, for masked materials, the base color alpha.
+// Draws read the compute morph when it ran this frame, else their morph stream or bake, else
+// the cache when it holds their primitive; the cache holds the sphere, so nodes morphing into
+// other shapes never read it. All other draws morph in the vertex shader with their shape
+// specialization. Tessellating
+// frames draw their triangle lists as patches, other primitive modes keep the vertex shader morph.
+void Window::drawModel(const std::vector<DrawCommand> &commands, const DrawPass pass) {
+	const auto depthOnly = pass == DrawPass::Depth;
+	const auto passFeatures = pass == DrawPass::Accumulation ? WeightedOitFeature : 0u;
+	auto boundNode = meshNodes_.size();
+	auto boundWindow = std::numeric_limits<size_t>::max();
+	auto boundKey = ~fgl::ShaderCache::Key{0};
+	GLuint program = 0;
+	size_t runLength = 0;
+	for (const auto &command : commands) {
+		// the smallest variant covering the frame's lights and morph and the material's textures
+		const auto masked = (command.features & AlphaMaskFeature) != 0;
+		const auto shape = command.features & MorphShapeFeatures;
+		const auto computed = morphComputed_ && command.computedVao != 0;
+		// streamed and baked draws morph from their precomputed vertices in still frames too,
+		// so their normals do not switch to the captured spherify blend when playback stops
+		const auto precomputed = (command.features & (MorphStreamFeature | MorphBakedFeature)) != 0;
+		const auto cached = !computed && !precomputed && morphCached_ && command.cachedVao != 0 && shape == 0;
+		const auto morph = computed || cached ? 0u : frameFeatures_ & MorphFeature;
+		const auto patches = (frameFeatures_ & TessellationFeature) != 0 && command.mode == GL_TRIANGLES;
+		const auto tessellation = patches ? TessellationFeature : 0u;
+		const auto baked = morph != 0 && !patches ? command.features & MorphBakedFeature : 0u;
+		const auto stream = morph != 0 && !patches && baked == 0 ? command.features & MorphStreamFeature : 0u;
+		const auto morphShape = morph != 0 && stream == 0 && baked == 0 ? shape : 0u;
+		const auto key = depthOnly
+			? DepthOnlyFeature | morph | morphShape | stream | baked | tessellation | (command.features & MorphTargetsFeature)
+				| (masked ? command.features & (AlphaMaskFeature | BaseColorMapFeature) : 0u)
+			: (frameFeatures_ & ~(MorphFeature | TessellationFeature)) | morph | morphShape | stream | baked | tessellation
+				| (command.features & ~(MorphShapeFeatures | MorphStreamFeature | MorphBakedFeature)) | passFeatures;
+		if (key != boundKey) {
+			if (runLength != 0) {
+				shaders_.recordUse(boundKey, runLength);
+			}
+			program = shaders_.program(key);
+			state().useProgram(program);
+			boundKey = key;
+			runLength = 0;
+		}
+		if (program == 0) {
+			continue;
+		}
+		++runLength;
+
+		if (command.meshNode != boundNode) {
+			uniforms_.bindRange(ObjectBinding, objectBlocks_[command.meshNode]);
+			boundNode = command.meshNode;
+		}
+		if (command.materialWindow != boundWindow) {
+			state().bindBufferRange(GL_UNIFORM_BUFFER, MaterialBinding, materialBuffer_,
+									static_cast<GLintptr>(command.materialWindow) * materialWindowStride_,
+									static_cast<GLsizeiptr>(MaterialLibrary::MaterialWindowSize * sizeof(MaterialBlock)));
+			boundWindow = command.materialWindow;
+		}
+
+		// slots without a texture are never sampled, whatever is bound there can stay
+		for (size_t slot = 0; slot < MaterialTextureCount; ++slot) {
+			if (command.textures[slot] != 0 && (!depthOnly || (masked && slot == BaseColorTexture))) {
+				state().bindTexture(g_material_texture_units[slot], GL_TEXTURE_2D_ARRAY, command.textures[slot]);
+			}
+		}
+		state().setEnabled(GL_CULL_FACE, !command.doubleSided);
+		state().vertexAttribI1i(g_material_attribute, command.material);
+		if (command.targetBase >= 0) {
+			state().vertexAttribI1i(g_target_base_attribute, command.targetBase);
+		}
+		if (baked != 0) {
+			state().vertexAttribI1i(g_bake_base_attribute, command.bake.base);
+			state().vertexAttrib4f(g_bake_low_attribute, command.bake.low);
+			state().vertexAttrib4f(g_bake_extent_attribute, command.bake.extent);
+		}
+		state().bindVertexArray(computed ? command.computedVao : cached ? command.cachedVao : command.vao);
+		state().bindBuffer(GL_ELEMENT_ARRAY_BUFFER, command.indexBuffer);
+		glDrawElements(patches ? GL_PATCHES : command.mode, command.count, command.type, BUFFER_OFFSET(command.offset));
+	}
+	if (runLength != 0) {
+		shaders_.recordUse(boundKey, runLength);
 	}
+}
+
+// refresh world bounds of the primitives whose node moved
+void Window::updateWorldBounds(const TransformHierarchy::Range range) {
+	if (range.empty()) {
+		return;
+	}
+
+	jobs_.parallelFor(0, drawItems_.size(), g_job_grain, [&](const size_t first, const size_t last) {
+		for (auto i = first; i < last; ++i) {
+			const auto transform = meshNodes_[drawItems_[i].meshNode].transform;
+			if (transform >= range.first && transform < range.last) {
+				worldBounds_[i] = transformAabb(drawItems_[i].bounds, transforms_.world(transform));
+				culler_.setBox(i, worldBounds_[i]);
+			}
+		}
+	});
+
+	if (!bvh_.empty()) {
+		bvh_.refit(worldBounds_);
+	}
+}
 
-	for (size_t i = 0; i < node.children.size(); i++) {
-		drawModelNodes(model.nodes[node.children[i]]);
+// the cull path that was faster when both were last timed; an untimed path is tried first,
+// and every g_cull_probe_interval frames the slower one runs again to catch a change
+bool Window::chooseBvhCull() {
+	if (bvh_.empty()) {
+		return false;
 	}
+	if (cullMs_[0] == 0.0 || cullMs_[1] == 0.0) {
+		return cullMs_[0] != 0.0;
+	}
+	const auto bvhFaster = cullMs_[1] < cullMs_[0];
+	return ++cullFrames_ % g_cull_probe_interval == 0 ? !bvhFaster : bvhFaster;
 }
 
-void Window::drawModel() {
+// cast a ray from the camera through a widget position and report the closest primitive
+void Window::pickAt(const QPoint &pos) {
+	const auto w = static_cast<float>(this->size().width());
+	const auto h = static_cast<float>(this->size().height());
+	const glm::vec4 ndc(2.0f * pos.x() / w - 1.0f, 1.0f - 2.0f * pos.y() / h, 1.0f, 1.0f);
+
+	auto target = glm::inverse(projection_ * view_) * ndc;
+	target /= target.w;
 
-	const tinygltf::Scene &scene = model.scenes[model.defaultScene];
-	for (size_t i = 0; i < scene.nodes.size(); ++i) {
-		drawModelNodes(model.nodes[scene.nodes[i]]);
+	// boxes only narrow the search, the hit is on the surface as drawn
+	const auto direction = glm::normalize(glm::vec3(target) - cameraPos_);
+	const auto hit = bvh_.raycast(cameraPos_, direction, [this, direction](const std::uint32_t primitive, const float entry) {
+		return pickDistance(drawItems_[primitive], cameraPos_, direction, entry);
+	});
+	if (hit.primitive < 0) {
+		std::cout << "Picked nothing" << std::endl;
+		return;
 	}
+
+	const auto &item = drawItems_[hit.primitive];
+	const auto &node = model.nodes[transforms_.gltfNode(meshNodes_[item.meshNode].transform)];
+	std::cout << "Picked node '" << node.name << "', mesh " << item.mesh
+			  << ", primitive " << item.primitive << " at distance " << hit.distance << std::endl;
+}
+
+// distance along the ray to the triangles of a primitive, morphed into its node's shape on the CPU
+// like cube.vs does on the GPU; primitives with morph targets or other modes keep their box entry
+float Window::pickDistance(const DrawItem &item, const glm::vec3 &origin, const glm::vec3 &direction, const float entry) {
+	const auto &primitive = model.meshes[item.mesh].primitives[item.primitive];
+	const auto position = primitive.attributes.find("POSITION");
+	if (position == primitive.attributes.end() || !primitive.targets.empty() || primitive.mode != TINYGLTF_MODE_TRIANGLES) {
+		return entry;
+	}
+
+	const auto positions = readVec3(model, model.accessors[position->second]);
+	std::vector<std::uint32_t> indices;
+	if (primitive.indices >= 0) {
+		indices = readIndices(model, model.accessors[primitive.indices]);
+	} else {
+		indices.resize(positions.size());
+		std::iota(indices.begin(), indices.end(), 0u);
+	}
+
+	VertexStreams vertices;
+	vertices.resize(positions.size());
+	for (size_t i = 0; i < positions.size(); ++i) {
+		vertices.positionX[i] = positions[i].x;
+		vertices.positionY[i] = positions[i].y;
+		vertices.positionZ[i] = positions[i].z;
+	}
+	if (morphing_param != 100.0f) {
+		// normals are morphed as well but not needed here
+		VertexStreams morphed;
+		morphed.resize(vertices.size());
+		const auto &meshNode = meshNodes_[item.meshNode];
+		MorphShapes::morph(jobs_, meshNode.shape, meshNode.exponent, vertices, morphed, morphing_param);
+		vertices = std::move(morphed);
+	}
+
+	// in object space the ray keeps its parameter, so distances stay in world units of direction
+	const auto toLocal = glm::inverse(transforms_.world(meshNodes_[item.meshNode].transform));
+	return intersectTriangles(vertices, indices, glm::vec3(toLocal * glm::vec4(origin, 1.0f)),
+							  glm::vec3(toLocal * glm::vec4(direction, 0.0f)));
+}
+
+// write world and normal matrices of the nodes that changed since this frame's region was last used
+void Window::uploadTransforms(const TransformHierarchy::Range range) {
+	if (!range.empty()) {
+		for (auto &pending : pendingTransforms_) {
+			pending = pending.empty() ? range
+				: TransformHierarchy::Range{std::min(pending.first, range.first), std::max(pending.last, range.last)};
+		}
+	}
+
+	auto &pending = pendingTransforms_[frames().slot()];
+	if (pending.empty()) {
+		return;
+	}
+
+	const auto first = static_cast<GLintptr>(pending.first * sizeof(glm::mat4));
+	const auto size = static_cast<GLsizeiptr>((pending.last - pending.first) * sizeof(glm::mat4));
+	const auto normalsOffset = static_cast<GLintptr>(transforms_.size() * sizeof(glm::mat4));
+
+	auto *region = transformRegions_.region();
+	std::memcpy(region + first, &transforms_.worlds()[pending.first], static_cast<size_t>(size));
+	std::memcpy(region + normalsOffset + first, &transforms_.normals()[pending.first], static_cast<size_t>(size));
+	transformRegions_.flush(first, size);
+	transformRegions_.flush(normalsOffset + first, size);
+
+	pending = {};
 }
 
 void Window::display() {
@@ -434,9 +1094,6 @@ void Window::display() {
 	view_ = glm::mat4(1.0f);
 	projection_ = glm::mat4(1.0f);
 
-	glClearColor(0.3, 0.3, 0.3, 1.0);		// background color
-	glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
-
 	// calculate model, view, projection separately
 	glm::mat4 rot = glm::rotate(glm::mat4(1.0f), glm::radians(45.0f), glm::vec3(0, 1, 0));
 	model_ = rot * model_;
@@ -452,22 +1109,177 @@ void Window::display() {
 	w = this->size().width();
 	projection_ = glm::perspective(glm::radians(45.0f), (float)w / (float)h, 0.01f, 100.0f);
 
+	// model_ is applied on top of the scene roots; only changed subtrees are recomputed
+	transforms_.setRootTransform(model_);
+	const auto changed = transforms_.update(jobs_);
+	uploadTransforms(changed);
+	updateWorldBounds(changed);
+
+	// test primitive bounds against the view frustum
+	const auto frustum = Frustum::fromMatrix(projection_ * view_);
+	const auto useBvh = chooseBvhCull();
+	QElapsedTimer cullClock;
+	cullClock.start();
+	const auto visibleCount = useBvh ? bvh_.cull(frustum, visibleItems_, jobs_) : culler_.cull(frustum, visibleItems_);
+	cullMs_[useBvh ? 1 : 0] = static_cast<double>(cullClock.nsecsElapsed()) / 1e6;
+	ui_.draws = drawItems_.size();
+	ui_.culled = drawItems_.size() - visibleCount;
+	// the nearest box only moves with the camera or the bounds
+	if (!changed.empty() || nearestFrom_ != cameraPos_) {
+		ui_.nearest = bvh_.nearest(cameraPos_).distance;
+		nearestFrom_ = cameraPos_;
+	}
+	buildDrawCommands();
+	buildTransparentCommands();
+
 	// calculate uniforms
-	const auto normal_mv = glm::transpose(glm::inverse(view_ * model_));
 	auto spot_direction = glm::vec3(0, 1, -2) - spotPosition;
 
-	// set uniforms
-	program_->setUniformValue(modelUniform_, QMatrix4x4(glm::value_ptr(model_)).transposed());
-	program_->setUniformValue(viewUniform_, QMatrix4x4(glm::value_ptr(view_)).transposed());
-	program_->setUniformValue(projectionUniform_, QMatrix4x4(glm::value_ptr(projection_)).transposed());
-	program_->setUniformValue(normalTrasform_, QMatrix4x4(glm::value_ptr(normal_mv)).transposed());
-	program_->setUniformValue(sunCoord_, QVector3D(3.0, 5.0, 1.0));
-	program_->setUniformValue(isDirectionalLightUniform_, is_directional);
-	program_->setUniformValue(isSpotLightUniform_, is_spot);
-	program_->setUniformValue(morphingParam_, morphing_param);
-	program_->setUniformValue(spotPositionUniform_, QVector3D(spotPosition.x, spotPosition.y, spotPosition.z));
-	program_->setUniformValue(spotDirection_, QVector3D(spot_direction.x, spot_direction.y, spot_direction.z));
-	// program_->setUniformValue(spotAngle_, 20.0);
-
-	drawModel();
+	// write uniform blocks into this frame's segment of the ring
+	uniforms_.beginFrame(uniforms_.alignedSize(sizeof(CameraBlock))
+						 + uniforms_.alignedSize(sizeof(LightBlock))
+						 + static_cast<GLsizeiptr>(meshNodes_.size()) * uniforms_.alignedSize(sizeof(ObjectBlock)));
+
+	const auto pixels = glm::vec2(w, h) * static_cast<float>(devicePixelRatio());
+	const auto camera = uniforms_.push(CameraBlock{view_, projection_, glm::vec4(pixels, 0.0f, 0.0f), Tessellation::parameters()});
+	const auto light = uniforms_.push(LightBlock{
+		glm::vec4(3.0, 5.0, 1.0, 0.0),
+		glm::vec4(spotPosition, 1.0),
+		glm::vec4(spot_direction, 0.0),
+		std::cos(glm::radians(g_spot_cone_degrees)),
+		{}});
+
+	// the animation runs its fixed steps due by now and keeps on-demand frames coming
+	if (morphAnimation_.playing()) {
+		morphing_param = morphAnimation_.advance();
+		requestFrame();
+	}
+
+	// while the coefficient stays, draws read the vertices captured at its last change;
+	// an animated coefficient changes every frame, so it morphs in the vertex shader, and
+	// tessellation morphs the vertices it generates instead. The compute morph runs on
+	// every change, animated or not, once per unique morph state. Each draw reads whichever
+	// of the two holds its primitive, see drawModel().
+	const auto morphed = morphing_param != 100.0f;
+	const auto tessellated = morphed && tessellation_.active();
+	morphComputed_ = morphed && !tessellated && morphCompute_.update(morphing_param);
+	morphCached_ = morphed && !morphAnimation_.playing() && !tessellated && morphCache_.update(morphing_param);
+
+	// disabled lights and an unmorphed cube are compiled out instead of branched over,
+	// draws reading morphed vertices drop the morph again
+	frameFeatures_ = (is_directional ? DirectionalLightFeature : 0u)
+		| (is_spot ? SpotLightFeature : 0u)
+		| (morphed ? MorphFeature : 0u)
+		| (tessellated ? TessellationFeature : 0u);
+
+	// object blocks are written in place from all threads, one aligned slot per mesh node
+	const auto objectStride = uniforms_.alignedSize(sizeof(ObjectBlock));
+	const auto objects = uniforms_.allocate(static_cast<GLsizeiptr>(meshNodes_.size()) * objectStride);
+	const auto regionTexelBase = static_cast<GLint>(transformRegions_.regionOffset() / static_cast<GLintptr>(sizeof(glm::vec4)));
+	const auto normalTexelBase = static_cast<GLint>(4 * transforms_.size());
+	objectBlocks_.resize(meshNodes_.size());
+	jobs_.parallelFor(0, meshNodes_.size(), g_job_grain, [&](const size_t first, const size_t last) {
+		for (auto i = first; i < last; ++i) {
+			const auto worldTexel = regionTexelBase + static_cast<GLint>(4 * meshNodes_[i].transform);
+			const auto &targets = meshNodes_[i].targets;
+			const auto &mesh = model.meshes[meshNodes_[i].mesh];
+			const auto targetCount = mesh.primitives.empty() ? 0 : static_cast<GLint>(mesh.primitives.front().targets.size());
+			const ObjectBlock block{worldTexel, normalTexelBase + worldTexel, morphing_param, targetCount, targets.count,
+									meshNodes_[i].exponent, {},
+									{glm::make_vec4(&targets.indices[0]), glm::make_vec4(&targets.indices[4])},
+									{glm::make_vec4(&targets.weights[0]), glm::make_vec4(&targets.weights[4])}};
+			const auto offset = static_cast<GLsizeiptr>(i) * objectStride;
+			auto *data = static_cast<std::byte *>(objects.data) + offset;
+			std::memcpy(data, &block, sizeof(block));
+			objectBlocks_[i] = {data, objects.offset + offset, sizeof(ObjectBlock)};
+		}
+	});
+	uniforms_.flush();
+
+	uniforms_.bindRange(CameraBinding, camera);
+	uniforms_.bindRange(LightBinding, light);
+
+	// targets are cleared once by the pass that writes them first; depth is not needed
+	// after the frame, so it is invalidated instead of being written back
+	using LoadOp = fgl::FrameGraph::LoadOp;
+	using StoreOp = fgl::FrameGraph::StoreOp;
+	const auto ratio = devicePixelRatio();
+	const auto width = static_cast<GLsizei>(w * ratio);
+	const auto height = static_cast<GLsizei>(h * ratio);
+	frameGraph_.beginFrame(defaultFramebufferObject(), width, height);
+
+	// weighted blended transparency tests against the opaque depth in its own framebuffer,
+	// so those frames render the opaque scene offscreen and resolve into the backbuffer
+	const auto transparent = !transparentCommands_.empty();
+	const auto weighted = transparent && transparency_.mode() == Transparency::Mode::WeightedBlended;
+	const auto sceneColor = weighted ? frameGraph_.createTexture("scene color", {width, height, GL_RGBA8})
+									 : frameGraph_.backbufferColor();
+	const auto sceneDepth = weighted ? frameGraph_.createTexture("scene depth", {width, height, GL_DEPTH24_STENCIL8})
+									 : frameGraph_.backbufferDepth();
+
+	// with the pre-pass depth is final before shading, which then runs once per covered sample
+	const auto prepass = depthPrepass_.beginFrame();
+	if (prepass) {
+		frameGraph_.addPass("depth prepass", [this] {
+			state().colorMask(false);
+			depthPrepass_.beginQuery(DepthPrepass::DepthQuery);
+			drawModel(drawCommands_, DrawPass::Depth);
+			depthPrepass_.endQuery(DepthPrepass::DepthQuery);
+			state().colorMask(true);
+		})
+			.depth(sceneDepth, LoadOp::Clear, StoreOp::Store);
+	}
+	frameGraph_.addPass("scene", [this, prepass] {
+		if (prepass) {
+			state().depthFunc(GL_EQUAL);
+			state().depthMask(false);
+		}
+		depthPrepass_.beginQuery(DepthPrepass::ShadingQuery);
+		drawModel(drawCommands_, DrawPass::Shading);
+		depthPrepass_.endQuery(DepthPrepass::ShadingQuery);
+		state().depthFunc(GL_LESS);
+		state().depthMask(true);
+	})
+		.color(sceneColor, LoadOp::Clear, StoreOp::Store, g_background_color)
+		.depth(sceneDepth, prepass ? LoadOp::Load : LoadOp::Clear, transparent ? StoreOp::Store : StoreOp::Discard);
+
+	// blended draws test against the opaque depth but leave it as it is
+	if (transparent && !weighted) {
+		frameGraph_.addPass("transparent", [this] {
+			state().depthMask(false);
+			state().enable(GL_BLEND);
+			state().blendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+			drawModel(transparentCommands_, DrawPass::Shading);
+			state().disable(GL_BLEND);
+			state().depthMask(true);
+		})
+			.color(sceneColor, LoadOp::Load, StoreOp::Store)
+			.depth(sceneDepth, LoadOp::Load, StoreOp::Discard);
+	}
+	if (weighted) {
+		const auto accumulation = frameGraph_.createTexture("transparent accumulation", {width, height, GL_RGBA16F});
+		const auto weights = frameGraph_.createTexture("transparent weights", {width, height, GL_R16F});
+		frameGraph_.addPass("transparent accumulation", [this] {
+			state().depthMask(false);
+			state().enable(GL_BLEND);
+			// color and weight add up, alpha multiplies into the revealage
+			state().blendFuncSeparate(GL_ONE, GL_ONE, GL_ZERO, GL_ONE_MINUS_SRC_ALPHA);
+			drawModel(transparentCommands_, DrawPass::Accumulation);
+			state().disable(GL_BLEND);
+			state().depthMask(true);
+		})
+			.color(accumulation, LoadOp::Clear, StoreOp::Store, {0.0f, 0.0f, 0.0f, 1.0f})
+			.color(weights, LoadOp::Clear, StoreOp::Store)
+			.depth(sceneDepth, LoadOp::Load, StoreOp::Discard);
+		frameGraph_.addPass("transparent composite", [this, sceneColor, accumulation, weights] {
+			transparency_.composite(frameGraph_.texture(sceneColor), frameGraph_.texture(accumulation), frameGraph_.texture(weights));
+		})
+			.read(sceneColor)
+			.read(accumulation)
+			.read(weights)
+			.color(frameGraph_.backbufferColor(), LoadOp::DontCare, StoreOp::Store);
+	}
+	frameGraph_.execute();
+
+	uniforms_.endFrame();
 }
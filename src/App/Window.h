@@ -1,16 +1,38 @@
 #pragma once
 
+#include <Base/FrameGraph.hpp>
+#include <Base/FrameRegionBuffer.hpp>
 #include <Base/GLWidget.hpp>
+#include <Base/ShaderCache.hpp>
+#include <Base/TextureArrayAtlas.hpp>
+#include <Base/UniformRing.hpp>
+
+#include "Bvh.h"
+#include "DepthPrepass.h"
+#include "FrustumCuller.h"
+#include "JobSystem.h"
+#include "Materials.h"
+#include "MorphAnimation.h"
+#include "MorphBake.h"
+#include "MorphCache.h"
+#include "MorphCompute.h"
+#include "MorphShapes.h"
+#include "MorphStream.h"
+#include "MorphTargets.h"
+#include "Tessellation.h"
+#include "TransformHierarchy.h"
+#include "Transparency.h"
 
 #include <QElapsedTimer>
 #include <QMatrix4x4>
 #include <QOpenGLBuffer>
 #include <QOpenGLShaderProgram>
-#include <QOpenGLTexture>
 #include <QOpenGLVertexArrayObject>
 
+#include <array>
 #include <functional>
 #include <memory>
+#include <optional>
 // ------------------------------
 #include <iostream>
 #include <glm/glm.hpp>
@@ -28,6 +50,31 @@ public:
 	Window() noexcept;
 	~Window() override;
 
+	[[nodiscard]] DepthPrepass & depthPrepass() noexcept { return depthPrepass_; }
+	[[nodiscard]] Transparency & transparency() noexcept { return transparency_; }
+	[[nodiscard]] MorphCache & morphCache() noexcept { return morphCache_; }
+	[[nodiscard]] MorphAnimation & morphAnimation() noexcept { return morphAnimation_; }
+	[[nodiscard]] Tessellation & tessellation() noexcept { return tessellation_; }
+	[[nodiscard]] MorphStream & morphStream() noexcept { return morphStream_; }
+	[[nodiscard]] MorphCompute & morphCompute() noexcept { return morphCompute_; }
+	[[nodiscard]] MorphBake & morphBake() noexcept { return morphBake_; }
+
+	// Shape the cube morphs into for nodes without "morph_shape" / "morph_exponent" in their glTF extras.
+	void setMorphShape(MorphShapes::Shape shape, float exponent) noexcept
+	{
+		morphShape_ = shape;
+		morphExponent_ = exponent;
+	}
+
+	// Checks the CPU morph against the GPU and measures it on this many vertices at start-up, 0 skips it.
+	void setMorphBenchmark(size_t vertices) noexcept { morphBenchmarkVertices_ = vertices; }
+
+	// Times the linear frustum cull against the BVH on this many random boxes at start-up, 0 skips it.
+	void setCullBenchmark(size_t boxes) noexcept { cullBenchmarkBoxes_ = boxes; }
+
+	// Draws a SubdividedCube with this many quads per face edge instead of the glTF file, 0 loads the file.
+	void setSubdividedCube(size_t subdivisions) noexcept { cubeSubdivisions_ = subdivisions; }
+
 public: // fgl::GLWidget
 	void onInit() override;
 	void onRender() override;
@@ -61,18 +108,11 @@ signals:
 	void updateUI();
 
 private:
-	// uniforms
-	GLint modelUniform_ = -1;
-	GLint viewUniform_ = -1;
-	GLint projectionUniform_ = -1;
-	GLint sunCoord_ = -1;
-	GLint normalTrasform_ = -1;
-	GLint isDirectionalLightUniform_ = -1;
-	GLint isSpotLightUniform_ = -1;
-	GLint morphingParam_ = -1;
-	GLint spotPositionUniform_ = -1;
-	GLint spotDirection_ = -1;
-	//GLint spotAngle_ = -1;
+	// uniform blocks, see UniformBlocks.h
+	fgl::UniformRing uniforms_;
+
+	// passes of the frame and their render targets
+	fgl::FrameGraph frameGraph_;
 
 	// buffers
 	QOpenGLBuffer vbo_{QOpenGLBuffer::Type::VertexBuffer};
@@ -84,18 +124,62 @@ private:
 	glm::mat4 view_;
 	glm::mat4 projection_;
 
-	std::unique_ptr<QOpenGLTexture> texture_;
-	std::unique_ptr<QOpenGLShaderProgram> program_;
+	// cube shader variants by feature bits, see ShaderFeatures.h
+	fgl::ShaderCache shaders_;
+	fgl::ShaderCache::Key frameFeatures_ = 0;
+
+	// glTF morph target deltas, see MorphTargets.h
+	MorphTargets morphTargets_;
+
+	// morphed vertices captured while the coefficient stays, see MorphCache.h
+	MorphCache morphCache_;
+	bool morphCached_ = false;// the cached vertex arrays hold this frame's sphere morph
+
+	// morph of every unique state once per coefficient change on GL 4.3, see MorphCompute.h
+	MorphCompute morphCompute_;
+	bool morphComputed_ = false;// the computed vertex arrays hold this frame's morph
+
+	// fully morphed vertices computed at load time, see MorphStream.h
+	MorphStream morphStream_;
+
+	// morph frames baked at load time and played back from textures, see MorphBake.h
+	MorphBake morphBake_;
+
+	// morph per generated vertex on GL 4.0, see Tessellation.h
+	Tessellation tessellation_;
+
+	// optional depth-only pass ahead of shading, see DepthPrepass.h
+	DepthPrepass depthPrepass_;
+
+	// sorted or weighted blended compositing of BLEND materials, see Transparency.h
+	Transparency transparency_;
 
 	QElapsedTimer timer_;
 	size_t frameCount_ = 0;
 
 	struct {
 		size_t fps = 0;
+		size_t draws = 0;
+		size_t culled = 0;
+		float nearest = 0.0f;
+		size_t glCalls = 0;
+		size_t glCallsElided = 0;
+		size_t passes = 0;
+		size_t clears = 0;
+		size_t invalidations = 0;
+		double frameMs = 0.0;
+		double jitterMs = 0.0;
+		size_t shaderVariants = 0;
+		size_t shaderSwitches = 0;
+		double stallMs = 0.0;
+		size_t framesInFlight = 0;
+		bool depthPrepass = false;
+		double overdraw = 0.0;
+		size_t morphCaptures = 0;
+		size_t transparentDraws = 0;
+		double sortMs = 0.0;
 	} ui_;
 
-	bool animated_ = false;
-
 	// mouse control params
 	bool dragged_ = false;
 	QPoint mouseStartPos_;
@@ -103,6 +187,7 @@ private:
 	// widget reacting
 	void change_camera_speed(int s);
 	void change_morphing_param(int state);
+	void change_morph_animation(int state);
 	void change_directional_light(int state);
 	void change_spot_light(int state);
 
@@ -121,8 +206,11 @@ private:
 	bool is_spot;
 	glm::vec3 spotPosition;
 
-	// morphing params
-	int morphing_param;
+	// morphing params, the coefficient follows the animation while it plays
+	float morphing_param;
+	MorphAnimation morphAnimation_;
+	MorphShapes::Shape morphShape_ = MorphShapes::Shape::Sphere;
+	float morphExponent_ = MorphShapes::DefaultExponent;
 
 	// model managing
 	tinygltf::Model model;
@@ -130,14 +218,109 @@ private:
 	std::string err;
 	std::string warn;
 	std::map<int, GLuint> vbos;
+	std::vector<std::vector<GLuint>> primitiveVaos_;
+
+	// images of the model in texture array pages, materials in one static uniform buffer
+	fgl::TextureArrayAtlas textureAtlas_;
+	MaterialLibrary materials_;
+	GLuint materialBuffer_ = 0;
+	GLsizeiptr materialWindowStride_ = 0;
+
+	// node transforms in one texture buffer region per frame in flight,
+	// each region catches up on the nodes that changed since its last frame
+	struct MeshNode {
+		size_t transform;
+		int mesh;
+		MorphTargets::Active targets;// node weights, or the mesh's when the node has none
+		MorphShapes::Shape shape;
+		float exponent;// of a superellipsoid shape
+	};
+	TransformHierarchy transforms_;
+	std::vector<MeshNode> meshNodes_;
+	std::vector<fgl::UniformRing::Allocation> objectBlocks_;
+	fgl::FrameRegionBuffer transformRegions_;
+	std::array<TransformHierarchy::Range, fgl::FramePipeline::MaxFramesInFlight> pendingTransforms_{};
+	GLuint transformTexture_ = 0;
+
+	// GL parameters of a draw, resolved once at load time
+	struct DrawCommand {
+		GLuint vao;
+		GLuint cachedVao;// reads the morph cache, 0 when the cache does not hold the primitive
+		GLuint computedVao;// reads the compute morph of the node's shape, 0 without one
+		GLuint indexBuffer;
+		GLenum mode;
+		GLsizei count;
+		GLenum type;
+		GLintptr offset;
+		size_t meshNode;
+		GLint material;// index within the material window
+		GLint targetBase;// first morph target texel, -1 without targets
+		MorphBake::Bake bake;// texels of the baked morph, used with MorphBakedFeature
+		size_t materialWindow;
+		std::array<GLuint, MaterialTextureCount> textures;
+		bool doubleSided;
+		bool blend;// drawn after the opaque draws
+		fgl::ShaderCache::Key features;// of the material, frame features are added at draw time
+	};
+
+	// per-primitive draws, frustum culled against their world bounds
+	struct DrawItem {
+		size_t meshNode;
+		int mesh;
+		int primitive;
+		Aabb bounds;
+		DrawCommand command;
+	};
+	std::vector<DrawItem> drawItems_;
+	FrustumCuller culler_;
+	std::vector<std::uint8_t> visibleItems_;
+
+	// visible opaque draws of the frame in hierarchy order, generated in parallel chunks
+	std::vector<DrawCommand> drawCommands_;
+	std::vector<size_t> drawChunkOffsets_;
+
+	// items with blended materials and this frame's visible ones, back to front when sorted
+	std::vector<size_t> transparentItems_;
+	std::vector<size_t> visibleTransparent_;
+	std::vector<float> transparentDepths_;
+	std::vector<std::uint32_t> transparentOrder_;
+	std::vector<DrawCommand> transparentCommands_;
+
+	// frame preparation runs on all cores, GL calls stay on this thread
+	JobSystem jobs_;
+
+	size_t morphBenchmarkVertices_ = 0;
+	size_t cullBenchmarkBoxes_ = 0;
+	size_t cubeSubdivisions_ = 0;
+
+	// spatial queries over the same world bounds
+	std::vector<Aabb> worldBounds_;
+	Bvh bvh_;
+	// last time of the linear and the BVH cull, 0 until measured on this scene
+	std::array<double, 2> cullMs_{};
+	size_t cullFrames_ = 0;
+	// camera position of the overlay's nearest distance, empty until queried on this scene
+	std::optional<glm::vec3> nearestFrom_;
+
+	// shader variant a list of draws is submitted with
+	enum class DrawPass {
+		Depth,
+		Shading,
+		Accumulation,// weighted blended transparency
+	};
 
 	void display();
-	void drawModel();
-	void drawModelNodes(tinygltf::Node &node);
-	void drawMesh(tinygltf::Mesh &mesh);
-	void bindMesh(std::map<int, GLuint>& vbos, tinygltf::Mesh &mesh);
+	void drawModel(const std::vector<DrawCommand> &commands, DrawPass pass);
+	void buildDrawCommands();
+	void buildTransparentCommands();
+	void updateWorldBounds(TransformHierarchy::Range range);
+	bool chooseBvhCull();
+	void pickAt(const QPoint &pos);
+	float pickDistance(const DrawItem &item, const glm::vec3 &origin, const glm::vec3 &direction, float entry);
+	std::vector<GLuint> bindMesh(const std::map<int, GLuint>& vbos, tinygltf::Mesh &mesh);
 	std::map<int, GLuint> bindModel();
-	void bindModelNodes(std::map<int, GLuint>& vbos, tinygltf::Node &node);
+	void loadMaterials();
+	void uploadTransforms(TransformHierarchy::Range range);
 	bool loadModel(const char *filename);
 	void calculate_camera_front();
 };
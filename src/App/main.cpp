@@ -1,6 +1,11 @@
 #include <QApplication>
+#include <QCommandLineParser>
 #include <QSurfaceFormat>
 
+#include <iostream>
+#include <optional>
+#include <vector>
+
 #include "Window.h"
 
 namespace
@@ -8,6 +13,14 @@ namespace
 constexpr auto g_sampels = 16;
 constexpr auto g_gl_major_version = 3;
 constexpr auto g_gl_minor_version = 3;
+// Tessellation shaders are core from this version on.
+constexpr auto g_tessellation_gl_major_version = 4;
+constexpr auto g_tessellation_gl_minor_version = 0;
+// Compute shaders and shader storage buffers are core from this version on.
+constexpr auto g_compute_gl_major_version = 4;
+constexpr auto g_compute_gl_minor_version = 3;
+constexpr auto g_default_frame_rate = 60.0;
+constexpr auto g_default_frames_in_flight = 2;
 }// namespace
 
 int main(int argc, char ** argv)
@@ -16,16 +29,170 @@ int main(int argc, char ** argv)
 	QApplication::setAttribute(Qt::AA_UseDesktopOpenGL);
 	QApplication app(argc, argv);
 
+	// Parse command line.
+	QCommandLineParser parser;
+	parser.addHelpOption();
+	const QCommandLineOption frameModeOption("frame-mode", "Frame scheduling: on-demand, fixed or uncapped.", "mode", "on-demand");
+	const QCommandLineOption frameRateOption("frame-rate", "Frame rate of the fixed mode.", "hz", QString::number(g_default_frame_rate));
+	const QCommandLineOption framesInFlightOption("frames-in-flight", "Frames the CPU may prepare ahead of the GPU, 1 to 3.", "count", QString::number(g_default_frames_in_flight));
+	const QCommandLineOption depthPrepassOption("depth-prepass", "Depth pre-pass: auto, on or off.", "mode", "auto");
+	const QCommandLineOption transparencyOption("transparency", "Transparent materials: sorted or oit.", "mode", "sorted");
+	const QCommandLineOption morphCacheOption("morph-cache", "Capture morphed vertices while the coefficient is unchanged: on or off.", "mode", "off");
+	const QCommandLineOption morphStreamOption("morph-stream", "Morph from vertices precomputed at load time: on or off.", "mode", "off");
+	const QCommandLineOption morphBakeOption("morph-bake", "Bake the morph into a vertex animation texture: off, float16 or unorm16.", "format", "off");
+	const QCommandLineOption morphBakeFramesOption("morph-bake-frames", "Frames of the baked morph.", "frames", QString::number(MorphBake::DefaultFrames));
+	const QCommandLineOption morphComputeOption("morph-compute", "Morph once per unique morph state with GL 4.3 compute shaders: on or off.", "mode", "off");
+	const QCommandLineOption tessellationOption("tessellation", "Morph per generated vertex with GL 4.0 tessellation: on or off.", "mode", "off");
+	const QCommandLineOption morphShapeOption("morph-shape", "Shape the cube morphs into: sphere, superellipsoid, cylinder, octahedron or torus.", "shape", "sphere");
+	const QCommandLineOption morphExponentOption("morph-exponent", "Exponent of the superellipsoid shape.", "exponent", QString::number(MorphShapes::DefaultExponent));
+	const QCommandLineOption morphCurveOption("morph-curve", "Keyframes of the spherify animation, time:value[:easing],...", "keyframes");
+	const QCommandLineOption morphBenchmarkOption("morph-benchmark", "Check the CPU morph against the GPU and measure it on this many vertices.", "vertices");
+	const QCommandLineOption cullBenchmarkOption("cull-benchmark", "Time the linear frustum cull against the BVH on this many random boxes.", "boxes");
+	const QCommandLineOption subdividedCubeOption("subdivided-cube", "Draw a procedural cube with this many quads per face edge instead of the glTF model.", "subdivisions");
+	const QCommandLineOption noDsaOption("no-dsa", "Create GL objects with bind-to-edit calls even when direct state access is available.");
+	parser.addOption(frameModeOption);
+	parser.addOption(frameRateOption);
+	parser.addOption(framesInFlightOption);
+	parser.addOption(depthPrepassOption);
+	parser.addOption(transparencyOption);
+	parser.addOption(morphCacheOption);
+	parser.addOption(morphStreamOption);
+	parser.addOption(morphBakeOption);
+	parser.addOption(morphBakeFramesOption);
+	parser.addOption(morphComputeOption);
+	parser.addOption(tessellationOption);
+	parser.addOption(morphShapeOption);
+	parser.addOption(morphExponentOption);
+	parser.addOption(morphCurveOption);
+	parser.addOption(morphBenchmarkOption);
+	parser.addOption(cullBenchmarkOption);
+	parser.addOption(subdividedCubeOption);
+	parser.addOption(noDsaOption);
+	parser.process(app);
+
+	auto frameMode = fgl::FrameScheduler::parseMode(parser.value(frameModeOption));
+	if (!frameMode)
+	{
+		std::cout << "Unknown frame mode '" << parser.value(frameModeOption).toStdString() << "', using on-demand" << std::endl;
+		frameMode = fgl::FrameScheduler::Mode::OnDemand;
+	}
+	auto depthPrepassMode = DepthPrepass::parseMode(parser.value(depthPrepassOption));
+	if (!depthPrepassMode)
+	{
+		std::cout << "Unknown depth pre-pass mode '" << parser.value(depthPrepassOption).toStdString() << "', using auto" << std::endl;
+		depthPrepassMode = DepthPrepass::Mode::Auto;
+	}
+	auto transparencyMode = Transparency::parseMode(parser.value(transparencyOption));
+	if (!transparencyMode)
+	{
+		std::cout << "Unknown transparency mode '" << parser.value(transparencyOption).toStdString() << "', using sorted" << std::endl;
+		transparencyMode = Transparency::Mode::Sorted;
+	}
+	auto frameRateValid = false;
+	const auto frameRate = parser.value(frameRateOption).toDouble(&frameRateValid);
+	auto morphCacheMode = MorphCache::parseMode(parser.value(morphCacheOption));
+	if (!morphCacheMode)
+	{
+		std::cout << "Unknown morph cache mode '" << parser.value(morphCacheOption).toStdString() << "', using off" << std::endl;
+		morphCacheMode = MorphCache::Mode::Off;
+	}
+	auto morphStreamMode = MorphStream::parseMode(parser.value(morphStreamOption));
+	if (!morphStreamMode)
+	{
+		std::cout << "Unknown morph stream mode '" << parser.value(morphStreamOption).toStdString() << "', using off" << std::endl;
+		morphStreamMode = MorphStream::Mode::Off;
+	}
+	auto morphBakeMode = MorphBake::parseMode(parser.value(morphBakeOption));
+	if (!morphBakeMode)
+	{
+		std::cout << "Unknown morph bake format '" << parser.value(morphBakeOption).toStdString() << "', using off" << std::endl;
+		morphBakeMode = MorphBake::Mode::Off;
+	}
+	auto morphBakeFramesValid = false;
+	const auto morphBakeFrames = parser.value(morphBakeFramesOption).toInt(&morphBakeFramesValid);
+	auto morphComputeMode = MorphCompute::parseMode(parser.value(morphComputeOption));
+	if (!morphComputeMode)
+	{
+		std::cout << "Unknown morph compute mode '" << parser.value(morphComputeOption).toStdString() << "', using off" << std::endl;
+		morphComputeMode = MorphCompute::Mode::Off;
+	}
+	auto tessellationMode = Tessellation::parseMode(parser.value(tessellationOption));
+	if (!tessellationMode)
+	{
+		std::cout << "Unknown tessellation mode '" << parser.value(tessellationOption).toStdString() << "', using off" << std::endl;
+		tessellationMode = Tessellation::Mode::Off;
+	}
+	auto morphShape = MorphShapes::parseShape(parser.value(morphShapeOption));
+	if (!morphShape)
+	{
+		std::cout << "Unknown morph shape '" << parser.value(morphShapeOption).toStdString() << "', using sphere" << std::endl;
+		morphShape = MorphShapes::Shape::Sphere;
+	}
+	auto morphExponentValid = false;
+	const auto morphExponent = parser.value(morphExponentOption).toFloat(&morphExponentValid);
+	std::optional<std::vector<MorphAnimation::Keyframe>> morphCurve;
+	if (parser.isSet(morphCurveOption))
+	{
+		morphCurve = MorphAnimation::parseCurve(parser.value(morphCurveOption));
+		if (!morphCurve)
+		{
+			std::cout << "Unknown morph curve '" << parser.value(morphCurveOption).toStdString() << "', using the default" << std::endl;
+		}
+	}
+	auto morphBenchmarkValid = false;
+	const auto morphBenchmark = parser.value(morphBenchmarkOption).toInt(&morphBenchmarkValid);
+	auto cullBenchmarkValid = false;
+	const auto cullBenchmark = parser.value(cullBenchmarkOption).toInt(&cullBenchmarkValid);
+	auto subdividedCubeValid = false;
+	const auto subdividedCube = parser.value(subdividedCubeOption).toInt(&subdividedCubeValid);
+	auto framesInFlightValid = false;
+	const auto framesInFlight = parser.value(framesInFlightOption).toInt(&framesInFlightValid);
+
 	// Set default surface format.
 	QSurfaceFormat format;
 	format.setSamples(g_sampels);
-	format.setVersion(g_gl_major_version, g_gl_minor_version);
+	if (*morphComputeMode == MorphCompute::Mode::On)
+	{
+		format.setVersion(g_compute_gl_major_version, g_compute_gl_minor_version);
+	}
+	else if (*tessellationMode == Tessellation::Mode::On)
+	{
+		format.setVersion(g_tessellation_gl_major_version, g_tessellation_gl_minor_version);
+	}
+	else
+	{
+		format.setVersion(g_gl_major_version, g_gl_minor_version);
+	}
 	format.setProfile(QSurfaceFormat::CoreProfile);
+	// Benchmarking should not be capped by vsync.
+	if (*frameMode == fgl::FrameScheduler::Mode::Uncapped)
+	{
+		format.setSwapInterval(0);
+	}
 	QSurfaceFormat::setDefaultFormat(format);
 
 	// Now create window.
 	Window window;
 	window.resize(1000, 800);
+	window.scheduler().setMode(*frameMode, frameRateValid ? frameRate : g_default_frame_rate);
+	window.depthPrepass().setMode(*depthPrepassMode);
+	window.transparency().setMode(*transparencyMode);
+	window.morphCache().setMode(*morphCacheMode);
+	window.morphStream().setMode(*morphStreamMode);
+	window.morphBake().setMode(*morphBakeMode);
+	window.morphBake().setFrames(morphBakeFramesValid && morphBakeFrames > 0 ? static_cast<size_t>(morphBakeFrames) : MorphBake::DefaultFrames);
+	window.morphCompute().setMode(*morphComputeMode);
+	window.tessellation().setMode(*tessellationMode);
+	window.setMorphShape(*morphShape, morphExponentValid && morphExponent > 0.0f ? morphExponent : MorphShapes::DefaultExponent);
+	if (morphCurve && !window.morphAnimation().setCurve(std::move(*morphCurve)))
+	{
+		std::cout << "Morph curve keyframes must be sorted and start at 0, using the default" << std::endl;
+	}
+	window.setMorphBenchmark(morphBenchmarkValid && morphBenchmark > 0 ? static_cast<size_t>(morphBenchmark) : 0);
+	window.setCullBenchmark(cullBenchmarkValid && cullBenchmark > 0 ? static_cast<size_t>(cullBenchmark) : 0);
+	window.setSubdividedCube(subdividedCubeValid && subdividedCube > 0 ? static_cast<size_t>(subdividedCube) : 0);
+	window.resources().setDirectAllowed(!parser.isSet(noDsaOption));
+	window.frames().setFramesInFlight(framesInFlightValid && framesInFlight > 0 ? static_cast<size_t>(framesInFlight) : g_default_frames_in_flight);
 	window.show();
 
 	return app.exec();
@@ -0,0 +1,47 @@
+#include "FixedStepClock.hpp"
+
+#include <algorithm>
+#include <cmath>
+
+namespace fgl
+{
+
+namespace
+{
+constexpr double g_ns_per_second = 1e9;
+}// namespace
+
+FixedStepClock::FixedStepClock(const double stepSeconds)
+	: stepSeconds_{stepSeconds}
+	, stepNs_{std::max<std::int64_t>(std::llround(stepSeconds * g_ns_per_second), 1)}
+{
+	reset();
+}
+
+void FixedStepClock::reset()
+{
+	clock_.start();
+	lastNs_ = 0;
+	accumulatorNs_ = 0;
+	steps_ = 0;
+}
+
+size_t FixedStepClock::advance()
+{
+	const auto now = clock_.nsecsElapsed();
+	accumulatorNs_ += now - lastNs_;
+	lastNs_ = now;
+
+	const auto due = static_cast<size_t>(accumulatorNs_ / stepNs_);
+	const auto steps = std::min(due, MaxStepsPerFrame);
+	accumulatorNs_ -= static_cast<std::int64_t>(due) * stepNs_;
+	steps_ += steps;
+	return steps;
+}
+
+double FixedStepClock::alpha() const noexcept
+{
+	return static_cast<double>(accumulatorNs_) / static_cast<double>(stepNs_);
+}
+
+}// namespace fgl
@@ -0,0 +1,45 @@
+#pragma once
+
+#include <QElapsedTimer>
+
+#include <cstddef>
+#include <cstdint>
+
+namespace fgl
+{
+
+// Simulation clock with a fixed timestep, decoupled from the render rate. Every frame
+// advance() turns the real time since the previous frame into whole steps; the remainder
+// stays in the accumulator, and alpha() tells how far the frame lies between the last two
+// simulated states, so rendering interpolates instead of snapping to a step. After a long
+// stall at most MaxStepsPerFrame steps run and the rest of the backlog is dropped.
+class FixedStepClock final
+{
+public:
+	static constexpr size_t MaxStepsPerFrame = 8;
+
+public:
+	explicit FixedStepClock(double stepSeconds = 1.0 / 120.0);
+
+	// Restarts at simulated time zero with an empty accumulator.
+	void reset();
+
+	// Steps to simulate for the real time passed since the previous call.
+	[[nodiscard]] size_t advance();
+
+	[[nodiscard]] double step() const noexcept { return stepSeconds_; }
+	// Simulated time of the latest step.
+	[[nodiscard]] double time() const noexcept { return static_cast<double>(steps_) * stepSeconds_; }
+	// Position of the current frame between the previous and the latest step, in [0, 1).
+	[[nodiscard]] double alpha() const noexcept;
+
+private:
+	QElapsedTimer clock_;
+	double stepSeconds_;
+	std::int64_t stepNs_;
+	std::int64_t lastNs_ = 0;
+	std::int64_t accumulatorNs_ = 0;
+	std::uint64_t steps_ = 0;
+};
+
+}// namespace fgl
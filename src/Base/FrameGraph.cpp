@@ -0,0 +1,557 @@
+#include "FrameGraph.hpp"
+
+#include <QOpenGLContext>
+
+#include <algorithm>
+#include <iostream>
+
+namespace fgl
+{
+
+namespace
+{
+// Physical textures not used for this many frames are released.
+constexpr size_t g_max_idle_frames = 4;
+
+struct PixelFormat
+{
+	GLenum format;
+	GLenum type;
+};
+
+PixelFormat pixelFormat(const GLenum internalFormat)
+{
+	switch (internalFormat)
+	{
+		case GL_DEPTH_COMPONENT16:
+		case GL_DEPTH_COMPONENT24:
+			return {GL_DEPTH_COMPONENT, GL_UNSIGNED_INT};
+		case GL_DEPTH_COMPONENT32F:
+			return {GL_DEPTH_COMPONENT, GL_FLOAT};
+		case GL_DEPTH24_STENCIL8:
+			return {GL_DEPTH_STENCIL, GL_UNSIGNED_INT_24_8};
+		case GL_R8:
+			return {GL_RED, GL_UNSIGNED_BYTE};
+		case GL_R16F:
+			return {GL_RED, GL_HALF_FLOAT};
+		case GL_RG16F:
+			return {GL_RG, GL_HALF_FLOAT};
+		case GL_RGBA16F:
+			return {GL_RGBA, GL_HALF_FLOAT};
+		case GL_R32F:
+			return {GL_RED, GL_FLOAT};
+		case GL_RGBA32F:
+			return {GL_RGBA, GL_FLOAT};
+		default:
+			return {GL_RGBA, GL_UNSIGNED_BYTE};
+	}
+}
+
+bool isDepthFormat(const GLenum internalFormat)
+{
+	return pixelFormat(internalFormat).format == GL_DEPTH_COMPONENT || internalFormat == GL_DEPTH24_STENCIL8;
+}
+}// namespace
+
+auto FrameGraph::Pass::read(const Resource resource) -> Pass &
+{
+	reads_.push_back(resource);
+	return *this;
+}
+
+auto FrameGraph::Pass::color(const Resource resource, const LoadOp load, const StoreOp store,
+							 const std::array<GLfloat, 4> & clearColor) -> Pass &
+{
+	Q_ASSERT(colors_.size() < MaxColorAttachments);
+	colors_.push_back(Attachment{resource, load, store, clearColor});
+	return *this;
+}
+
+auto FrameGraph::Pass::depth(const Resource resource, const LoadOp load, const StoreOp store,
+							 const GLfloat clearDepth) -> Pass &
+{
+	depth_ = Attachment{resource, load, store, {clearDepth}};
+	return *this;
+}
+
+FrameGraph::~FrameGraph()
+{
+	// GL objects are expected to be released with destroy() while the context is current.
+	Q_ASSERT(textures_.empty() && framebuffers_.empty());
+}
+
+void FrameGraph::create(GLState & state)
+{
+	initializeOpenGLFunctions();
+	state_ = &state;
+
+	// Invalidation is core in GL 4.3 and ES 3.0, without it the hints are skipped.
+	invalidateFramebuffer_ = nullptr;
+	if (const auto context = QOpenGLContext::currentContext())
+	{
+		const auto version = context->format().version();
+		const auto supported = context->isOpenGLES()
+			? version >= qMakePair(3, 0)
+			: version >= qMakePair(4, 3) || context->hasExtension("GL_ARB_invalidate_subdata");
+		if (supported)
+		{
+			invalidateFramebuffer_ = reinterpret_cast<decltype(invalidateFramebuffer_)>(
+				context->getProcAddress("glInvalidateFramebuffer"));
+		}
+	}
+}
+
+void FrameGraph::destroy()
+{
+	for (const auto & [attachments, framebuffer] : framebuffers_)
+	{
+		state_->forgetFramebuffer(framebuffer);
+		glDeleteFramebuffers(1, &framebuffer);
+	}
+	framebuffers_.clear();
+
+	for (const auto & texture : textures_)
+	{
+		state_->forgetTexture(texture.id);
+		glDeleteTextures(1, &texture.id);
+	}
+	textures_.clear();
+
+	passes_.clear();
+	resources_.clear();
+}
+
+void FrameGraph::beginFrame(const GLuint backbuffer, const GLsizei width, const GLsizei height)
+{
+	backbuffer_ = backbuffer;
+	width_ = width;
+	height_ = height;
+
+	passes_.clear();
+	resources_.clear();
+
+	ResourceNode color;
+	color.name = "backbuffer.color";
+	color.desc = TextureDesc{width, height, GL_RGBA8};
+	color.imported = true;
+	resources_.push_back(color);
+
+	// The widget framebuffer carries a packed depth/stencil attachment.
+	ResourceNode depth;
+	depth.name = "backbuffer.depth";
+	depth.desc = TextureDesc{width, height, GL_DEPTH24_STENCIL8};
+	depth.imported = true;
+	resources_.push_back(depth);
+}
+
+auto FrameGraph::createTexture(std::string name, const TextureDesc & desc) -> Resource
+{
+	ResourceNode node;
+	node.name = std::move(name);
+	node.desc = desc;
+	resources_.push_back(std::move(node));
+	return static_cast<Resource>(resources_.size() - 1);
+}
+
+auto FrameGraph::addPass(std::string name, std::function<void()> execute) -> Pass &
+{
+	auto & pass = passes_.emplace_back();
+	pass.name_ = std::move(name);
+	pass.execute_ = std::move(execute);
+	return pass;
+}
+
+void FrameGraph::execute()
+{
+	stats_ = Stats{};
+	stats_.passes = passes_.size();
+
+	cullPasses();
+	computeLifetimes();
+	assignTextures();
+
+	for (size_t passIndex = 0; passIndex < passes_.size(); ++passIndex)
+	{
+		if (!passes_[passIndex].culled_)
+		{
+			runPass(passIndex);
+		}
+	}
+
+	releaseIdleTextures();
+	stats_.physicalTextures = textures_.size();
+}
+
+GLuint FrameGraph::texture(const Resource resource) const
+{
+	const auto & node = resources_.at(resource);
+	return node.imported || !node.firstPass ? 0 : textures_[node.physical].id;
+}
+
+void FrameGraph::cullPasses()
+{
+	for (auto & resource : resources_)
+	{
+		resource.needed = resource.imported;
+	}
+
+	// Walking backwards, a pass survives when something that survives consumes one of its writes.
+	for (auto pass = passes_.rbegin(); pass != passes_.rend(); ++pass)
+	{
+		auto writesNeeded = pass->depth_ && resources_[pass->depth_->resource].needed;
+		for (const auto & attachment : pass->colors_)
+		{
+			writesNeeded = writesNeeded || resources_[attachment.resource].needed;
+		}
+
+		pass->culled_ = !writesNeeded;
+		if (pass->culled_)
+		{
+			++stats_.culledPasses;
+			continue;
+		}
+
+		for (const auto resource : pass->reads_)
+		{
+			resources_[resource].needed = true;
+		}
+	}
+}
+
+void FrameGraph::computeLifetimes()
+{
+	for (size_t passIndex = 0; passIndex < passes_.size(); ++passIndex)
+	{
+		const auto & pass = passes_[passIndex];
+		if (pass.culled_)
+		{
+			continue;
+		}
+
+		const auto touch = [&](const Resource resource) {
+			auto & node = resources_[resource];
+			if (!node.firstPass)
+			{
+				node.firstPass = passIndex;
+			}
+			node.lastPass = passIndex;
+		};
+
+		for (const auto resource : pass.reads_)
+		{
+			touch(resource);
+		}
+		for (const auto & attachment : pass.colors_)
+		{
+			touch(attachment.resource);
+		}
+		if (pass.depth_)
+		{
+			touch(pass.depth_->resource);
+		}
+	}
+}
+
+void FrameGraph::assignTextures()
+{
+	for (auto & texture : textures_)
+	{
+		texture.busyUntil.reset();
+	}
+
+	std::vector<Resource> transients;
+	for (Resource resource = 0; resource < resources_.size(); ++resource)
+	{
+		if (!resources_[resource].imported && resources_[resource].firstPass)
+		{
+			transients.push_back(resource);
+		}
+	}
+	std::stable_sort(transients.begin(), transients.end(), [this](const Resource lhs, const Resource rhs) {
+		return *resources_[lhs].firstPass < *resources_[rhs].firstPass;
+	});
+
+	// Greedy interval assignment: a texture is reused once the last pass of its previous owner is done.
+	for (const auto resource : transients)
+	{
+		auto & node = resources_[resource];
+		const auto reusable = std::find_if(textures_.begin(), textures_.end(), [&node](const PhysicalTexture & texture) {
+			return texture.desc == node.desc && (!texture.busyUntil || *texture.busyUntil < *node.firstPass);
+		});
+
+		if (reusable != textures_.end())
+		{
+			node.physical = static_cast<size_t>(reusable - textures_.begin());
+		}
+		else
+		{
+			node.physical = textures_.size();
+			PhysicalTexture texture;
+			texture.desc = node.desc;
+			texture.id = allocateTexture(node.desc);
+			textures_.push_back(texture);
+		}
+
+		auto & texture = textures_[node.physical];
+		texture.busyUntil = node.lastPass;
+		texture.idleFrames = 0;
+		++stats_.transientTextures;
+	}
+}
+
+void FrameGraph::runPass(const size_t passIndex)
+{
+	const auto & pass = passes_[passIndex];
+	if (pass.colors_.empty() && !pass.depth_)
+	{
+		pass.execute_();
+		return;
+	}
+
+	auto isBackbuffer = false;
+	const auto framebuffer = framebufferFor(pass, isBackbuffer);
+	if (!framebuffer)
+	{
+		std::cout << "FrameGraph: pass '" << pass.name_ << "' mixes backbuffer and transient targets, skipped" << std::endl;
+		return;
+	}
+
+	state_->bindFramebuffer(*framebuffer);
+	if (isBackbuffer)
+	{
+		glViewport(0, 0, width_, height_);
+	}
+	else
+	{
+		const auto & desc = resources_[pass.depth_ ? pass.depth_->resource : pass.colors_.front().resource].desc;
+		glViewport(0, 0, desc.width, desc.height);
+	}
+
+	std::vector<std::pair<const Pass::Attachment *, std::optional<size_t>>> attachments;
+	for (size_t colorIndex = 0; colorIndex < pass.colors_.size(); ++colorIndex)
+	{
+		attachments.emplace_back(&pass.colors_[colorIndex], colorIndex);
+	}
+	if (pass.depth_)
+	{
+		attachments.emplace_back(&*pass.depth_, std::nullopt);
+	}
+
+	// Content the pass does not load is invalidated up front, so tiled GPUs skip restoring it.
+	// A transient target has no content before its first write, whatever the pass asked for.
+	std::vector<GLenum> dontCare;
+	for (const auto & [attachment, colorIndex] : attachments)
+	{
+		const auto & node = resources_[attachment->resource];
+		const auto undefined = !node.written && !node.imported && attachment->load == LoadOp::Load;
+		if (attachment->load == LoadOp::DontCare || undefined)
+		{
+			appendAttachmentPoints(dontCare, attachment->resource, colorIndex, isBackbuffer);
+		}
+	}
+	if (!dontCare.empty() && invalidateFramebuffer_ != nullptr)
+	{
+		invalidateFramebuffer_(GL_FRAMEBUFFER, static_cast<GLsizei>(dontCare.size()), dontCare.data());
+		++stats_.invalidations;
+	}
+
+	// Each target is cleared on its first write only, later Clear requests keep its content.
+	for (const auto & [attachment, colorIndex] : attachments)
+	{
+		const auto & node = resources_[attachment->resource];
+		if (attachment->load != LoadOp::Clear || node.written)
+		{
+			continue;
+		}
+
+		if (colorIndex)
+		{
+			state_->colorMask(true);
+			glClearBufferfv(GL_COLOR, static_cast<GLint>(*colorIndex), attachment->clear.data());
+		}
+		else if (node.desc.internalFormat == GL_DEPTH24_STENCIL8)
+		{
+			state_->depthMask(true);
+			glClearBufferfi(GL_DEPTH_STENCIL, 0, attachment->clear[0], 0);
+		}
+		else
+		{
+			state_->depthMask(true);
+			glClearBufferfv(GL_DEPTH, 0, attachment->clear.data());
+		}
+		++stats_.clears;
+	}
+
+	pass.execute_();
+
+	// Attachments nobody reads later are dropped instead of being written back.
+	std::vector<GLenum> discard;
+	for (const auto & [attachment, colorIndex] : attachments)
+	{
+		auto & node = resources_[attachment->resource];
+		node.written = true;
+
+		const auto lastUse = node.lastPass == passIndex;
+		if (lastUse && (attachment->store == StoreOp::Discard || !node.imported))
+		{
+			appendAttachmentPoints(discard, attachment->resource, colorIndex, isBackbuffer);
+		}
+	}
+	if (!discard.empty() && invalidateFramebuffer_ != nullptr)
+	{
+		state_->bindFramebuffer(*framebuffer);
+		invalidateFramebuffer_(GL_FRAMEBUFFER, static_cast<GLsizei>(discard.size()), discard.data());
+		++stats_.invalidations;
+	}
+}
+
+std::optional<GLuint> FrameGraph::framebufferFor(const Pass & pass, bool & isBackbuffer)
+{
+	size_t imported = 0;
+	std::vector<GLuint> key;
+	for (const auto & attachment : pass.colors_)
+	{
+		imported += resources_[attachment.resource].imported ? 1 : 0;
+		key.push_back(texture(attachment.resource));
+	}
+	if (pass.depth_)
+	{
+		imported += resources_[pass.depth_->resource].imported ? 1 : 0;
+	}
+	key.push_back(pass.depth_ ? texture(pass.depth_->resource) : 0);
+
+	const auto attachmentCount = pass.colors_.size() + (pass.depth_ ? 1 : 0);
+	isBackbuffer = imported == attachmentCount;
+	if (isBackbuffer)
+	{
+		return backbuffer_;
+	}
+	if (imported != 0)
+	{
+		return std::nullopt;
+	}
+
+	if (const auto cached = framebuffers_.find(key); cached != framebuffers_.end())
+	{
+		return cached->second;
+	}
+
+	GLuint framebuffer = 0;
+	glGenFramebuffers(1, &framebuffer);
+	state_->bindFramebuffer(framebuffer);
+
+	std::vector<GLenum> drawBuffers;
+	for (size_t colorIndex = 0; colorIndex < pass.colors_.size(); ++colorIndex)
+	{
+		const auto attachment = static_cast<GLenum>(GL_COLOR_ATTACHMENT0 + colorIndex);
+		glFramebufferTexture2D(GL_FRAMEBUFFER, attachment, GL_TEXTURE_2D, key[colorIndex], 0);
+		drawBuffers.push_back(attachment);
+	}
+	if (pass.depth_)
+	{
+		const auto stencil = resources_[pass.depth_->resource].desc.internalFormat == GL_DEPTH24_STENCIL8;
+		glFramebufferTexture2D(GL_FRAMEBUFFER, stencil ? GL_DEPTH_STENCIL_ATTACHMENT : GL_DEPTH_ATTACHMENT,
+							   GL_TEXTURE_2D, key.back(), 0);
+	}
+	if (drawBuffers.empty())
+	{
+		drawBuffers.push_back(GL_NONE);
+		glReadBuffer(GL_NONE);
+	}
+	glDrawBuffers(static_cast<GLsizei>(drawBuffers.size()), drawBuffers.data());
+
+	if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE)
+	{
+		std::cout << "FrameGraph: framebuffer of pass '" << pass.name_ << "' is incomplete" << std::endl;
+	}
+
+	framebuffers_.emplace(std::move(key), framebuffer);
+	return framebuffer;
+}
+
+void FrameGraph::appendAttachmentPoints(std::vector<GLenum> & points, const Resource resource,
+									   const std::optional<size_t> colorIndex, const bool isBackbuffer) const
+{
+	const auto stencil = resources_[resource].desc.internalFormat == GL_DEPTH24_STENCIL8;
+
+	// The window-system framebuffer names its buffers instead of attachment points.
+	if (isBackbuffer && backbuffer_ == 0)
+	{
+		if (colorIndex)
+		{
+			points.push_back(GL_COLOR);
+			return;
+		}
+		points.push_back(GL_DEPTH);
+		if (stencil)
+		{
+			points.push_back(GL_STENCIL);
+		}
+		return;
+	}
+
+	if (colorIndex)
+	{
+		points.push_back(static_cast<GLenum>(GL_COLOR_ATTACHMENT0 + *colorIndex));
+		return;
+	}
+	points.push_back(stencil ? GL_DEPTH_STENCIL_ATTACHMENT : GL_DEPTH_ATTACHMENT);
+}
+
+GLuint FrameGraph::allocateTexture(const TextureDesc & desc)
+{
+	GLuint texture = 0;
+	glGenTextures(1, &texture);
+	state_->bindTexture(0, GL_TEXTURE_2D, texture);
+
+	const auto format = pixelFormat(desc.internalFormat);
+	glTexImage2D(GL_TEXTURE_2D, 0, static_cast<GLint>(desc.internalFormat), desc.width, desc.height, 0,
+				 format.format, format.type, nullptr);
+
+	const auto filter = isDepthFormat(desc.internalFormat) ? GL_NEAREST : GL_LINEAR;
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, filter);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, filter);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+	return texture;
+}
+
+void FrameGraph::releaseIdleTextures()
+{
+	for (auto & texture : textures_)
+	{
+		if (!texture.busyUntil)
+		{
+			++texture.idleFrames;
+		}
+	}
+
+	const auto idle = [](const PhysicalTexture & texture) { return texture.idleFrames > g_max_idle_frames; };
+	for (const auto & texture : textures_)
+	{
+		if (!idle(texture))
+		{
+			continue;
+		}
+
+		for (auto framebuffer = framebuffers_.begin(); framebuffer != framebuffers_.end();)
+		{
+			const auto & attachments = framebuffer->first;
+			if (std::find(attachments.begin(), attachments.end(), texture.id) != attachments.end())
+			{
+				state_->forgetFramebuffer(framebuffer->second);
+				glDeleteFramebuffers(1, &framebuffer->second);
+				framebuffer = framebuffers_.erase(framebuffer);
+			}
+			else
+			{
+				++framebuffer;
+			}
+		}
+		state_->forgetTexture(texture.id);
+		glDeleteTextures(1, &texture.id);
+	}
+	textures_.erase(std::remove_if(textures_.begin(), textures_.end(), idle), textures_.end());
+}
+
+}// namespace fgl
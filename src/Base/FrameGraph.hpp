@@ -0,0 +1,182 @@
+#pragma once
+
+#include <QOpenGLExtraFunctions>
+
+#include "GLState.hpp"
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <map>
+#include <optional>
+#include <string>
+#include <vector>
+
+namespace fgl
+{
+
+// Per-frame graph of render passes. Every pass declares the targets it reads and
+// writes together with load/store actions; execute() then culls passes nobody
+// consumes, clears each target at most once, invalidates attachments whose content
+// is not needed afterwards and lets transient textures with disjoint lifetimes
+// share one physical texture.
+//
+// The graph is declared again every frame between beginFrame() and execute().
+// Physical textures and framebuffers are cached across frames.
+class FrameGraph final : protected QOpenGLExtraFunctions
+{
+public:
+	using Resource = std::uint32_t;
+
+	enum class LoadOp
+	{
+		Load,    // keep what previous passes rendered
+		Clear,   // clear on the first write of the frame
+		DontCare,// previous content is not needed
+	};
+
+	enum class StoreOp
+	{
+		Store,  // content is used after the pass
+		Discard,// content may be dropped once the pass is done
+	};
+
+	struct TextureDesc
+	{
+		GLsizei width = 0;
+		GLsizei height = 0;
+		GLenum internalFormat = GL_RGBA8;
+
+		bool operator==(const TextureDesc & other) const noexcept
+		{
+			return width == other.width && height == other.height && internalFormat == other.internalFormat;
+		}
+	};
+
+	class Pass final
+	{
+	public:
+		Pass & read(Resource resource);
+		Pass & color(Resource resource, LoadOp load, StoreOp store, const std::array<GLfloat, 4> & clearColor = {});
+		Pass & depth(Resource resource, LoadOp load, StoreOp store, GLfloat clearDepth = 1.0f);
+
+	private:
+		friend class FrameGraph;
+
+		struct Attachment
+		{
+			Resource resource = 0;
+			LoadOp load = LoadOp::Load;
+			StoreOp store = StoreOp::Store;
+			std::array<GLfloat, 4> clear{};
+		};
+
+		std::string name_;
+		std::function<void()> execute_;
+		std::vector<Resource> reads_;
+		std::vector<Attachment> colors_;
+		std::optional<Attachment> depth_;
+		bool culled_ = false;
+	};
+
+	struct Stats
+	{
+		size_t passes = 0;
+		size_t culledPasses = 0;
+		size_t clears = 0;
+		size_t invalidations = 0;
+		size_t transientTextures = 0;
+		size_t physicalTextures = 0;
+	};
+
+	static constexpr size_t MaxColorAttachments = 8;
+
+public:
+	FrameGraph() = default;
+	~FrameGraph();
+
+	FrameGraph(const FrameGraph &) = delete;
+	FrameGraph(FrameGraph &&) = delete;
+	FrameGraph & operator=(const FrameGraph &) = delete;
+	FrameGraph & operator=(FrameGraph &&) = delete;
+
+public:
+	// Both require a current context. Bindings go through state.
+	void create(GLState & state);
+	void destroy();
+
+	// Starts declaring a frame rendered into the given framebuffer, usually the
+	// default framebuffer object of the widget.
+	void beginFrame(GLuint backbuffer, GLsizei width, GLsizei height);
+
+	[[nodiscard]] Resource backbufferColor() const noexcept { return BackbufferColor; }
+	[[nodiscard]] Resource backbufferDepth() const noexcept { return BackbufferDepth; }
+
+	// Texture that only lives within the frame.
+	[[nodiscard]] Resource createTexture(std::string name, const TextureDesc & desc);
+
+	Pass & addPass(std::string name, std::function<void()> execute);
+
+	void execute();
+
+	// Texture backing a transient resource, valid while passes are executed.
+	[[nodiscard]] GLuint texture(Resource resource) const;
+
+	[[nodiscard]] const Stats & stats() const noexcept { return stats_; }
+	[[nodiscard]] bool canInvalidate() const noexcept { return invalidateFramebuffer_ != nullptr; }
+
+private:
+	static constexpr Resource BackbufferColor = 0;
+	static constexpr Resource BackbufferDepth = 1;
+
+	struct ResourceNode
+	{
+		std::string name;
+		TextureDesc desc;
+		bool imported = false;
+		bool needed = false;
+		bool written = false;
+		std::optional<size_t> firstPass;// unset when no executed pass uses it
+		size_t lastPass = 0;
+		size_t physical = 0;
+	};
+
+	struct PhysicalTexture
+	{
+		TextureDesc desc;
+		GLuint id = 0;
+		size_t idleFrames = 0;
+		std::optional<size_t> busyUntil;
+	};
+
+	void cullPasses();
+	void computeLifetimes();
+	void assignTextures();
+	void runPass(size_t passIndex);
+
+	// Framebuffer the pass renders into, nothing when it mixes backbuffer and transient targets.
+	[[nodiscard]] std::optional<GLuint> framebufferFor(const Pass & pass, bool & isBackbuffer);
+	void appendAttachmentPoints(std::vector<GLenum> & points, Resource resource, std::optional<size_t> colorIndex, bool isBackbuffer) const;
+	[[nodiscard]] GLuint allocateTexture(const TextureDesc & desc);
+	void releaseIdleTextures();
+
+private:
+	GLState * state_ = nullptr;
+	void(QOPENGLF_APIENTRYP invalidateFramebuffer_)(GLenum target, GLsizei count, const GLenum * attachments) = nullptr;
+
+	GLuint backbuffer_ = 0;
+	GLsizei width_ = 0;
+	GLsizei height_ = 0;
+
+	std::vector<ResourceNode> resources_;
+	std::deque<Pass> passes_;
+
+	std::vector<PhysicalTexture> textures_;
+	std::map<std::vector<GLuint>, GLuint> framebuffers_;
+
+	Stats stats_;
+};
+
+}// namespace fgl
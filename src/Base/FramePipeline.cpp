@@ -0,0 +1,102 @@
+#include "FramePipeline.hpp"
+
+#include <algorithm>
+
+namespace fgl
+{
+
+namespace
+{
+constexpr GLuint64 g_fence_timeout_ns = 1'000'000'000;
+constexpr double g_ns_per_ms = 1'000'000.0;
+}// namespace
+
+FramePipeline::~FramePipeline()
+{
+	// GL objects are expected to be released with destroy() while the context is current.
+	Q_ASSERT(std::all_of(fences_.begin(), fences_.end(), [](const GLsync fence) { return fence == nullptr; }));
+}
+
+void FramePipeline::setFramesInFlight(const size_t count) noexcept
+{
+	framesInFlight_ = std::clamp<size_t>(count, 1, MaxFramesInFlight);
+}
+
+void FramePipeline::create()
+{
+	initializeOpenGLFunctions();
+	clock_.start();
+	slot_ = 0;
+}
+
+void FramePipeline::destroy()
+{
+	waitIdle();
+}
+
+void FramePipeline::beginFrame()
+{
+	slot_ = (slot_ + 1) % framesInFlight_;
+
+	const auto start = clock_.nsecsElapsed();
+	wait(slot_);
+	record(static_cast<double>(clock_.nsecsElapsed() - start) / g_ns_per_ms);
+}
+
+void FramePipeline::endFrame()
+{
+	Q_ASSERT(fences_[slot_] == nullptr);
+	fences_[slot_] = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+}
+
+void FramePipeline::waitIdle()
+{
+	for (size_t slot = 0; slot < fences_.size(); ++slot)
+	{
+		wait(slot);
+	}
+}
+
+void FramePipeline::wait(const size_t slot)
+{
+	auto & fence = fences_[slot];
+	if (fence == nullptr)
+	{
+		return;
+	}
+
+	while (glClientWaitSync(fence, GL_SYNC_FLUSH_COMMANDS_BIT, g_fence_timeout_ns) == GL_TIMEOUT_EXPIRED)
+	{
+	}
+
+	glDeleteSync(fence);
+	fence = nullptr;
+}
+
+void FramePipeline::record(const double stallMs)
+{
+	samples_[sampleCursor_] = stallMs;
+	sampleCursor_ = (sampleCursor_ + 1) % StallWindow;
+	sampleCount_ = std::min(sampleCount_ + 1, StallWindow);
+
+	// Waits on an already signaled fence still cost a call, count only real stalls.
+	constexpr auto stalledMs = 0.05;
+
+	auto sum = 0.0;
+	auto worst = 0.0;
+	size_t stalled = 0;
+	for (size_t index = 0; index < sampleCount_; ++index)
+	{
+		sum += samples_[index];
+		worst = std::max(worst, samples_[index]);
+		stalled += samples_[index] > stalledMs ? 1 : 0;
+	}
+
+	stalls_.lastMs = stallMs;
+	stalls_.meanMs = sum / static_cast<double>(sampleCount_);
+	stalls_.worstMs = worst;
+	stalls_.stalledFrames = stalled;
+	stalls_.samples = sampleCount_;
+}
+
+}// namespace fgl
@@ -0,0 +1,75 @@
+#pragma once
+
+#include <QElapsedTimer>
+#include <QOpenGLExtraFunctions>
+
+#include <array>
+#include <cstddef>
+
+namespace fgl
+{
+
+// Lets the CPU prepare a frame while the GPU still draws the previous ones.
+// Every frame in flight owns a slot; per-frame buffer regions are indexed by slot()
+// and a fence placed at the end of the frame guards the slot until the GPU is done
+// with it. beginFrame() waits for that fence, the time spent there is the stall.
+class FramePipeline final : protected QOpenGLExtraFunctions
+{
+public:
+	static constexpr size_t MaxFramesInFlight = 3;
+	static constexpr size_t StallWindow = 120;
+
+	struct Stalls
+	{
+		double lastMs = 0.0;
+		double meanMs = 0.0;
+		double worstMs = 0.0;
+		size_t stalledFrames = 0;// frames in the window that had to wait at all
+		size_t samples = 0;
+	};
+
+public:
+	FramePipeline() = default;
+	~FramePipeline();
+
+	FramePipeline(const FramePipeline &) = delete;
+	FramePipeline(FramePipeline &&) = delete;
+	FramePipeline & operator=(const FramePipeline &) = delete;
+	FramePipeline & operator=(FramePipeline &&) = delete;
+
+public:
+	// Must be set before create(), clamped to [1, MaxFramesInFlight]; 1 serializes CPU and GPU.
+	void setFramesInFlight(size_t count) noexcept;
+	[[nodiscard]] size_t framesInFlight() const noexcept { return framesInFlight_; }
+
+	// Both require a current context.
+	void create();
+	void destroy();
+
+	// Moves to the next slot and waits until the GPU has released it.
+	void beginFrame();
+	// Fences the commands of the frame; regions of this slot are reused after it signals.
+	void endFrame();
+	// Waits for every slot, for resources that can't be replaced while in use.
+	void waitIdle();
+
+	[[nodiscard]] size_t slot() const noexcept { return slot_; }
+	[[nodiscard]] const Stalls & stalls() const noexcept { return stalls_; }
+
+private:
+	void wait(size_t slot);
+	void record(double stallMs);
+
+private:
+	size_t framesInFlight_ = 2;
+	size_t slot_ = 0;
+	std::array<GLsync, MaxFramesInFlight> fences_{};
+
+	QElapsedTimer clock_;
+	std::array<double, StallWindow> samples_{};
+	size_t sampleCursor_ = 0;
+	size_t sampleCount_ = 0;
+	Stalls stalls_;
+};
+
+}// namespace fgl
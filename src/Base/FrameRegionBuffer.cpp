@@ -0,0 +1,75 @@
+#include "FrameRegionBuffer.hpp"
+
+#include <cstring>
+
+namespace fgl
+{
+
+FrameRegionBuffer::~FrameRegionBuffer()
+{
+	// GL objects are expected to be released with destroy() while the context is current.
+	Q_ASSERT(buffer_ == 0);
+}
+
+void FrameRegionBuffer::create(GLState & state, GLResources & resources, FramePipeline & pipeline, const GLenum target,
+							   const GLsizeiptr regionSize)
+{
+	initializeOpenGLFunctions();
+	state_ = &state;
+	pipeline_ = &pipeline;
+	target_ = target;
+	regionSize_ = regionSize;
+
+	const auto totalSize = regionSize_ * static_cast<GLsizeiptr>(pipeline.framesInFlight());
+	void * mapped = nullptr;
+	buffer_ = resources.createMappedBuffer(target_, totalSize, &mapped);
+	mapped_ = static_cast<std::byte *>(mapped);
+
+	if (mapped_ == nullptr)
+	{
+		staging_.resize(static_cast<size_t>(regionSize_));
+	}
+}
+
+void FrameRegionBuffer::destroy()
+{
+	if (buffer_ == 0)
+	{
+		return;
+	}
+
+	// Deleting the buffer unmaps it.
+	glDeleteBuffers(1, &buffer_);
+	buffer_ = 0;
+	mapped_ = nullptr;
+	staging_.clear();
+}
+
+std::byte * FrameRegionBuffer::region() noexcept
+{
+	return mapped_ != nullptr ? mapped_ + regionOffset() : staging_.data();
+}
+
+GLintptr FrameRegionBuffer::regionOffset() const noexcept
+{
+	return static_cast<GLintptr>(pipeline_->slot()) * regionSize_;
+}
+
+void FrameRegionBuffer::flush(const GLintptr offset, const GLsizeiptr size)
+{
+	if (mapped_ != nullptr || size == 0)
+	{
+		return;
+	}
+
+	// The pipeline has waited for this slot, so nothing in flight reads this range.
+	state_->bindBuffer(target_, buffer_);
+	if (auto * const target = glMapBufferRange(target_, regionOffset() + offset, size,
+			GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_RANGE_BIT | GL_MAP_UNSYNCHRONIZED_BIT))
+	{
+		std::memcpy(target, staging_.data() + offset, static_cast<size_t>(size));
+		glUnmapBuffer(target_);
+	}
+}
+
+}// namespace fgl
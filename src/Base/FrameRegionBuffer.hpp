@@ -0,0 +1,58 @@
+#pragma once
+
+#include <QOpenGLExtraFunctions>
+
+#include "FramePipeline.hpp"
+#include "GLResources.hpp"
+#include "GLState.hpp"
+
+#include <cstddef>
+#include <vector>
+
+namespace fgl
+{
+
+// Buffer with one fixed-size region per frame in flight, for data the CPU rewrites
+// while the GPU still reads earlier frames. The region of the pipeline's current slot
+// is free to write: persistently mapped storage is written in place, otherwise writes
+// are staged and uploaded by flush() with an unsynchronized map, never an implicit sync.
+// Regions keep their contents, so only what changed since a slot's last frame is written.
+class FrameRegionBuffer final : protected QOpenGLExtraFunctions
+{
+public:
+	FrameRegionBuffer() = default;
+	~FrameRegionBuffer();
+
+	FrameRegionBuffer(const FrameRegionBuffer &) = delete;
+	FrameRegionBuffer(FrameRegionBuffer &&) = delete;
+	FrameRegionBuffer & operator=(const FrameRegionBuffer &) = delete;
+	FrameRegionBuffer & operator=(FrameRegionBuffer &&) = delete;
+
+public:
+	// Both require a current context. Buffer bindings go through state.
+	void create(GLState & state, GLResources & resources, FramePipeline & pipeline, GLenum target, GLsizeiptr regionSize);
+	void destroy();
+
+	// Write pointer to the region of the current slot, valid until the next frame.
+	[[nodiscard]] std::byte * region() noexcept;
+	[[nodiscard]] GLintptr regionOffset() const noexcept;
+
+	// Makes [offset, offset + size) of the current region visible to GL.
+	void flush(GLintptr offset, GLsizeiptr size);
+
+	[[nodiscard]] bool isPersistent() const noexcept { return mapped_ != nullptr; }
+	[[nodiscard]] GLuint bufferId() const noexcept { return buffer_; }
+	[[nodiscard]] GLsizeiptr regionSize() const noexcept { return regionSize_; }
+
+private:
+	GLState * state_ = nullptr;
+	FramePipeline * pipeline_ = nullptr;
+	GLenum target_ = GL_ARRAY_BUFFER;
+	GLuint buffer_ = 0;
+	GLsizeiptr regionSize_ = 0;
+
+	std::byte * mapped_ = nullptr;
+	std::vector<std::byte> staging_;
+};
+
+}// namespace fgl
@@ -0,0 +1,198 @@
+#include "FrameScheduler.hpp"
+
+#include <algorithm>
+#include <cmath>
+
+namespace fgl
+{
+
+namespace
+{
+constexpr std::int64_t g_ns_per_ms = 1'000'000;
+constexpr std::int64_t g_ns_per_second = 1'000'000'000;
+}// namespace
+
+FrameScheduler::FrameScheduler(QOpenGLWidget & widget)
+	: widget_{widget}
+{
+	clock_.start();
+
+	timer_.setSingleShot(true);
+	timer_.setTimerType(Qt::PreciseTimer);
+	QObject::connect(&timer_, &QTimer::timeout, &widget_, [this] { onTick(); });
+	QObject::connect(&widget_, &QOpenGLWidget::frameSwapped, &widget_, [this] { onFrameSwapped(); });
+}
+
+void FrameScheduler::setMode(const Mode mode, const double rate)
+{
+	mode_ = mode;
+	rate_ = std::max(rate, 1.0);
+	periodNs_ = static_cast<std::int64_t>(std::llround(static_cast<double>(g_ns_per_second) / rate_));
+
+	timer_.stop();
+	lastStartNs_.reset();
+	intervalCount_ = 0;
+	intervalCursor_ = 0;
+	pacing_ = Pacing{};
+
+	if (mode_ == Mode::FixedRate)
+	{
+		deadlineNs_ = clock_.nsecsElapsed() + periodNs_;
+		armTimer();
+	}
+	if (!inFlight_)
+	{
+		schedule();
+	}
+}
+
+void FrameScheduler::requestFrame()
+{
+	if (mode_ != Mode::OnDemand)
+	{
+		return;
+	}
+	if (inFlight_)
+	{
+		// Picked up once the current frame is swapped, so a burst of input costs one frame.
+		pending_ = true;
+		return;
+	}
+	schedule();
+}
+
+void FrameScheduler::frameStarted()
+{
+	const auto now = clock_.nsecsElapsed();
+	if (lastStartNs_)
+	{
+		record(now - *lastStartNs_);
+	}
+	lastStartNs_ = now;
+
+	scheduled_ = false;
+	inFlight_ = true;
+}
+
+const char * FrameScheduler::modeName(const Mode mode) noexcept
+{
+	switch (mode)
+	{
+		case Mode::OnDemand:
+			return "on-demand";
+		case Mode::FixedRate:
+			return "fixed";
+		case Mode::Uncapped:
+			return "uncapped";
+	}
+	return "";
+}
+
+std::optional<FrameScheduler::Mode> FrameScheduler::parseMode(const QString & name)
+{
+	for (const auto mode : {Mode::OnDemand, Mode::FixedRate, Mode::Uncapped})
+	{
+		if (name == QLatin1String(modeName(mode)))
+		{
+			return mode;
+		}
+	}
+	return std::nullopt;
+}
+
+void FrameScheduler::schedule()
+{
+	if (!scheduled_)
+	{
+		scheduled_ = true;
+		widget_.update();
+	}
+}
+
+void FrameScheduler::onFrameSwapped()
+{
+	inFlight_ = false;
+
+	switch (mode_)
+	{
+		case Mode::OnDemand:
+			if (pending_)
+			{
+				pending_ = false;
+				schedule();
+			}
+			else
+			{
+				// Going idle, the gap to the next frame says nothing about pacing.
+				lastStartNs_.reset();
+			}
+			break;
+		case Mode::FixedRate:
+			break;
+		case Mode::Uncapped:
+			schedule();
+			break;
+	}
+}
+
+void FrameScheduler::onTick()
+{
+	if (mode_ != Mode::FixedRate)
+	{
+		return;
+	}
+
+	if (inFlight_ || scheduled_)
+	{
+		++pacing_.droppedTicks;
+	}
+	else
+	{
+		schedule();
+	}
+
+	deadlineNs_ += periodNs_;
+	armTimer();
+}
+
+void FrameScheduler::armTimer()
+{
+	// Deadlines are absolute, so rounding the timeout to milliseconds does not drift the rate.
+	const auto now = clock_.nsecsElapsed();
+	if (deadlineNs_ < now)
+	{
+		deadlineNs_ = now + periodNs_;
+	}
+	const auto timeoutMs = (deadlineNs_ - now + g_ns_per_ms / 2) / g_ns_per_ms;
+	timer_.start(static_cast<int>(timeoutMs));
+}
+
+void FrameScheduler::record(const std::int64_t intervalNs)
+{
+	intervals_[intervalCursor_] = static_cast<double>(intervalNs) / static_cast<double>(g_ns_per_ms);
+	intervalCursor_ = (intervalCursor_ + 1) % PacingWindow;
+	intervalCount_ = std::min(intervalCount_ + 1, PacingWindow);
+
+	auto sum = 0.0;
+	auto worst = 0.0;
+	for (size_t index = 0; index < intervalCount_; ++index)
+	{
+		sum += intervals_[index];
+		worst = std::max(worst, intervals_[index]);
+	}
+	const auto mean = sum / static_cast<double>(intervalCount_);
+
+	auto variance = 0.0;
+	for (size_t index = 0; index < intervalCount_; ++index)
+	{
+		const auto deviation = intervals_[index] - mean;
+		variance += deviation * deviation;
+	}
+
+	pacing_.meanMs = mean;
+	pacing_.jitterMs = std::sqrt(variance / static_cast<double>(intervalCount_));
+	pacing_.worstMs = worst;
+	pacing_.samples = intervalCount_;
+}
+
+}// namespace fgl
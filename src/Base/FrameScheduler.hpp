@@ -0,0 +1,93 @@
+#pragma once
+
+#include <QElapsedTimer>
+#include <QOpenGLWidget>
+#include <QTimer>
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <optional>
+
+namespace fgl
+{
+
+// Decides when the widget repaints.
+//  - OnDemand: requests are coalesced into at most one frame per swap, nothing runs while idle.
+//  - FixedRate: frames are driven by a precise timer re-armed against absolute deadlines.
+//  - Uncapped: the next frame is scheduled as soon as the previous one is swapped, for benchmarking.
+// Intervals between back-to-back frames are recorded to report pacing jitter.
+class FrameScheduler final
+{
+public:
+	enum class Mode
+	{
+		OnDemand,
+		FixedRate,
+		Uncapped,
+	};
+
+	struct Pacing
+	{
+		double meanMs = 0.0;
+		double jitterMs = 0.0;// standard deviation of the frame interval
+		double worstMs = 0.0;
+		size_t samples = 0;
+		size_t droppedTicks = 0;// fixed-rate ticks that found the previous frame still in flight
+	};
+
+	static constexpr size_t PacingWindow = 120;
+
+public:
+	explicit FrameScheduler(QOpenGLWidget & widget);
+
+	FrameScheduler(const FrameScheduler &) = delete;
+	FrameScheduler(FrameScheduler &&) = delete;
+	FrameScheduler & operator=(const FrameScheduler &) = delete;
+	FrameScheduler & operator=(FrameScheduler &&) = delete;
+
+public:
+	void setMode(Mode mode, double rate = 60.0);
+	[[nodiscard]] Mode mode() const noexcept { return mode_; }
+	[[nodiscard]] double rate() const noexcept { return rate_; }
+
+	// Asks for a frame in on-demand mode; continuous modes draw anyway.
+	void requestFrame();
+
+	// Called by the widget at the start of every paint.
+	void frameStarted();
+
+	[[nodiscard]] const Pacing & pacing() const noexcept { return pacing_; }
+
+	[[nodiscard]] static const char * modeName(Mode mode) noexcept;
+	[[nodiscard]] static std::optional<Mode> parseMode(const QString & name);
+
+private:
+	void schedule();
+	void onFrameSwapped();
+	void onTick();
+	void armTimer();
+	void record(std::int64_t intervalNs);
+
+private:
+	QOpenGLWidget & widget_;
+	QTimer timer_;
+	QElapsedTimer clock_;
+
+	Mode mode_ = Mode::OnDemand;
+	double rate_ = 60.0;
+	std::int64_t periodNs_ = 0;
+	std::int64_t deadlineNs_ = 0;
+
+	bool scheduled_ = false;// update() issued, paint not started yet
+	bool inFlight_ = false; // painted, not swapped yet
+	bool pending_ = false;  // requested while in flight
+	std::optional<std::int64_t> lastStartNs_;
+
+	std::array<double, PacingWindow> intervals_{};
+	size_t intervalCursor_ = 0;
+	size_t intervalCount_ = 0;
+	Pacing pacing_;
+};
+
+}// namespace fgl
@@ -0,0 +1,248 @@
+#include "GLResources.hpp"
+
+#include <QOpenGLContext>
+
+#include <algorithm>
+#include <iostream>
+
+#ifndef GL_DYNAMIC_STORAGE_BIT
+#define GL_DYNAMIC_STORAGE_BIT 0x0100
+#endif
+#ifndef GL_MAP_PERSISTENT_BIT
+#define GL_MAP_PERSISTENT_BIT 0x0040
+#endif
+#ifndef GL_MAP_COHERENT_BIT
+#define GL_MAP_COHERENT_BIT 0x0080
+#endif
+
+namespace fgl
+{
+
+namespace
+{
+constexpr GLbitfield g_persistent_flags = GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+
+template<typename Proc>
+bool resolveProc(QOpenGLContext & context, Proc & proc, const char * name)
+{
+	proc = reinterpret_cast<Proc>(context.getProcAddress(name));
+	return proc != nullptr;
+}
+
+GLsizei mipLevels(const GLsizei width, const GLsizei height)
+{
+	GLsizei levels = 1;
+	for (auto size = std::max(width, height); size > 1; size /= 2)
+	{
+		++levels;
+	}
+	return levels;
+}
+}// namespace
+
+void GLResources::create(GLState & state)
+{
+	initializeOpenGLFunctions();
+	state_ = &state;
+
+	direct_ = DirectFunctions{};
+	if (directAllowed_ && !resolve(direct_))
+	{
+		direct_ = DirectFunctions{};
+	}
+
+	bufferStorage_ = nullptr;
+	const auto context = QOpenGLContext::currentContext();
+	if (context != nullptr && !context->isOpenGLES()
+		&& (context->format().version() >= qMakePair(4, 4) || context->hasExtension("GL_ARB_buffer_storage")))
+	{
+		resolveProc(*context, bufferStorage_, "glBufferStorage");
+	}
+	std::cout << "GL resources: " << (isDirect() ? "direct state access" : "bind-to-edit") << std::endl;
+}
+
+bool GLResources::resolve(DirectFunctions & functions)
+{
+	const auto context = QOpenGLContext::currentContext();
+	if (context == nullptr || context->isOpenGLES())
+	{
+		return false;
+	}
+	const auto version = context->format().version();
+	if (version < qMakePair(4, 5) && !context->hasExtension("GL_ARB_direct_state_access"))
+	{
+		return false;
+	}
+
+	return resolveProc(*context, functions.createBuffers, "glCreateBuffers")
+		&& resolveProc(*context, functions.namedBufferStorage, "glNamedBufferStorage")
+		&& resolveProc(*context, functions.namedBufferSubData, "glNamedBufferSubData")
+		&& resolveProc(*context, functions.createVertexArrays, "glCreateVertexArrays")
+		&& resolveProc(*context, functions.enableVertexArrayAttrib, "glEnableVertexArrayAttrib")
+		&& resolveProc(*context, functions.vertexArrayVertexBuffer, "glVertexArrayVertexBuffer")
+		&& resolveProc(*context, functions.vertexArrayAttribFormat, "glVertexArrayAttribFormat")
+		&& resolveProc(*context, functions.vertexArrayAttribBinding, "glVertexArrayAttribBinding")
+		&& resolveProc(*context, functions.createTextures, "glCreateTextures")
+		&& resolveProc(*context, functions.textureBuffer, "glTextureBuffer")
+		&& resolveProc(*context, functions.textureStorage3D, "glTextureStorage3D")
+		&& resolveProc(*context, functions.textureSubImage3D, "glTextureSubImage3D")
+		&& resolveProc(*context, functions.textureParameteri, "glTextureParameteri")
+		&& resolveProc(*context, functions.generateTextureMipmap, "glGenerateTextureMipmap");
+}
+
+GLuint GLResources::createBuffer(const GLenum target, const GLsizeiptr size, const void * data, const bool dynamic)
+{
+	GLuint buffer = 0;
+	if (isDirect())
+	{
+		direct_.createBuffers(1, &buffer);
+		direct_.namedBufferStorage(buffer, size, data, dynamic ? GL_DYNAMIC_STORAGE_BIT : 0);
+		return buffer;
+	}
+
+	glGenBuffers(1, &buffer);
+	state_->bindBuffer(target, buffer);
+	glBufferData(target, size, data, dynamic ? GL_DYNAMIC_DRAW : GL_STATIC_DRAW);
+	state_->bindBuffer(target, 0);
+	return buffer;
+}
+
+GLuint GLResources::createMappedBuffer(const GLenum target, const GLsizeiptr size, void ** mapped)
+{
+	*mapped = nullptr;
+	if (!hasBufferStorage())
+	{
+		return createBuffer(target, size, nullptr, true);
+	}
+
+	// Mapping by name needs a 4.5 entry point that is not resolved, so the mapping goes through a binding.
+	GLuint buffer = 0;
+	glGenBuffers(1, &buffer);
+	state_->bindBuffer(target, buffer);
+	bufferStorage_(target, size, nullptr, g_persistent_flags);
+	*mapped = glMapBufferRange(target, 0, size, g_persistent_flags);
+	state_->bindBuffer(target, 0);
+	return buffer;
+}
+
+void GLResources::updateBuffer(const GLenum target, const GLuint buffer, const GLintptr offset, const GLsizeiptr size,
+							   const void * data)
+{
+	if (isDirect())
+	{
+		direct_.namedBufferSubData(buffer, offset, size, data);
+		return;
+	}
+
+	state_->bindBuffer(target, buffer);
+	glBufferSubData(target, offset, size, data);
+}
+
+GLuint GLResources::createVertexArray()
+{
+	GLuint vao = 0;
+	if (isDirect())
+	{
+		direct_.createVertexArrays(1, &vao);
+	}
+	else
+	{
+		glGenVertexArrays(1, &vao);
+	}
+	return vao;
+}
+
+void GLResources::vertexAttribute(const GLuint vao, const GLuint index, const GLuint buffer, const GLint size,
+								  const GLenum type, const bool normalized, const GLsizei stride, const GLintptr offset)
+{
+	if (isDirect())
+	{
+		direct_.vertexArrayVertexBuffer(vao, index, buffer, offset, stride);
+		direct_.vertexArrayAttribFormat(vao, index, size, type, normalized ? GL_TRUE : GL_FALSE, 0);
+		direct_.vertexArrayAttribBinding(vao, index, index);
+		direct_.enableVertexArrayAttrib(vao, index);
+		return;
+	}
+
+	state_->bindVertexArray(vao);
+	state_->bindBuffer(GL_ARRAY_BUFFER, buffer);
+	glEnableVertexAttribArray(index);
+	glVertexAttribPointer(index, size, type, normalized ? GL_TRUE : GL_FALSE, stride,
+						  reinterpret_cast<const void *>(offset));
+	state_->bindBuffer(GL_ARRAY_BUFFER, 0);
+	state_->bindVertexArray(0);
+}
+
+GLuint GLResources::createBufferTexture(const GLenum internalFormat, const GLuint buffer)
+{
+	GLuint texture = 0;
+	if (isDirect())
+	{
+		direct_.createTextures(GL_TEXTURE_BUFFER, 1, &texture);
+		direct_.textureBuffer(texture, internalFormat, buffer);
+		return texture;
+	}
+
+	glGenTextures(1, &texture);
+	state_->bindTexture(0, GL_TEXTURE_BUFFER, texture);
+	glTexBuffer(GL_TEXTURE_BUFFER, internalFormat, buffer);
+	state_->bindTexture(0, GL_TEXTURE_BUFFER, 0);
+	return texture;
+}
+
+GLuint GLResources::createTextureArray(const GLenum internalFormat, const GLsizei width, const GLsizei height,
+									   const GLsizei layers)
+{
+	GLuint texture = 0;
+	if (isDirect())
+	{
+		direct_.createTextures(GL_TEXTURE_2D_ARRAY, 1, &texture);
+		direct_.textureStorage3D(texture, mipLevels(width, height), internalFormat, width, height, layers);
+		return texture;
+	}
+
+	glGenTextures(1, &texture);
+	state_->bindTexture(0, GL_TEXTURE_2D_ARRAY, texture);
+	glTexImage3D(GL_TEXTURE_2D_ARRAY, 0, static_cast<GLint>(internalFormat), width, height, layers,
+				 0, GL_RGBA, GL_UNSIGNED_BYTE, nullptr);
+	return texture;
+}
+
+void GLResources::uploadLayer(const GLuint texture, const GLint layer, const GLsizei width, const GLsizei height,
+							  const void * rgba)
+{
+	glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+	if (isDirect())
+	{
+		direct_.textureSubImage3D(texture, 0, 0, 0, layer, width, height, 1, GL_RGBA, GL_UNSIGNED_BYTE, rgba);
+	}
+	else
+	{
+		state_->bindTexture(0, GL_TEXTURE_2D_ARRAY, texture);
+		glTexSubImage3D(GL_TEXTURE_2D_ARRAY, 0, 0, 0, layer, width, height, 1, GL_RGBA, GL_UNSIGNED_BYTE, rgba);
+	}
+	glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+}
+
+void GLResources::finishTextureArray(const GLuint texture, const GLenum minFilter, const GLenum magFilter, const GLenum wrapS,
+									 const GLenum wrapT)
+{
+	if (isDirect())
+	{
+		direct_.textureParameteri(texture, GL_TEXTURE_MIN_FILTER, static_cast<GLint>(minFilter));
+		direct_.textureParameteri(texture, GL_TEXTURE_MAG_FILTER, static_cast<GLint>(magFilter));
+		direct_.textureParameteri(texture, GL_TEXTURE_WRAP_S, static_cast<GLint>(wrapS));
+		direct_.textureParameteri(texture, GL_TEXTURE_WRAP_T, static_cast<GLint>(wrapT));
+		direct_.generateTextureMipmap(texture);
+		return;
+	}
+
+	state_->bindTexture(0, GL_TEXTURE_2D_ARRAY, texture);
+	glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MIN_FILTER, static_cast<GLint>(minFilter));
+	glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MAG_FILTER, static_cast<GLint>(magFilter));
+	glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_S, static_cast<GLint>(wrapS));
+	glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_T, static_cast<GLint>(wrapT));
+	glGenerateMipmap(GL_TEXTURE_2D_ARRAY);
+}
+
+}// namespace fgl
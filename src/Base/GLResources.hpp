@@ -0,0 +1,83 @@
+#pragma once
+
+#include <QOpenGLExtraFunctions>
+
+#include "GLState.hpp"
+
+namespace fgl
+{
+
+// Creates and fills buffers, vertex arrays and textures. With GL 4.5 or
+// ARB_direct_state_access objects are edited by name and get immutable storage,
+// so setup does not disturb the bindings and drivers skip reallocation checks.
+// Otherwise the GL 3.3 bind-to-edit calls are used, with bindings going through state.
+// Objects are owned by the caller and deleted with the usual glDelete* calls.
+class GLResources final : protected QOpenGLExtraFunctions
+{
+public:
+	GLResources() = default;
+
+	GLResources(const GLResources &) = delete;
+	GLResources(GLResources &&) = delete;
+	GLResources & operator=(const GLResources &) = delete;
+	GLResources & operator=(GLResources &&) = delete;
+
+public:
+	// Must be set before create(), false keeps the bind-to-edit path on any context.
+	void setDirectAllowed(bool allowed) noexcept { directAllowed_ = allowed; }
+
+	// Requires a current context, picks the path.
+	void create(GLState & state);
+
+	[[nodiscard]] bool isDirect() const noexcept { return direct_.createBuffers != nullptr; }
+
+	// Dynamic buffers can be updated with updateBuffer(), static ones are never written again.
+	[[nodiscard]] GLuint createBuffer(GLenum target, GLsizeiptr size, const void * data, bool dynamic);
+	void updateBuffer(GLenum target, GLuint buffer, GLintptr offset, GLsizeiptr size, const void * data);
+
+	// Immutable buffer mapped for writing for its whole lifetime (GL 4.4 / ARB_buffer_storage), writes
+	// become visible without flushing. Without buffer storage a dynamic buffer is returned and mapped is null.
+	[[nodiscard]] GLuint createMappedBuffer(GLenum target, GLsizeiptr size, void ** mapped);
+	[[nodiscard]] bool hasBufferStorage() const noexcept { return bufferStorage_ != nullptr; }
+
+	[[nodiscard]] GLuint createVertexArray();
+	// Float attribute sourced from buffer, binding slot and attribute index are the same.
+	void vertexAttribute(GLuint vao, GLuint index, GLuint buffer, GLint size, GLenum type, bool normalized,
+						 GLsizei stride, GLintptr offset);
+
+	[[nodiscard]] GLuint createBufferTexture(GLenum internalFormat, GLuint buffer);
+
+	// RGBA8 layers uploaded with uploadLayer(), then finished with mipmaps and sampler state.
+	[[nodiscard]] GLuint createTextureArray(GLenum internalFormat, GLsizei width, GLsizei height, GLsizei layers);
+	void uploadLayer(GLuint texture, GLint layer, GLsizei width, GLsizei height, const void * rgba);
+	void finishTextureArray(GLuint texture, GLenum minFilter, GLenum magFilter, GLenum wrapS, GLenum wrapT);
+
+private:
+	struct DirectFunctions
+	{
+		void(QOPENGLF_APIENTRYP createBuffers)(GLsizei n, GLuint * buffers) = nullptr;
+		void(QOPENGLF_APIENTRYP namedBufferStorage)(GLuint buffer, GLsizeiptr size, const void * data, GLbitfield flags) = nullptr;
+		void(QOPENGLF_APIENTRYP namedBufferSubData)(GLuint buffer, GLintptr offset, GLsizeiptr size, const void * data) = nullptr;
+		void(QOPENGLF_APIENTRYP createVertexArrays)(GLsizei n, GLuint * arrays) = nullptr;
+		void(QOPENGLF_APIENTRYP enableVertexArrayAttrib)(GLuint vaobj, GLuint index) = nullptr;
+		void(QOPENGLF_APIENTRYP vertexArrayVertexBuffer)(GLuint vaobj, GLuint bindingindex, GLuint buffer, GLintptr offset, GLsizei stride) = nullptr;
+		void(QOPENGLF_APIENTRYP vertexArrayAttribFormat)(GLuint vaobj, GLuint attribindex, GLint size, GLenum type, GLboolean normalized, GLuint relativeoffset) = nullptr;
+		void(QOPENGLF_APIENTRYP vertexArrayAttribBinding)(GLuint vaobj, GLuint attribindex, GLuint bindingindex) = nullptr;
+		void(QOPENGLF_APIENTRYP createTextures)(GLenum target, GLsizei n, GLuint * textures) = nullptr;
+		void(QOPENGLF_APIENTRYP textureBuffer)(GLuint texture, GLenum internalformat, GLuint buffer) = nullptr;
+		void(QOPENGLF_APIENTRYP textureStorage3D)(GLuint texture, GLsizei levels, GLenum internalformat, GLsizei width, GLsizei height, GLsizei depth) = nullptr;
+		void(QOPENGLF_APIENTRYP textureSubImage3D)(GLuint texture, GLint level, GLint xoffset, GLint yoffset, GLint zoffset, GLsizei width, GLsizei height, GLsizei depth, GLenum format, GLenum type, const void * pixels) = nullptr;
+		void(QOPENGLF_APIENTRYP textureParameteri)(GLuint texture, GLenum pname, GLint param) = nullptr;
+		void(QOPENGLF_APIENTRYP generateTextureMipmap)(GLuint texture) = nullptr;
+	};
+
+	[[nodiscard]] static bool resolve(DirectFunctions & functions);
+
+private:
+	GLState * state_ = nullptr;
+	bool directAllowed_ = true;
+	DirectFunctions direct_;
+	void(QOPENGLF_APIENTRYP bufferStorage_)(GLenum target, GLsizeiptr size, const void * data, GLbitfield flags) = nullptr;
+};
+
+}// namespace fgl
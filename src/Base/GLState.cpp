@@ -0,0 +1,384 @@
+#include "GLState.hpp"
+
+namespace fgl
+{
+
+void GLState::initialize(QOpenGLExtraFunctions & functions)
+{
+	gl_ = &functions;
+	elementBuffers_.clear();
+	invalidate();
+	frame_ = {};
+	lastFrame_ = {};
+}
+
+void GLState::beginFrame()
+{
+	lastFrame_ = frame_;
+	frame_ = {};
+	invalidate();
+}
+
+void GLState::invalidate()
+{
+	auto * const functions = gl_;
+	auto elementBuffers = std::move(elementBuffers_);
+	const auto frame = frame_;
+	const auto lastFrame = lastFrame_;
+
+	*this = GLState{};
+
+	gl_ = functions;
+	elementBuffers_ = std::move(elementBuffers);
+	frame_ = frame;
+	lastFrame_ = lastFrame;
+}
+
+void GLState::useProgram(const GLuint program)
+{
+	if (update(program_, program))
+	{
+		gl_->glUseProgram(program);
+	}
+}
+
+void GLState::bindVertexArray(const GLuint vao)
+{
+	if (update(vertexArray_, vao))
+	{
+		gl_->glBindVertexArray(vao);
+
+		const auto element = elementBuffers_.find(vao);
+		elementBuffer_ = element != elementBuffers_.end() ? std::optional<GLuint>{element->second} : std::nullopt;
+	}
+}
+
+void GLState::bindBuffer(const GLenum target, const GLuint buffer)
+{
+	if (target == GL_ELEMENT_ARRAY_BUFFER)
+	{
+		if (update(elementBuffer_, buffer))
+		{
+			gl_->glBindBuffer(target, buffer);
+			if (vertexArray_)
+			{
+				elementBuffers_[*vertexArray_] = buffer;
+			}
+		}
+		return;
+	}
+
+	auto * const slot = bufferSlot(target);
+	if (slot == nullptr)
+	{
+		++frame_.issued;
+		gl_->glBindBuffer(target, buffer);
+		return;
+	}
+
+	if (update(*slot, buffer))
+	{
+		gl_->glBindBuffer(target, buffer);
+	}
+}
+
+void GLState::bindBufferRange(const GLenum target, const GLuint index, const GLuint buffer, const GLintptr offset, const GLsizeiptr size)
+{
+	auto * const slot = indexedSlot(target, index);
+	if (slot == nullptr || update(*slot, Range{buffer, offset, size}))
+	{
+		if (slot == nullptr)
+		{
+			++frame_.issued;
+		}
+		gl_->glBindBufferRange(target, index, buffer, offset, size);
+
+		// Indexed binds also replace the generic binding of the target.
+		if (auto * const generic = bufferSlot(target))
+		{
+			*generic = buffer;
+		}
+	}
+}
+
+void GLState::bindBufferBase(const GLenum target, const GLuint index, const GLuint buffer)
+{
+	// A whole-buffer binding is recorded with size 0, which no range binding can have.
+	auto * const slot = indexedSlot(target, index);
+	if (slot == nullptr || update(*slot, Range{buffer, 0, 0}))
+	{
+		if (slot == nullptr)
+		{
+			++frame_.issued;
+		}
+		gl_->glBindBufferBase(target, index, buffer);
+
+		if (auto * const generic = bufferSlot(target))
+		{
+			*generic = buffer;
+		}
+	}
+}
+
+void GLState::bindFramebuffer(const GLuint framebuffer)
+{
+	if (update(framebuffer_, framebuffer))
+	{
+		gl_->glBindFramebuffer(GL_FRAMEBUFFER, framebuffer);
+	}
+}
+
+void GLState::vertexAttribI1i(const GLuint index, const GLint value)
+{
+	if (index >= MaxVertexAttributes)
+	{
+		++frame_.issued;
+		gl_->glVertexAttribI4i(index, value, 0, 0, 0);
+		return;
+	}
+
+	floatVertexAttributes_[index].reset();
+	if (update(vertexAttributes_[index], value))
+	{
+		gl_->glVertexAttribI4i(index, value, 0, 0, 0);
+	}
+}
+
+void GLState::vertexAttrib4f(const GLuint index, const std::array<GLfloat, 4> & value)
+{
+	if (index >= MaxVertexAttributes)
+	{
+		++frame_.issued;
+		gl_->glVertexAttrib4fv(index, value.data());
+		return;
+	}
+
+	vertexAttributes_[index].reset();
+	if (update(floatVertexAttributes_[index], value))
+	{
+		gl_->glVertexAttrib4fv(index, value.data());
+	}
+}
+
+void GLState::activeTexture(const GLuint unit)
+{
+	if (update(activeTexture_, unit))
+	{
+		gl_->glActiveTexture(GL_TEXTURE0 + unit);
+	}
+}
+
+void GLState::bindTexture(const GLuint unit, const GLenum target, const GLuint texture)
+{
+	auto * const slot = textureSlot(unit, target);
+	if (slot != nullptr && *slot == texture)
+	{
+		++frame_.elided;
+		return;
+	}
+
+	activeTexture(unit);
+	++frame_.issued;
+	gl_->glBindTexture(target, texture);
+	if (slot != nullptr)
+	{
+		*slot = texture;
+	}
+}
+
+void GLState::enable(const GLenum capability)
+{
+	setEnabled(capability, true);
+}
+
+void GLState::disable(const GLenum capability)
+{
+	setEnabled(capability, false);
+}
+
+void GLState::setEnabled(const GLenum capability, const bool enabled)
+{
+	auto * const slot = capabilitySlot(capability);
+	if (slot == nullptr || update(*slot, enabled))
+	{
+		if (slot == nullptr)
+		{
+			++frame_.issued;
+		}
+		if (enabled)
+		{
+			gl_->glEnable(capability);
+		}
+		else
+		{
+			gl_->glDisable(capability);
+		}
+	}
+}
+
+void GLState::blendFunc(const GLenum source, const GLenum destination)
+{
+	if (update(blendFunc_, std::array<GLenum, 4>{source, destination, source, destination}))
+	{
+		gl_->glBlendFunc(source, destination);
+	}
+}
+
+void GLState::blendFuncSeparate(const GLenum sourceRgb, const GLenum destinationRgb, const GLenum sourceAlpha,
+								const GLenum destinationAlpha)
+{
+	if (update(blendFunc_, std::array<GLenum, 4>{sourceRgb, destinationRgb, sourceAlpha, destinationAlpha}))
+	{
+		gl_->glBlendFuncSeparate(sourceRgb, destinationRgb, sourceAlpha, destinationAlpha);
+	}
+}
+
+void GLState::depthFunc(const GLenum function)
+{
+	if (update(depthFunc_, function))
+	{
+		gl_->glDepthFunc(function);
+	}
+}
+
+void GLState::depthMask(const bool enabled)
+{
+	if (update(depthMask_, enabled))
+	{
+		gl_->glDepthMask(enabled ? GL_TRUE : GL_FALSE);
+	}
+}
+
+void GLState::colorMask(const bool enabled)
+{
+	if (update(colorMask_, enabled))
+	{
+		const auto mask = enabled ? GL_TRUE : GL_FALSE;
+		gl_->glColorMask(mask, mask, mask, mask);
+	}
+}
+
+void GLState::cullFace(const GLenum mode)
+{
+	if (update(cullFaceMode_, mode))
+	{
+		gl_->glCullFace(mode);
+	}
+}
+
+void GLState::forgetVertexArray(const GLuint vao)
+{
+	elementBuffers_.erase(vao);
+	if (vertexArray_ == vao)
+	{
+		vertexArray_.reset();
+		elementBuffer_.reset();
+	}
+}
+
+void GLState::forgetFramebuffer(const GLuint framebuffer)
+{
+	// Deleting the bound framebuffer reverts the binding to the default one.
+	if (framebuffer_ == framebuffer)
+	{
+		framebuffer_.reset();
+	}
+}
+
+void GLState::forgetTexture(const GLuint texture)
+{
+	for (auto * const units : {&textures2D_, &textures2DArray_, &texturesBuffer_})
+	{
+		for (auto & unit : *units)
+		{
+			if (unit == texture)
+			{
+				unit.reset();
+			}
+		}
+	}
+}
+
+std::optional<GLuint> * GLState::bufferSlot(const GLenum target)
+{
+	switch (target)
+	{
+		case GL_ARRAY_BUFFER:
+			return &arrayBuffer_;
+		case GL_UNIFORM_BUFFER:
+			return &uniformBuffer_;
+		case GL_TEXTURE_BUFFER:
+			return &textureBuffer_;
+		case GL_SHADER_STORAGE_BUFFER:
+			return &shaderStorageBuffer_;
+		case GL_DRAW_INDIRECT_BUFFER:
+			return &drawIndirectBuffer_;
+		case GL_COPY_READ_BUFFER:
+			return &copyReadBuffer_;
+		case GL_COPY_WRITE_BUFFER:
+			return &copyWriteBuffer_;
+		case GL_TRANSFORM_FEEDBACK_BUFFER:
+			return &transformFeedbackBuffer_;
+		default:
+			return nullptr;
+	}
+}
+
+auto GLState::indexedSlot(const GLenum target, const GLuint index) -> std::optional<Range> *
+{
+	if (index >= MaxIndexedBindings)
+	{
+		return nullptr;
+	}
+
+	switch (target)
+	{
+		case GL_UNIFORM_BUFFER:
+			return &uniformRanges_[index];
+		case GL_SHADER_STORAGE_BUFFER:
+			return &shaderStorageRanges_[index];
+		case GL_TRANSFORM_FEEDBACK_BUFFER:
+			return &transformFeedbackRanges_[index];
+		default:
+			return nullptr;
+	}
+}
+
+std::optional<GLuint> * GLState::textureSlot(const GLuint unit, const GLenum target)
+{
+	if (unit >= MaxTextureUnits)
+	{
+		return nullptr;
+	}
+
+	switch (target)
+	{
+		case GL_TEXTURE_2D:
+			return &textures2D_[unit];
+		case GL_TEXTURE_2D_ARRAY:
+			return &textures2DArray_[unit];
+		case GL_TEXTURE_BUFFER:
+			return &texturesBuffer_[unit];
+		default:
+			return nullptr;
+	}
+}
+
+std::optional<bool> * GLState::capabilitySlot(const GLenum capability)
+{
+	switch (capability)
+	{
+		case GL_BLEND:
+			return &blend_;
+		case GL_DEPTH_TEST:
+			return &depthTest_;
+		case GL_CULL_FACE:
+			return &cullFace_;
+		case GL_RASTERIZER_DISCARD:
+			return &rasterizerDiscard_;
+		default:
+			return nullptr;
+	}
+}
+
+}// namespace fgl
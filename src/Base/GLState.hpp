@@ -0,0 +1,150 @@
+#pragma once
+
+#include <QOpenGLExtraFunctions>
+
+#include <array>
+#include <cstddef>
+#include <optional>
+#include <unordered_map>
+
+namespace fgl
+{
+
+// Shadow copy of the GL state the renderer touches every frame.
+// Calls that would not change anything are dropped and counted as elided.
+// Code that changes the same state through raw GL calls must call invalidate()
+// afterwards, so the next call through this layer is issued unconditionally.
+class GLState final
+{
+public:
+	struct Counters
+	{
+		size_t issued = 0;
+		size_t elided = 0;
+	};
+
+	static constexpr size_t MaxTextureUnits = 16;
+	static constexpr size_t MaxIndexedBindings = 16;
+	static constexpr size_t MaxVertexAttributes = 16;
+
+public:
+	void initialize(QOpenGLExtraFunctions & functions);
+
+	// Starts a new counting period and forgets context-wide state,
+	// which the widget may have changed between frames.
+	void beginFrame();
+	void invalidate();
+
+	[[nodiscard]] const Counters & lastFrame() const noexcept { return lastFrame_; }
+	[[nodiscard]] const Counters & currentFrame() const noexcept { return frame_; }
+
+public:
+	void useProgram(GLuint program);
+	void bindVertexArray(GLuint vao);
+	void bindBuffer(GLenum target, GLuint buffer);
+	void bindBufferRange(GLenum target, GLuint index, GLuint buffer, GLintptr offset, GLsizeiptr size);
+	void bindBufferBase(GLenum target, GLuint index, GLuint buffer);
+	void bindFramebuffer(GLuint framebuffer);
+
+	// Current value of an integer attribute whose array is disabled, a cheap per-draw constant.
+	void vertexAttribI1i(GLuint index, GLint value);
+	// Same for a float vec4 attribute.
+	void vertexAttrib4f(GLuint index, const std::array<GLfloat, 4> & value);
+
+	void activeTexture(GLuint unit);
+	void bindTexture(GLuint unit, GLenum target, GLuint texture);
+
+	void enable(GLenum capability);
+	void disable(GLenum capability);
+	void setEnabled(GLenum capability, bool enabled);
+	void blendFunc(GLenum source, GLenum destination);
+	void blendFuncSeparate(GLenum sourceRgb, GLenum destinationRgb, GLenum sourceAlpha, GLenum destinationAlpha);
+	void depthFunc(GLenum function);
+	void depthMask(bool enabled);
+	void colorMask(bool enabled);
+	void cullFace(GLenum mode);
+
+	// Removes everything known about a deleted object.
+	void forgetVertexArray(GLuint vao);
+	void forgetFramebuffer(GLuint framebuffer);
+	void forgetTexture(GLuint texture);
+
+private:
+	struct Range
+	{
+		GLuint buffer = 0;
+		GLintptr offset = 0;
+		GLsizeiptr size = 0;
+
+		bool operator==(const Range & other) const noexcept
+		{
+			return buffer == other.buffer && offset == other.offset && size == other.size;
+		}
+	};
+
+	template<typename T>
+	[[nodiscard]] bool update(std::optional<T> & shadow, const T & value)
+	{
+		if (shadow == value)
+		{
+			++frame_.elided;
+			return false;
+		}
+		shadow = value;
+		++frame_.issued;
+		return true;
+	}
+
+	[[nodiscard]] std::optional<GLuint> * bufferSlot(GLenum target);
+	[[nodiscard]] std::optional<Range> * indexedSlot(GLenum target, GLuint index);
+	[[nodiscard]] std::optional<GLuint> * textureSlot(GLuint unit, GLenum target);
+	[[nodiscard]] std::optional<bool> * capabilitySlot(GLenum capability);
+
+private:
+	QOpenGLExtraFunctions * gl_ = nullptr;
+
+	std::optional<GLuint> program_;
+	std::optional<GLuint> vertexArray_;
+	std::optional<GLuint> framebuffer_;
+
+	// Element array bindings belong to the vertex array object, not to the context.
+	std::unordered_map<GLuint, GLuint> elementBuffers_;
+	std::optional<GLuint> elementBuffer_;
+
+	std::optional<GLuint> arrayBuffer_;
+	std::optional<GLuint> uniformBuffer_;
+	std::optional<GLuint> textureBuffer_;
+	std::optional<GLuint> shaderStorageBuffer_;
+	std::optional<GLuint> drawIndirectBuffer_;
+	std::optional<GLuint> copyReadBuffer_;
+	std::optional<GLuint> copyWriteBuffer_;
+	std::optional<GLuint> transformFeedbackBuffer_;
+
+	std::array<std::optional<Range>, MaxIndexedBindings> uniformRanges_;
+	std::array<std::optional<Range>, MaxIndexedBindings> shaderStorageRanges_;
+	std::array<std::optional<Range>, MaxIndexedBindings> transformFeedbackRanges_;
+
+	// An attribute holds one current value, set as integer or as float.
+	std::array<std::optional<GLint>, MaxVertexAttributes> vertexAttributes_;
+	std::array<std::optional<std::array<GLfloat, 4>>, MaxVertexAttributes> floatVertexAttributes_;
+
+	std::optional<GLuint> activeTexture_;
+	std::array<std::optional<GLuint>, MaxTextureUnits> textures2D_;
+	std::array<std::optional<GLuint>, MaxTextureUnits> textures2DArray_;
+	std::array<std::optional<GLuint>, MaxTextureUnits> texturesBuffer_;
+
+	std::optional<bool> blend_;
+	std::optional<bool> depthTest_;
+	std::optional<bool> cullFace_;
+	std::optional<bool> rasterizerDiscard_;
+	std::optional<std::array<GLenum, 4>> blendFunc_;// source and destination of color, then alpha
+	std::optional<GLenum> depthFunc_;
+	std::optional<bool> depthMask_;
+	std::optional<bool> colorMask_;
+	std::optional<GLenum> cullFaceMode_;
+
+	Counters frame_;
+	Counters lastFrame_;
+};
+
+}// namespace fgl
@@ -14,6 +14,12 @@ GLWidget::ContextGuard::~ContextGuard()
 	self_.doneCurrent();
 }
 
+GLWidget::~GLWidget()
+{
+	const auto guard = bindContext();
+	frames_.destroy();
+}
+
 auto GLWidget::bindContext() noexcept -> ContextGuard
 {
 	return ContextGuard{*this};
@@ -22,6 +28,9 @@ auto GLWidget::bindContext() noexcept -> ContextGuard
 void GLWidget::initializeGL()
 {
 	initializeOpenGLFunctions();
+	state_.initialize(*this);
+	resources_.create(state_);
+	frames_.create();
 
 	{
 		const auto guard = bindContext();
@@ -38,7 +47,11 @@ void GLWidget::resizeGL(const int width, const int height)
 
 void GLWidget::paintGL()
 {
+	scheduler_.frameStarted();
+	state_.beginFrame();
+	frames_.beginFrame();
 	onRender();
+	frames_.endFrame();
 }
 
 }// namespace fgl
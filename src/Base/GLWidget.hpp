@@ -1,19 +1,24 @@
 #pragma once
 
-#include <QOpenGLFunctions>
+#include <QOpenGLExtraFunctions>
 #include <QOpenGLWidget>
 
+#include "FramePipeline.hpp"
+#include "FrameScheduler.hpp"
+#include "GLResources.hpp"
+#include "GLState.hpp"
+
 namespace fgl
 {
 
 class GLWidget : public QOpenGLWidget
-	, protected QOpenGLFunctions
+	, protected QOpenGLExtraFunctions
 {
 	Q_OBJECT
 
 public:
 	using QOpenGLWidget::QOpenGLWidget;
-	virtual ~GLWidget() = default;
+	~GLWidget() override;
 
 public:
 	virtual void onInit() = 0;
@@ -38,6 +43,25 @@ public:
 
 	[[nodiscard]] ContextGuard bindContext() noexcept;
 
+	// Redundant-call filter for per-frame state changes, reset before every onRender().
+	[[nodiscard]] GLState & state() noexcept { return state_; }
+
+	// Object creation, direct state access when the context has it. Created before onInit().
+	[[nodiscard]] GLResources & resources() noexcept { return resources_; }
+
+	// Frames in flight and their fences, onRender() runs between beginFrame() and endFrame().
+	[[nodiscard]] FramePipeline & frames() noexcept { return frames_; }
+
+	// Decides when frames are drawn, use requestFrame() instead of update().
+	[[nodiscard]] FrameScheduler & scheduler() noexcept { return scheduler_; }
+	void requestFrame() { scheduler_.requestFrame(); }
+
+private:
+	GLState state_;
+	GLResources resources_;
+	FramePipeline frames_;
+	FrameScheduler scheduler_{*this};
+
 private:// QOpenGLWidget
 	void initializeGL() override;
 	void resizeGL(int width, int height) override;
@@ -0,0 +1,144 @@
+#include "ShaderCache.hpp"
+
+#include <QFile>
+#include <QStringList>
+
+#include <iostream>
+
+namespace fgl
+{
+
+ShaderCache::~ShaderCache()
+{
+	// Programs are expected to be released with destroy() while the context is current.
+	Q_ASSERT(programs_.empty());
+}
+
+void ShaderCache::create(GLState & state, std::vector<Source> sources, std::vector<QByteArray> defines, SetupFunction setup)
+{
+	Q_ASSERT(defines.size() <= sizeof(Key) * 8);
+	state_ = &state;
+
+	// The #version line has to stay first, defines go right after it.
+	for (const auto & source : sources)
+	{
+		QFile file(source.path);
+		if (!file.open(QIODevice::ReadOnly))
+		{
+			std::cout << "ShaderCache: can't read " << source.path.toStdString() << std::endl;
+			continue;
+		}
+
+		auto text = file.readAll();
+		QByteArray version;
+		if (text.startsWith("#version"))
+		{
+			const auto end = text.indexOf('\n');
+			version = text.left(end + 1);
+			text.remove(0, end + 1);
+		}
+		stages_.push_back(Stage{source.type, version, text, source.features});
+	}
+
+	// Libraries take the version of their stage.
+	for (auto & library : stages_)
+	{
+		for (const auto & stage : stages_)
+		{
+			if (library.version.isEmpty() && stage.type == library.type && !stage.version.isEmpty())
+			{
+				library.version = stage.version;
+			}
+		}
+	}
+
+	defines_ = std::move(defines);
+	setup_ = std::move(setup);
+}
+
+void ShaderCache::destroy()
+{
+	programs_.clear();
+	stages_.clear();
+}
+
+GLuint ShaderCache::program(const Key key)
+{
+	auto it = programs_.find(key);
+	if (it == programs_.end())
+	{
+		it = programs_.emplace(key, compile(key)).first;
+		if (it->second)
+		{
+			++stats_.variants;
+		}
+		else
+		{
+			++stats_.failures;
+		}
+	}
+	return it->second ? it->second->programId() : 0;
+}
+
+void ShaderCache::recordUse(const Key key, const size_t draws)
+{
+	histogram_[key] += draws;
+	if (key != lastUsed_)
+	{
+		++stats_.switches;
+		lastUsed_ = key;
+	}
+}
+
+QString ShaderCache::describe(const Key key) const
+{
+	QStringList names;
+	for (size_t bit = 0; bit < defines_.size(); ++bit)
+	{
+		if (key & (Key{1} << bit))
+		{
+			names << QString::fromLatin1(defines_[bit]);
+		}
+	}
+	return names.isEmpty() ? QStringLiteral("base") : names.join('+');
+}
+
+std::unique_ptr<QOpenGLShaderProgram> ShaderCache::compile(const Key key)
+{
+	QByteArray header;
+	for (size_t bit = 0; bit < defines_.size(); ++bit)
+	{
+		if (key & (Key{1} << bit))
+		{
+			header += "#define " + defines_[bit] + '\n';
+		}
+	}
+
+	auto program = std::make_unique<QOpenGLShaderProgram>();
+	for (const auto & stage : stages_)
+	{
+		if ((key & stage.features) != stage.features)
+		{
+			continue;
+		}
+		if (!program->addShaderFromSourceCode(stage.type, stage.version + header + stage.body))
+		{
+			std::cout << "ShaderCache: variant " << describe(key).toStdString() << " does not compile" << std::endl;
+			return nullptr;
+		}
+	}
+	if (!program->link())
+	{
+		std::cout << "ShaderCache: variant " << describe(key).toStdString() << " does not link" << std::endl;
+		return nullptr;
+	}
+
+	if (setup_)
+	{
+		state_->useProgram(program->programId());
+		setup_(*program);
+	}
+	return program;
+}
+
+}// namespace fgl
@@ -0,0 +1,98 @@
+#pragma once
+
+#include <QByteArray>
+#include <QOpenGLShaderProgram>
+#include <QString>
+
+#include "GLState.hpp"
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <map>
+#include <memory>
+#include <unordered_map>
+#include <vector>
+
+namespace fgl
+{
+
+// Compiles variants of one set of shader sources, one per combination of feature defines.
+// A key is a bit mask over the define list, bit i enables "#define <defines[i]>" in every
+// stage. Variants are compiled on first use and cached by key, failed ones are not retried.
+// Callers report how many draws used a variant, which gives a usage histogram.
+// A stage may consist of several sources, linked as separate shader objects; one without a
+// #version line is a library and gets the version of the stage's other sources. A source
+// with features is only part of the variants whose key has all of them.
+class ShaderCache final
+{
+public:
+	using Key = std::uint32_t;
+
+	struct Source
+	{
+		QOpenGLShader::ShaderType type;
+		QString path;
+		Key features = 0;
+	};
+
+	// Runs once per compiled variant with the program bound, for uniform and block bindings.
+	using SetupFunction = std::function<void(QOpenGLShaderProgram & program)>;
+
+	struct Stats
+	{
+		size_t variants = 0;
+		size_t failures = 0;
+		size_t switches = 0;// variant changes between consecutive reports
+	};
+
+public:
+	ShaderCache() = default;
+	~ShaderCache();
+
+	ShaderCache(const ShaderCache &) = delete;
+	ShaderCache(ShaderCache &&) = delete;
+	ShaderCache & operator=(const ShaderCache &) = delete;
+	ShaderCache & operator=(ShaderCache &&) = delete;
+
+public:
+	// Both require a current context. Sources are read once, here; programs are bound
+	// through state for setup.
+	void create(GLState & state, std::vector<Source> sources, std::vector<QByteArray> defines, SetupFunction setup);
+	void destroy();
+
+	// Program of the variant, compiled on first use; 0 when the variant does not link.
+	[[nodiscard]] GLuint program(Key key);
+
+	void recordUse(Key key, size_t draws = 1);
+
+	[[nodiscard]] const std::map<Key, size_t> & histogram() const noexcept { return histogram_; }
+	[[nodiscard]] const Stats & stats() const noexcept { return stats_; }
+
+	// Defines of a key joined with '+', "base" for the variant without features.
+	[[nodiscard]] QString describe(Key key) const;
+
+private:
+	[[nodiscard]] std::unique_ptr<QOpenGLShaderProgram> compile(Key key);
+
+private:
+	struct Stage
+	{
+		QOpenGLShader::ShaderType type;
+		QByteArray version;
+		QByteArray body;
+		Key features;
+	};
+
+	GLState * state_ = nullptr;
+	std::vector<Stage> stages_;
+	std::vector<QByteArray> defines_;
+	SetupFunction setup_;
+
+	std::unordered_map<Key, std::unique_ptr<QOpenGLShaderProgram>> programs_;
+	std::map<Key, size_t> histogram_;
+	Key lastUsed_ = ~Key{0};
+	Stats stats_;
+};
+
+}// namespace fgl
@@ -0,0 +1,82 @@
+#include "TextureArrayAtlas.hpp"
+
+#include <algorithm>
+
+namespace fgl
+{
+
+TextureArrayAtlas::~TextureArrayAtlas()
+{
+	// GL objects are expected to be released with destroy() while the context is current.
+	Q_ASSERT(std::none_of(pages_.begin(), pages_.end(), [](const Page & page) { return page.texture != 0; }));
+}
+
+void TextureArrayAtlas::create(GLState & state, GLResources & resources)
+{
+	initializeOpenGLFunctions();
+	state_ = &state;
+	resources_ = &resources;
+	glGetIntegerv(GL_MAX_ARRAY_TEXTURE_LAYERS, &maxLayers_);
+}
+
+void TextureArrayAtlas::destroy()
+{
+	for (const auto & page : pages_)
+	{
+		if (page.texture != 0)
+		{
+			state_->forgetTexture(page.texture);
+			glDeleteTextures(1, &page.texture);
+		}
+	}
+	pages_.clear();
+	pending_.clear();
+}
+
+auto TextureArrayAtlas::add(const GLsizei width, const GLsizei height, const std::uint8_t * rgba, const GLenum internalFormat,
+							const TextureSampler & sampler) -> Entry
+{
+	// Uploaded pages are immutable, new images go to a page that has not been created yet.
+	auto page = std::find_if(pages_.begin(), pages_.end(), [&](const Page & candidate) {
+		return candidate.texture == 0 && candidate.width == width && candidate.height == height
+			&& candidate.internalFormat == internalFormat && candidate.sampler == sampler && candidate.layers < maxLayers_;
+	});
+	if (page == pages_.end())
+	{
+		page = pages_.insert(pages_.end(), Page{0, width, height, internalFormat, sampler, 0});
+	}
+
+	const Entry entry{static_cast<size_t>(page - pages_.begin()), page->layers++};
+
+	const auto size = static_cast<size_t>(width) * static_cast<size_t>(height) * 4;
+	pending_.push_back(Pending{entry.page, entry.layer, std::vector<std::uint8_t>(rgba, rgba + size)});
+	return entry;
+}
+
+void TextureArrayAtlas::upload()
+{
+	for (size_t index = 0; index < pages_.size(); ++index)
+	{
+		auto & page = pages_[index];
+		if (page.texture != 0)
+		{
+			continue;
+		}
+
+		page.texture = resources_->createTextureArray(page.internalFormat, page.width, page.height, page.layers);
+		for (const auto & pending : pending_)
+		{
+			if (pending.page == index)
+			{
+				resources_->uploadLayer(page.texture, pending.layer, page.width, page.height, pending.pixels.data());
+			}
+		}
+		resources_->finishTextureArray(page.texture, page.sampler.minFilter, page.sampler.magFilter,
+									   page.sampler.wrapS, page.sampler.wrapT);
+	}
+
+	pending_.clear();
+	pending_.shrink_to_fit();
+}
+
+}// namespace fgl
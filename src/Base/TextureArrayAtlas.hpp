@@ -0,0 +1,93 @@
+#pragma once
+
+#include <QOpenGLExtraFunctions>
+
+#include "GLResources.hpp"
+#include "GLState.hpp"
+
+#include <compare>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace fgl
+{
+
+// Filters and wraps of a texture, trilinear and repeat by default.
+struct TextureSampler
+{
+	GLenum minFilter = GL_LINEAR_MIPMAP_LINEAR;
+	GLenum magFilter = GL_LINEAR;
+	GLenum wrapS = GL_REPEAT;
+	GLenum wrapT = GL_REPEAT;
+
+	auto operator<=>(const TextureSampler &) const = default;
+};
+
+// Groups images of equal size, format and sampler state into GL_TEXTURE_2D_ARRAY pages.
+// Draws select their image by page and layer, so a scene needs one texture bind
+// per page instead of one per draw. Images are collected with add() and uploaded
+// together; sampler state is set on the page texture, so images that filter or wrap
+// differently never share a page.
+class TextureArrayAtlas final : protected QOpenGLExtraFunctions
+{
+public:
+	struct Entry
+	{
+		size_t page = 0;
+		GLint layer = 0;
+	};
+
+	struct Page
+	{
+		GLuint texture = 0;
+		GLsizei width = 0;
+		GLsizei height = 0;
+		GLenum internalFormat = GL_RGBA8;
+		TextureSampler sampler;
+		GLsizei layers = 0;
+	};
+
+public:
+	TextureArrayAtlas() = default;
+	~TextureArrayAtlas();
+
+	TextureArrayAtlas(const TextureArrayAtlas &) = delete;
+	TextureArrayAtlas(TextureArrayAtlas &&) = delete;
+	TextureArrayAtlas & operator=(const TextureArrayAtlas &) = delete;
+	TextureArrayAtlas & operator=(TextureArrayAtlas &&) = delete;
+
+public:
+	// Both require a current context. Texture bindings go through state, textures are made by resources.
+	void create(GLState & state, GLResources & resources);
+	void destroy();
+
+	// Copies tightly packed RGBA8 rows, the internal format decides how GL stores them.
+	Entry add(GLsizei width, GLsizei height, const std::uint8_t * rgba, GLenum internalFormat = GL_RGBA8,
+			  const TextureSampler & sampler = {});
+
+	// Creates the textures of pages that received images since the last upload.
+	void upload();
+
+	[[nodiscard]] size_t pageCount() const noexcept { return pages_.size(); }
+	[[nodiscard]] const Page & page(size_t index) const { return pages_[index]; }
+	[[nodiscard]] GLuint texture(size_t page) const { return pages_[page].texture; }
+
+private:
+	struct Pending
+	{
+		size_t page = 0;
+		GLint layer = 0;
+		std::vector<std::uint8_t> pixels;
+	};
+
+private:
+	GLState * state_ = nullptr;
+	GLResources * resources_ = nullptr;
+	GLint maxLayers_ = 256;
+
+	std::vector<Page> pages_;
+	std::vector<Pending> pending_;
+};
+
+}// namespace fgl
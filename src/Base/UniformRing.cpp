@@ -0,0 +1,179 @@
+#include "UniformRing.hpp"
+
+#include <QOpenGLContext>
+
+#include <algorithm>
+
+#ifndef GL_MAP_PERSISTENT_BIT
+#define GL_MAP_PERSISTENT_BIT 0x0040
+#endif
+#ifndef GL_MAP_COHERENT_BIT
+#define GL_MAP_COHERENT_BIT 0x0080
+#endif
+
+namespace fgl
+{
+
+namespace
+{
+using BufferStorageProc = void(QOPENGLF_APIENTRYP)(GLenum target, GLsizeiptr size, const void * data, GLbitfield flags);
+
+constexpr GLbitfield g_persistent_flags = GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+
+BufferStorageProc resolveBufferStorage(QOpenGLContext & context)
+{
+	if (context.isOpenGLES())
+	{
+		return nullptr;
+	}
+	const auto version = context.format().version();
+	if (version < qMakePair(4, 4) && !context.hasExtension("GL_ARB_buffer_storage"))
+	{
+		return nullptr;
+	}
+	return reinterpret_cast<BufferStorageProc>(context.getProcAddress("glBufferStorage"));
+}
+}// namespace
+
+UniformRing::~UniformRing()
+{
+	// GL objects are expected to be released with destroy() while the context is current.
+	Q_ASSERT(buffer_ == 0);
+}
+
+void UniformRing::create(GLState & state, FramePipeline & pipeline, const GLsizeiptr segmentSize)
+{
+	initializeOpenGLFunctions();
+	state_ = &state;
+	pipeline_ = &pipeline;
+	glGetIntegerv(GL_UNIFORM_BUFFER_OFFSET_ALIGNMENT, &alignment_);
+
+	const auto context = QOpenGLContext::currentContext();
+	hasBufferStorage_ = context != nullptr && resolveBufferStorage(*context) != nullptr;
+
+	segmentSize_ = alignedSize(segmentSize);
+	allocateStorage();
+}
+
+void UniformRing::destroy()
+{
+	releaseStorage();
+}
+
+void UniformRing::allocateStorage()
+{
+	const auto totalSize = segmentSize_ * static_cast<GLsizeiptr>(pipeline_->framesInFlight());
+
+	glGenBuffers(1, &buffer_);
+	state_->bindBuffer(GL_UNIFORM_BUFFER, buffer_);
+
+	if (hasBufferStorage_)
+	{
+		const auto bufferStorage = resolveBufferStorage(*QOpenGLContext::currentContext());
+		bufferStorage(GL_UNIFORM_BUFFER, totalSize, nullptr, g_persistent_flags);
+		mapped_ = static_cast<std::byte *>(glMapBufferRange(GL_UNIFORM_BUFFER, 0, totalSize, g_persistent_flags));
+	}
+
+	if (mapped_ == nullptr)
+	{
+		glBufferData(GL_UNIFORM_BUFFER, totalSize, nullptr, GL_STREAM_DRAW);
+		staging_.resize(static_cast<size_t>(segmentSize_));
+	}
+
+	state_->bindBuffer(GL_UNIFORM_BUFFER, 0);
+
+	cursor_ = 0;
+	flushed_ = 0;
+}
+
+void UniformRing::releaseStorage()
+{
+	if (buffer_ == 0)
+	{
+		return;
+	}
+
+	if (mapped_ != nullptr)
+	{
+		state_->bindBuffer(GL_UNIFORM_BUFFER, buffer_);
+		glUnmapBuffer(GL_UNIFORM_BUFFER);
+		state_->bindBuffer(GL_UNIFORM_BUFFER, 0);
+		mapped_ = nullptr;
+	}
+
+	glDeleteBuffers(1, &buffer_);
+	buffer_ = 0;
+	staging_.clear();
+}
+
+void UniformRing::beginFrame(const GLsizeiptr requiredSize)
+{
+	if (requiredSize > segmentSize_)
+	{
+		// Grow geometrically into a new buffer, GL keeps the old one alive while frames in flight read it.
+		releaseStorage();
+		segmentSize_ = alignedSize(std::max(requiredSize, segmentSize_ * 2));
+		allocateStorage();
+	}
+
+	segment_ = pipeline_->slot();
+
+	cursor_ = 0;
+	flushed_ = 0;
+}
+
+void UniformRing::endFrame()
+{
+	flush();
+}
+
+auto UniformRing::allocate(const GLsizeiptr size) -> Allocation
+{
+	const auto alignedBlockSize = alignedSize(size);
+	Q_ASSERT(cursor_ + alignedBlockSize <= segmentSize_);
+
+	const auto segmentOffset = cursor_;
+	cursor_ += alignedBlockSize;
+
+	auto * const data = mapped_ != nullptr
+		? mapped_ + segment_ * static_cast<size_t>(segmentSize_) + segmentOffset
+		: staging_.data() + segmentOffset;
+
+	return Allocation{data, static_cast<GLintptr>(segment_) * segmentSize_ + segmentOffset, size};
+}
+
+void UniformRing::flush()
+{
+	if (mapped_ != nullptr || cursor_ == flushed_)
+	{
+		flushed_ = cursor_;
+		return;
+	}
+
+	// The pipeline has waited for this slot, so nothing in flight reads this range.
+	const auto offset = static_cast<GLintptr>(segment_) * segmentSize_ + flushed_;
+	const auto size = cursor_ - flushed_;
+
+	state_->bindBuffer(GL_UNIFORM_BUFFER, buffer_);
+	if (auto * const target = glMapBufferRange(GL_UNIFORM_BUFFER, offset, size,
+			GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_RANGE_BIT | GL_MAP_UNSYNCHRONIZED_BIT))
+	{
+		std::memcpy(target, staging_.data() + flushed_, static_cast<size_t>(size));
+		glUnmapBuffer(GL_UNIFORM_BUFFER);
+	}
+
+	flushed_ = cursor_;
+}
+
+void UniformRing::bindRange(const GLuint bindingPoint, const Allocation & allocation)
+{
+	state_->bindBufferRange(GL_UNIFORM_BUFFER, bindingPoint, buffer_, allocation.offset, allocation.size);
+}
+
+GLsizeiptr UniformRing::alignedSize(const GLsizeiptr size) const noexcept
+{
+	const auto alignment = static_cast<GLsizeiptr>(alignment_);
+	return (size + alignment - 1) / alignment * alignment;
+}
+
+}// namespace fgl
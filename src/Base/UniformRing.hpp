@@ -0,0 +1,89 @@
+#pragma once
+
+#include <QOpenGLExtraFunctions>
+
+#include "FramePipeline.hpp"
+#include "GLState.hpp"
+
+#include <array>
+#include <cstddef>
+#include <cstring>
+#include <vector>
+
+namespace fgl
+{
+
+// Streaming uniform buffer split into one segment per frame in flight.
+// Blocks are written into the segment of the pipeline's current slot and bound
+// by range; the pipeline's fence guards the segment until the GPU is done with it.
+// Uses a persistently mapped buffer when GL 4.4 / ARB_buffer_storage is available,
+// otherwise uploads the written range with an unsynchronized map on flush().
+class UniformRing final : protected QOpenGLExtraFunctions
+{
+public:
+	struct Allocation
+	{
+		void * data = nullptr;
+		GLintptr offset = 0;
+		GLsizeiptr size = 0;
+	};
+
+public:
+	UniformRing() = default;
+	~UniformRing();
+
+	UniformRing(const UniformRing &) = delete;
+	UniformRing(UniformRing &&) = delete;
+	UniformRing & operator=(const UniformRing &) = delete;
+	UniformRing & operator=(UniformRing &&) = delete;
+
+public:
+	// Both require a current context. Buffer bindings go through state, one segment per slot of pipeline.
+	void create(GLState & state, FramePipeline & pipeline, GLsizeiptr segmentSize);
+	void destroy();
+
+	// Moves to the segment of the pipeline's slot, which the pipeline has already waited
+	// for, and makes sure it can hold at least requiredSize bytes of aligned allocations.
+	void beginFrame(GLsizeiptr requiredSize = 0);
+	void endFrame();
+
+	[[nodiscard]] Allocation allocate(GLsizeiptr size);
+
+	template<typename Block>
+	[[nodiscard]] Allocation push(const Block & block)
+	{
+		const auto allocation = allocate(sizeof(Block));
+		std::memcpy(allocation.data, &block, sizeof(Block));
+		return allocation;
+	}
+
+	// Makes everything allocated since the last flush visible to GL.
+	void flush();
+
+	void bindRange(GLuint bindingPoint, const Allocation & allocation);
+
+	[[nodiscard]] GLsizeiptr alignedSize(GLsizeiptr size) const noexcept;
+	[[nodiscard]] bool isPersistent() const noexcept { return mapped_ != nullptr; }
+	[[nodiscard]] GLuint bufferId() const noexcept { return buffer_; }
+
+private:
+	void allocateStorage();
+	void releaseStorage();
+
+private:
+	GLState * state_ = nullptr;
+	FramePipeline * pipeline_ = nullptr;
+	GLuint buffer_ = 0;
+	GLint alignment_ = 256;
+	GLsizeiptr segmentSize_ = 0;
+
+	size_t segment_ = 0;
+	GLsizeiptr cursor_ = 0;
+	GLsizeiptr flushed_ = 0;
+
+	bool hasBufferStorage_ = false;
+	std::byte * mapped_ = nullptr;
+	std::vector<std::byte> staging_;
+};
+
+}// namespace fgl